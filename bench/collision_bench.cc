@@ -0,0 +1,172 @@
+/*
+** Microbenchmark of the collision detection and contact generation of one simulation step.
+** The rover of scene_1_mt drives towards the step and the time spent in dSpaceCollide
+** is measured with the former near-callback ( string comparison of the collision groups and
+** contact parameters filled for each contact ) and with the current one ( interned groups,
+** group filter mask and material table ).
+**
+** Argument (optional):
+** Number of simulation steps ( default: 10000 ).
+*/
+
+#include "ode/environment.hh"
+#include "ode/box.hh"
+#include "rover.hh"
+#include <chrono>
+#include <cstring>
+
+
+// Environment exposing the collision phase of Environment::next_step:
+class Bench_environment : public ode::Environment
+{
+	public:
+
+	Bench_environment( double mu ) : ode::Environment( mu ) {}
+
+	void collide() { _collide(); }
+
+	void solve( double dt ) { _solve( dt ); }
+};
+
+
+// Same environment with the near-callback as it was before the interning of the collision groups:
+class Legacy_environment : public Bench_environment
+{
+	public:
+
+	Legacy_environment( double mu ) : Bench_environment( mu ) {}
+
+	void collide()
+	{
+		dSpaceCollide( _space_id, (void*) this, &_legacy_near_callback );
+	}
+
+	protected:
+
+	static void _legacy_near_callback( void* data, dGeomID o1, dGeomID o2 )
+	{
+		reinterpret_cast<Legacy_environment*>( data )->_legacy_collision( o1, o2 );
+	}
+
+	void _legacy_collision( dGeomID o1, dGeomID o2 )
+	{
+		ode::contact_type type = ode::HARD;
+
+		ode::collision_feature* o1_collision_feature = (ode::collision_feature*) dGeomGetData( o1 );
+		ode::collision_feature* o2_collision_feature = (ode::collision_feature*) dGeomGetData( o2 );
+
+		if ( o1_collision_feature != NULL && o1_collision_feature->callback )
+			o1_collision_feature->callback( o2_collision_feature );
+
+		if ( o2_collision_feature != NULL && o2_collision_feature->callback )
+			o2_collision_feature->callback( o1_collision_feature );
+
+		if ( o1_collision_feature == NULL && o2_collision_feature == NULL )
+			return;
+		else if ( o1_collision_feature != NULL && o2_collision_feature != NULL )
+		{
+			if ( o1_collision_feature->type == ode::DISABLED || o2_collision_feature->type == ode::DISABLED )
+				return;
+			else if ( strcmp( o1_collision_feature->group, o2_collision_feature->group ) == 0 )
+				return;
+			else if ( o1_collision_feature->type == ode::SOFT || o2_collision_feature->type == ode::SOFT )
+				type = ode::SOFT;
+		}
+		else
+		{
+			ode::collision_feature* feature = o1_collision_feature != NULL ? o1_collision_feature : o2_collision_feature;
+			if ( *feature->group == '\0' || feature->type == ode::DISABLED )
+				return;
+			else if ( feature->type == ode::SOFT )
+				type = ode::SOFT;
+		}
+
+		const int N = 10;
+		dContact contact[N];
+		int n = dCollide( o1, o2, N, &contact[0].geom, sizeof( dContact ) );
+
+		for ( int i = 0 ; i < n ; i++ )
+		{
+			contact[i].surface.mode = dContactApprox1;
+			contact[i].surface.mu = _mu;
+			if ( type == ode::SOFT )
+			{
+				contact[i].surface.mode |= dContactSoftCFM | dContactSoftERP;
+				contact[i].surface.soft_cfm = 0.005;
+				contact[i].surface.soft_erp = 0.4;
+			}
+
+			dJointID c = dJointCreateContact( get_world(), get_contactgroup(), &contact[i] );
+			dJointAttach( c, dGeomGetBody( contact[i].geom.g1 ), dGeomGetBody( contact[i].geom.g2 ) );
+		}
+	}
+};
+
+
+// Run the step scenario and return the mean duration of the collision phase in microseconds:
+template<class Env>
+double run( int n_steps, Eigen::Vector3d& final_pos )
+{
+	Env env( 0.5 );
+
+	robot::Rover_1 robot( env, Eigen::Vector3d( 0, 0, 0 ) );
+	robot.SetCrawlingMode( true );
+	robot.DeactivateIC();
+
+	float step_height( 0.105*2 );
+	ode::Box step( env, Eigen::Vector3d( 1, 0, step_height/2 ), 1, 1, 3, step_height, false );
+	step.fix();
+	step.set_collision_group( "ground" );
+
+	ode::Box step_c( env, Eigen::Vector3d( 2, 0, step_height/2 ), 1, 2, 3, step_height, false );
+	step_c.fix();
+	step_c.set_collision_group( "ground" );
+
+	const float timestep( 0.001 );
+	float speed( 0 ), speedf( 0.04 ), term( 0.5 );
+
+	std::chrono::steady_clock::duration collision_time( 0 );
+
+	for ( int i = 0 ; i < n_steps ; i++ )
+	{
+		if ( speed <= speedf )
+		{
+			speed += speedf/term*timestep;
+			robot.SetRobotSpeed( speed );
+		}
+
+		auto start = std::chrono::steady_clock::now();
+		env.collide();
+		collision_time += std::chrono::steady_clock::now() - start;
+
+		env.solve( timestep );
+		robot.next_step( timestep );
+	}
+
+	final_pos = robot.GetPosition();
+
+	return std::chrono::duration<double,std::micro>( collision_time ).count()/n_steps;
+}
+
+
+int main( int argc, char* argv[] )
+{
+	int n_steps( 10000 );
+	if ( argc > 1 )
+		n_steps = atoi( argv[1] );
+
+	dInitODE();
+
+	Eigen::Vector3d legacy_pos, pos;
+	double legacy_cost = run<Legacy_environment>( n_steps, legacy_pos );
+	double cost = run<Bench_environment>( n_steps, pos );
+
+	printf( "Collision phase over %i steps:\n", n_steps );
+	printf( "  strcmp near-callback:   %7.3f µs/step\n", legacy_cost );
+	printf( "  interned groups:        %7.3f µs/step ( x%.2f )\n", cost, legacy_cost/cost );
+	printf( "  final position drift:   %g m\n", ( pos - legacy_pos ).norm() );
+
+	dCloseODE();
+
+	return 0;
+}
@@ -0,0 +1,120 @@
+/*
+** Benchmark of the low-pass filters of Rover_1: the 4 wheel torque filters and the 12 FT sensor filters
+** updated one by one as separate filters::LP_second_order_bilinear of the Filters library, as in the
+** original Rover_1, then as separate LP_filter objects and finally as two LP_filter_banks.
+** The time per simulation step and the largest difference with the outputs of the library are reported.
+**
+** Arguments (optional):
+** Number of steps ( default: 10000000 ).
+*/
+
+#include "ode/filter_bank.hh"
+#include "Filters/cpp/filters.hh" // https://github.com/Bouty92/Filters
+#include <chrono>
+#include <random>
+#include <vector>
+#include <cmath>
+#include <cstdio>
+
+
+#define N_TORQUES 4
+#define N_FT 12
+
+
+int main( int argc, char* argv[] )
+{
+	long n_steps = argc > 1 ? atol( argv[1] ) : 10000000;
+
+	// Random inputs, taken cyclically from a small pool to keep the memory traffic low:
+	const int n_inputs = 1024;
+	std::mt19937 gen( 0 );
+	std::normal_distribution<double> randn( 0, 10 );
+	std::vector<double> inputs( n_inputs*( N_TORQUES + N_FT ) );
+	for ( double& x : inputs )
+		x = randn( gen );
+
+
+	// Filters of the library, allocated on the heap as in the original Rover_1:
+	filters::ptr_t<double> lib_torque_filter[N_TORQUES];
+	filters::ptr_t<double> lib_ft_filter[N_FT];
+	double lib_torque_output[N_TORQUES], lib_ft_output[N_FT];
+	for ( int k = 0 ; k < N_TORQUES ; k++ )
+		lib_torque_filter[k] = filters::ptr_t<double>( new filters::LP_second_order_bilinear<double>( 0.001, 2*M_PI, 0.5, nullptr, lib_torque_output + k ) );
+	for ( int k = 0 ; k < N_FT ; k++ )
+		lib_ft_filter[k] = filters::ptr_t<double>( new filters::LP_second_order_bilinear<double>( 0.001, 4*M_PI, 0.5, nullptr, lib_ft_output + k ) );
+
+	double checksum_lib = 0;
+	auto start = std::chrono::steady_clock::now();
+	for ( long s = 0 ; s < n_steps ; s++ )
+	{
+		const double* x = &inputs[( s%n_inputs )*( N_TORQUES + N_FT )];
+		for ( int k = 0 ; k < N_TORQUES ; k++ )
+			lib_torque_filter[k]->update( x[k] );
+		for ( int k = 0 ; k < N_FT ; k++ )
+			lib_ft_filter[k]->update( x[N_TORQUES+k] );
+		checksum_lib += lib_torque_output[s%N_TORQUES] + lib_ft_output[s%N_FT];
+	}
+	double t_lib = std::chrono::duration<double>( std::chrono::steady_clock::now() - start ).count();
+
+
+	// Separate LP_filters, allocated on the heap likewise:
+	ode::LP_filter<double>::ptr_t torque_filter[N_TORQUES];
+	ode::LP_filter<double>::ptr_t ft_filter[N_FT];
+	double torque_output[N_TORQUES], ft_output[N_FT];
+	for ( int k = 0 ; k < N_TORQUES ; k++ )
+		torque_filter[k] = ode::LP_filter<double>::ptr_t( new ode::LP_filter<double>( 0.001, 2*M_PI, 0.5, nullptr, torque_output + k ) );
+	for ( int k = 0 ; k < N_FT ; k++ )
+		ft_filter[k] = ode::LP_filter<double>::ptr_t( new ode::LP_filter<double>( 0.001, 4*M_PI, 0.5, nullptr, ft_output + k ) );
+
+	double checksum_ref = 0;
+	start = std::chrono::steady_clock::now();
+	for ( long s = 0 ; s < n_steps ; s++ )
+	{
+		const double* x = &inputs[( s%n_inputs )*( N_TORQUES + N_FT )];
+		for ( int k = 0 ; k < N_TORQUES ; k++ )
+			torque_filter[k]->update( x[k] );
+		for ( int k = 0 ; k < N_FT ; k++ )
+			ft_filter[k]->update( x[N_TORQUES+k] );
+		checksum_ref += torque_output[s%N_TORQUES] + ft_output[s%N_FT];
+	}
+	double t_ref = std::chrono::duration<double>( std::chrono::steady_clock::now() - start ).count();
+
+
+	// Banks:
+	ode::LP_filter_bank<N_TORQUES> torque_filters( 0.001, 2*M_PI, 0.5 );
+	ode::LP_filter_bank<N_FT> ft_filters( 0.001, 4*M_PI, 0.5 );
+	double torque_bank_output[N_TORQUES], ft_bank_output[N_FT];
+
+	double checksum_bank = 0;
+	start = std::chrono::steady_clock::now();
+	for ( long s = 0 ; s < n_steps ; s++ )
+	{
+		const double* x = &inputs[( s%n_inputs )*( N_TORQUES + N_FT )];
+		torque_filters.update( x, torque_bank_output );
+		ft_filters.update( x + N_TORQUES, ft_bank_output );
+		checksum_bank += torque_bank_output[s%N_TORQUES] + ft_bank_output[s%N_FT];
+	}
+	double t_bank = std::chrono::duration<double>( std::chrono::steady_clock::now() - start ).count();
+
+
+	// Largest differences with the library:
+	double error_ref = 0, error_bank = 0;
+	for ( int k = 0 ; k < N_TORQUES ; k++ )
+	{
+		error_ref = std::max( error_ref, fabs( torque_output[k] - lib_torque_output[k] ) );
+		error_bank = std::max( error_bank, fabs( torque_bank_output[k] - lib_torque_output[k] ) );
+	}
+	for ( int k = 0 ; k < N_FT ; k++ )
+	{
+		error_ref = std::max( error_ref, fabs( ft_output[k] - lib_ft_output[k] ) );
+		error_bank = std::max( error_bank, fabs( ft_bank_output[k] - lib_ft_output[k] ) );
+	}
+
+	printf( "%-20s %8.2f ns/step\n", "Library filters", t_lib/n_steps*1e9 );
+	printf( "%-20s %8.2f ns/step | max error %.3g | checksums %s\n", "Separate LP_filters", t_ref/n_steps*1e9, error_ref,
+	        checksum_ref == checksum_lib ? "identical" : "different" );
+	printf( "%-20s %8.2f ns/step | max error %.3g | checksums %s ( %s to the separate LP_filters )\n", "Filter banks", t_bank/n_steps*1e9, error_bank,
+	        checksum_bank == checksum_lib ? "identical" : "different", checksum_bank == checksum_ref ? "identical" : "different" );
+
+	return 0;
+}
@@ -0,0 +1,105 @@
+/*
+** Equivalence check of ode::LP_filter with filters::LP_second_order_bilinear, which it replaces in Rover_1.
+** For each set of parameters, both filters are fed with the same step, sine and random inputs and the
+** largest difference between their outputs is reported, relative to the amplitude of the input.
+** The snapshot of LP_filter is also checked: a filter restored half way through must then give the
+** same outputs, bit for bit, as the one that ran uninterrupted.
+** The exit status is non-zero if any check failed.
+**
+** Arguments (optional):
+** Number of steps per input ( default: 100000 ).
+** Tolerance on the relative difference, which absorbs the rounding of the coefficients ( default: 1e-8 ).
+*/
+
+#include "ode/lp_filter.hh"
+#include "Filters/cpp/filters.hh" // https://github.com/Bouty92/Filters
+#include <algorithm>
+#include <random>
+#include <vector>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+
+
+typedef struct filter_params
+{
+	double dt, w0, zeta;
+} filter_params;
+
+
+// Largest difference between the outputs of both filters over the inputs, relative to the largest input:
+double max_difference( const filter_params& p, const std::vector<double>& inputs )
+{
+	double lib_output( 0 ), output( 0 );
+	filters::ptr_t<double> lib_filter( new filters::LP_second_order_bilinear<double>( p.dt, p.w0, p.zeta, nullptr, &lib_output ) );
+	ode::LP_filter<double> filter( p.dt, p.w0, p.zeta, nullptr, &output );
+
+	double amplitude( 0 ), difference( 0 );
+	for ( double x : inputs )
+	{
+		lib_filter->update( x );
+		filter.update( x );
+		amplitude = std::max( amplitude, fabs( x ) );
+		difference = std::max( difference, fabs( output - lib_output ) );
+	}
+
+	return amplitude > 0 ? difference/amplitude : difference;
+}
+
+
+// Whether a filter restored from the snapshot taken half way through gives the same outputs as the original:
+bool restores_identically( const filter_params& p, const std::vector<double>& inputs )
+{
+	ode::LP_filter<double> filter( p.dt, p.w0, p.zeta );
+	ode::LP_filter<double> restored( p.dt, p.w0, p.zeta );
+
+	size_t half = inputs.size()/2;
+	for ( size_t k = 0 ; k < half ; k++ )
+		filter.update( inputs[k] );
+
+	double state[ode::LP_filter<double>::state_size];
+	filter.save_state( state );
+	restored.load_state( state );
+
+	for ( size_t k = half ; k < inputs.size() ; k++ )
+		if ( filter.update( inputs[k] ) != restored.update( inputs[k] ) )
+			return false;
+	return true;
+}
+
+
+int main( int argc, char* argv[] )
+{
+	long n_steps = argc > 1 ? atol( argv[1] ) : 100000;
+	double tolerance = argc > 2 ? atof( argv[2] ) : 1e-8;
+
+	// Parameters of the torque and FT sensor filters of Rover_1, then more demanding ones:
+	std::vector<filter_params> params = { { 0.001, 2*M_PI, 0.5 }, { 0.001, 4*M_PI, 0.5 },
+	                                      { 0.01, 100, 0.1 }, { 0.0001, 2*M_PI, 2 }, { 0.05, 10, 0.7 } };
+
+	std::vector<double> step( n_steps, 1. );
+	std::vector<double> sine( n_steps );
+	std::vector<double> noise( n_steps );
+	std::mt19937 gen( 0 );
+	std::normal_distribution<double> randn( 0, 10 );
+	for ( long k = 0 ; k < n_steps ; k++ )
+	{
+		sine[k] = 5*sin( 0.01*k );
+		noise[k] = randn( gen );
+	}
+
+	bool success = true;
+	for ( const filter_params& p : params )
+	{
+		double difference = std::max( { max_difference( p, step ), max_difference( p, sine ), max_difference( p, noise ) } );
+		bool identical = restores_identically( p, noise );
+
+		printf( "dt %-7g w0 %-8.4g zeta %-4g | difference %9.3g %s | restored %s\n", p.dt, p.w0, p.zeta, difference,
+		        difference <= tolerance ? "ok" : "\033[1;31mmismatch\033[0;39m",
+		        identical ? "identical" : "\033[1;31mdiverged\033[0;39m" );
+		success &= difference <= tolerance && identical;
+	}
+	fflush( stdout );
+
+	return success ? 0 : 1;
+}
@@ -0,0 +1,97 @@
+/*
+** Benchmark of the flattened model trees against the ModelTree library.
+** Both trees of a controller are evaluated on random states, one state at a time with
+** Linear_model_tree or Polynomial_model_tree, one state at a time with Flat_tree_policy
+** and by batches with Flat_tree_policy::predict_batch.
+** The time per decision and the largest difference between the outputs are reported.
+**
+** Arguments (optional):
+** Prefix of the YAML files of the trees ( default: ../scripts/tree_params2_ ).
+** Degree of the polynomial models ( default: 1 ).
+** Oblique trees: 0 or 1 ( default: 0 ).
+** Number of states ( default: 100000 ).
+*/
+
+#include "flat_model_tree.hh"
+#include "model_tree.hh" // https://github.com/Bouty92/ModelTree
+#include <chrono>
+#include <random>
+#include <cmath>
+#include <cstdio>
+
+
+// Dimension of the state of Rover_1_mt:
+#define STATE_DIM 14
+
+
+int main( int argc, char* argv[] )
+{
+	std::string prefix( argc > 1 ? argv[1] : "../scripts/tree_params2_" );
+	unsigned int degree = argc > 2 ? atoi( argv[2] ) : 1;
+	bool oblique = argc > 3 ? atoi( argv[3] ) : false;
+	int n_states = argc > 4 ? atoi( argv[4] ) : 100000;
+
+	std::string path_1 = prefix + "1.yaml";
+	std::string path_2 = prefix + "2.yaml";
+
+	mt_ptr_t<double> mt_1, mt_2;
+	if ( degree == 1 )
+	{
+		mt_1 = mt_ptr_t<double>( new Linear_model_tree<double>( path_1, oblique ) );
+		mt_2 = mt_ptr_t<double>( new Linear_model_tree<double>( path_2, oblique ) );
+	}
+	else
+	{
+		mt_1 = mt_ptr_t<double>( new Polynomial_model_tree<double>( path_1, oblique, degree, false ) );
+		mt_2 = mt_ptr_t<double>( new Polynomial_model_tree<double>( path_2, oblique, degree, false ) );
+	}
+	Flat_tree_policy<double> policy( { path_1, path_2 }, STATE_DIM, oblique, degree );
+
+
+	// Random states at the scales of the state of the rover:
+	const double scales[STATE_DIM] = { 90, 45, 25, 25, 45, 100, 100, 100, 30, 30, 30, 30, 30, 30 };
+	std::mt19937 gen( 0 );
+	std::normal_distribution<double> randn( 0, 0.5 );
+	std::vector<std::vector<double>> states( n_states, std::vector<double>( STATE_DIM ) );
+	std::vector<double> flat_states( n_states*STATE_DIM );
+	for ( int i = 0 ; i < n_states ; i++ )
+		for ( int j = 0 ; j < STATE_DIM ; j++ )
+			flat_states[i*STATE_DIM+j] = states[i][j] = randn( gen )*scales[j];
+
+
+	std::vector<double> y_ref( 2*n_states ), y_single( 2*n_states ), y_batch( 2*n_states );
+	std::vector<int> leaves( 2*n_states );
+	int node;
+
+	auto start = std::chrono::steady_clock::now();
+	for ( int i = 0 ; i < n_states ; i++ )
+	{
+		y_ref[2*i] = mt_1->predict( states[i], node );
+		y_ref[2*i+1] = mt_2->predict( states[i], node );
+	}
+	double t_ref = std::chrono::duration<double>( std::chrono::steady_clock::now() - start ).count();
+
+	start = std::chrono::steady_clock::now();
+	for ( int i = 0 ; i < n_states ; i++ )
+		policy.predict( &flat_states[i*STATE_DIM], &y_single[2*i], &leaves[2*i] );
+	double t_single = std::chrono::duration<double>( std::chrono::steady_clock::now() - start ).count();
+
+	start = std::chrono::steady_clock::now();
+	policy.predict_batch( flat_states.data(), n_states, y_batch.data(), leaves.data() );
+	double t_batch = std::chrono::duration<double>( std::chrono::steady_clock::now() - start ).count();
+
+
+	double err_single = 0, err_batch = 0;
+	for ( int i = 0 ; i < 2*n_states ; i++ )
+	{
+		err_single = std::max( err_single, fabs( y_single[i] - y_ref[i] ) );
+		err_batch = std::max( err_batch, fabs( y_batch[i] - y_ref[i] ) );
+	}
+
+	printf( "Trees of depth %d and %d, %d and %d leaves\n", policy.tree( 0 ).depth(), policy.tree( 1 ).depth(), policy.tree( 0 ).n_leaves(), policy.tree( 1 ).n_leaves() );
+	printf( "%-20s %8.1f ns/decision\n", "ModelTree", t_ref/n_states*1e9 );
+	printf( "%-20s %8.1f ns/decision | max error %.3g\n", "Flat, single", t_single/n_states*1e9, err_single );
+	printf( "%-20s %8.1f ns/decision | max error %.3g\n", "Flat, batch", t_batch/n_states*1e9, err_batch );
+
+	return 0;
+}
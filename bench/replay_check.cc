@@ -0,0 +1,190 @@
+/*
+** Bitwise-replay check of the deterministic mode of ode::Environment.
+** For each solver, the rover of scene_1_mt drives over the step with a given seed and the
+** snapshot of the whole scenario is recorded periodically. The same episode is then run again:
+**   serial    once more on the main thread,
+**   parallel  by several copies stepped concurrently on a thread pool,
+**   restored  from the snapshot recorded half way through, in a newly built scenario,
+** and every snapshot is compared bit for bit with the reference. The first step at which
+** a replay diverges is reported. The exit status is non-zero if any replay diverged.
+** Two rovers are checked: the bare Rover_1, and Rover_1_tf driven by its actor from the
+** start of the internal control on. The parallel replay of the latter is skipped, as the
+** copies would share the batches of inferences of their actor.
+**
+** Arguments (optional):
+** Simulated duration in seconds ( default: 10 ).
+** Seed ( default: 0 ).
+** Number of parallel copies ( default: number of hardware threads ).
+** Path to the actor model of Rover_1_tf ( default: ../training_data/Rt05/actor ).
+*/
+
+#include "step_scenario.hh"
+#include "rover_tf.hh"
+#include "ode/thread_pool.hh"
+#include <cstring>
+#include <memory>
+#include <functional>
+
+
+#define DEFAULT_PATH_TO_MODEL_DIR "../training_data/Rt05/actor"
+
+
+// Snapshots of an episode every check_period steps:
+typedef std::vector<std::vector<double>> trace_t;
+
+const int check_period = 100;
+const float timestep = 0.001;
+
+
+Step_params replay_params( const ode::env_config& config, float duration, bool internal_control )
+{
+	Step_params params;
+	params.config = config;
+	params.timeout = duration;
+	params.x_goal = 100;
+	params.y_max = 100;
+	if ( ! internal_control )
+		params.IC_start = duration + 1;
+	return params;
+}
+
+
+// Run the scenario to its end, recording a snapshot every check_period steps from the step first_step on:
+template<class R>
+void record( Step_scenario<R>& scenario, long first_step, trace_t& trace )
+{
+	long step = first_step;
+	bool done = false;
+	while ( ! done )
+	{
+		done = scenario.next_step( timestep );
+		if ( ++step % check_period == 0 || done )
+			trace.push_back( scenario.snapshot() );
+	}
+}
+
+
+inline bool identical( const std::vector<double>& s1, const std::vector<double>& s2 )
+{
+	return s1.size() == s2.size() && memcmp( s1.data(), s2.data(), s1.size()*sizeof( double ) ) == 0;
+}
+
+
+// Step of the first snapshot of the replay differing from the reference, or -1 if they are identical:
+long first_divergence( const trace_t& reference, const trace_t& replay, size_t offset = 0 )
+{
+	for ( size_t k = 0 ; k < reference.size() - offset ; k++ )
+		if ( k >= replay.size() || ! identical( reference[offset+k], replay[k] ) )
+			return ( offset + k + 1 )*check_period;
+	return -1;
+}
+
+
+bool report( const char* name, long divergence )
+{
+	if ( divergence < 0 )
+		printf( " %-9s identical", name );
+	else
+		printf( " %-9s \033[1;31mdiverged at step %ld\033[0;39m", name, divergence );
+	return divergence < 0;
+}
+
+
+// Replay the episode of the scenarios built by make, in parallel on the pool unless it is null. Returns false if any replay diverged:
+template<class R>
+bool check( const char* label, std::function<std::unique_ptr<Step_scenario<R>>()> make, ode::ThreadPool* pool, int n_copies )
+{
+	trace_t reference;
+	record( *make(), 0, reference );
+
+	trace_t serial;
+	record( *make(), 0, serial );
+
+	long parallel_divergence = -1;
+	if ( pool != nullptr )
+	{
+		std::vector<trace_t> copies( n_copies );
+		pool->parallel_for( n_copies, [&]( int i )
+		{
+			record( *make(), 0, copies[i] );
+		} );
+		for ( const trace_t& copy : copies )
+		{
+			long divergence = first_divergence( reference, copy );
+			if ( divergence >= 0 && ( parallel_divergence < 0 || divergence < parallel_divergence ) )
+				parallel_divergence = divergence;
+		}
+	}
+
+	size_t half = reference.size()/2;
+	trace_t restored;
+	{
+		std::unique_ptr<Step_scenario<R>> scenario = make();
+		scenario->restore( reference[half] );
+		record( *scenario, ( half + 1 )*check_period, restored );
+	}
+
+	bool success = true;
+	printf( "%-28s |", label );
+	success &= report( "serial", first_divergence( reference, serial ) );
+	if ( pool != nullptr )
+		success &= report( "parallel", parallel_divergence );
+	else
+		printf( " %-9s skipped", "parallel" );
+	success &= report( "restored", first_divergence( reference, restored, half + 1 ) );
+	printf( "\n" );
+	fflush( stdout );
+	return success;
+}
+
+
+int main( int argc, char* argv[] )
+{
+	float duration( 10 );
+	if ( argc > 1 )
+		duration = atof( argv[1] );
+	uint64_t seed = argc > 2 ? strtoull( argv[2], nullptr, 10 ) : 0;
+	int n_copies = argc > 3 ? atoi( argv[3] ) : 0;
+	const char* path_to_model_dir = argc > 4 ? argv[4] : DEFAULT_PATH_TO_MODEL_DIR;
+
+	dInitODE2( 0 );
+
+	std::vector<ode::env_config> configs( 3 );
+	configs[1].solver = ode::env_config::QUICK_STEP;
+	configs[2].solver = ode::env_config::QUICK_STEP;
+	configs[2].broadphase = ode::env_config::SAP;
+
+	const char* solver_names[] = { "WorldStep", "QuickStep" };
+	const char* broadphase_names[] = { "simple", "hash", "SAP", "quadtree" };
+
+	bool success = true;
+	ode::ThreadPool pool( n_copies );
+	if ( n_copies <= 0 )
+		n_copies = pool.size();
+
+	for ( ode::env_config config : configs )
+	{
+		config.deterministic = true;
+		config.seed = seed;
+
+		std::string label = std::string( solver_names[config.solver] ) + " " + broadphase_names[config.broadphase];
+
+		// No internal control for the bare rover:
+		Step_params params = replay_params( config, duration, false );
+		success &= check<robot::Rover_1>( ( label + " | Rover_1" ).c_str(), [&]()
+		{
+			return std::unique_ptr<Step_scenario<robot::Rover_1>>( new Step_scenario<robot::Rover_1>( params ) );
+		}, &pool, n_copies );
+
+		// Actor without exploration, as the random generator of the rover is not part of its state:
+		Step_params params_tf = replay_params( config, duration, true );
+		success &= check<robot::Rover_1_tf>( ( label + " | Rover_1_tf" ).c_str(), [&]()
+		{
+			return std::unique_ptr<Step_scenario<robot::Rover_1_tf>>( new Step_scenario<robot::Rover_1_tf>( params_tf, path_to_model_dir, 0 ) );
+		}, nullptr, n_copies );
+	}
+
+	dCloseODE();
+
+	return success ? 0 : 1;
+}
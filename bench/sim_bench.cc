@@ -0,0 +1,295 @@
+/*
+** Throughput benchmark of the simulation on reproducible headless scenarios built from the scenes:
+**   flat       Rover driving on flat ground.
+**   step       Two-box step of scene_1_mt.
+**   ramp       Ramp of ramp.cc under the right wheels.
+**   heightmap  Rock step heightmap.
+**   crawling   Crawling gait of Crawler_1.
+**   procedural Seeded procedural terrain streamed around the rover, without ground plane.
+** For each scenario, the simulated seconds per wall-clock second are reported together with
+** the time spent per simulated second in the collision detection, the world solver and the
+** phases of the update of the robot: FT sensors, filters, controller and wheel control ( timed by
+** the profiler, with which the bench is always compiled ), and the peak RSS of the scenario.
+** Each scenario runs in its own child process so that its peak RSS is not that of the previous ones.
+** The detailed profile of each scenario is printed as well.
+**
+** Arguments (optional):
+** Simulated duration of each scenario in seconds ( default: 20 ).
+** Names of the scenarios to run ( default: all ).
+*/
+
+#include "ode/environment.hh"
+#include "ode/box.hh"
+#include "ode/heightfield.hh"
+#include "ode/terrain_generator.hh"
+#include "rover.hh"
+#include <chrono>
+#include <cstring>
+#include <string>
+#include <stdexcept>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+
+#ifndef ENV_DATA_DIR
+#define ENV_DATA_DIR "../env_data/"
+#endif
+
+
+typedef std::chrono::steady_clock bench_clock;
+
+inline double seconds_since( const bench_clock::time_point& start ) { return std::chrono::duration<double>( bench_clock::now() - start ).count(); }
+
+
+// Environment timing separately the two phases of Environment::next_step:
+class Timed_environment : public ode::Environment
+{
+	public:
+
+	Timed_environment( double mu, bool add_ground = true ) : ode::Environment( add_ground, mu ), collision_time( 0 ), solver_time( 0 ) {}
+
+	void next_step( double dt )
+	{
+		auto start = bench_clock::now();
+		{
+			PROFILE_PHASE( COLLISION );
+			_collide();
+		}
+		PROFILE_CONTACTS( _contact_count );
+		collision_time += seconds_since( start );
+
+		start = bench_clock::now();
+		{
+			PROFILE_PHASE( SOLVER );
+			_solve( dt );
+		}
+		solver_time += seconds_since( start );
+	}
+
+	double collision_time;
+	double solver_time;
+};
+
+
+// Robot and terrain of a scenario:
+class Bench_scene
+{
+	public:
+
+	Bench_scene( double mu, bool drive = true, bool add_ground = true ) : env( mu, add_ground ), drive( drive ) {}
+
+	Timed_environment env;
+	boost::shared_ptr<robot::Rover_1> robot;
+	std::vector<ode::Object::ptr_t> terrain;
+	// Tiles following the robot, if any:
+	boost::shared_ptr<ode::Terrain_stream> stream;
+	// Whether the rover is driven at cruise speed or left to its own controller:
+	bool drive;
+
+	void add_terrain( ode::Object* object )
+	{
+		object->fix();
+		object->set_collision_group( "ground" );
+		terrain.push_back( ode::Object::ptr_t( object ) );
+	}
+};
+
+
+Bench_scene* flat_scene()
+{
+	Bench_scene* scene = new Bench_scene( 0.7 );
+	scene->robot = boost::shared_ptr<robot::Rover_1>( new robot::Rover_1( scene->env, Eigen::Vector3d( 0, 0, 0 ) ) );
+	return scene;
+}
+
+
+Bench_scene* step_scene()
+{
+	Bench_scene* scene = new Bench_scene( 0.5 );
+	scene->robot = boost::shared_ptr<robot::Rover_1>( new robot::Rover_1( scene->env, Eigen::Vector3d( 0, 0, 0 ) ) );
+	scene->robot->SetCrawlingMode( true );
+
+	float step_height( 0.105*2 );
+	scene->add_terrain( new ode::Box( scene->env, Eigen::Vector3d( 1, 0, step_height/2 ), 1, 1, 3, step_height, false ) );
+	scene->add_terrain( new ode::Box( scene->env, Eigen::Vector3d( 2, 0, step_height/2 ), 1, 2, 3, step_height, false ) );
+	return scene;
+}
+
+
+Bench_scene* ramp_scene()
+{
+	Bench_scene* scene = new Bench_scene( 0.3 );
+	scene->robot = boost::shared_ptr<robot::Rover_1>( new robot::Rover_1( scene->env, Eigen::Vector3d( 0, 0, 0 ) ) );
+
+	float x( 1.2 ), y( -0.61/2 ), h( 0.16 ), l( 0.21 ), w( 0.40 ), slope( 20 );
+	float l2 = h/sin( slope*M_PI/180 );
+	float h2 = h/cos( slope*M_PI/180 );
+	float x2 = l/2 + sqrt( l2*l2 + h2*h2 )/2 - h*tan( slope*M_PI/180 );
+
+	scene->add_terrain( new ode::Box( scene->env, Eigen::Vector3d( x, y, 0 ), 1, l, w, h*2, false ) );
+	ode::Box* ramp_part2 = new ode::Box( scene->env, Eigen::Vector3d( x + x2, y, 0 ), 1, l2, w, h2, false );
+	ramp_part2->set_rotation( 0, -slope*M_PI/180, 0 );
+	scene->add_terrain( ramp_part2 );
+	ode::Box* ramp_part3 = new ode::Box( scene->env, Eigen::Vector3d( x - x2, y, 0 ), 1, l2, w, h2, false );
+	ramp_part3->set_rotation( 0, slope*M_PI/180, 0 );
+	scene->add_terrain( ramp_part3 );
+	return scene;
+}
+
+
+Bench_scene* heightmap_scene()
+{
+	Bench_scene* scene = new Bench_scene( 0.5 );
+	scene->robot = boost::shared_ptr<robot::Rover_1>( new robot::Rover_1( scene->env, Eigen::Vector3d( 0, 0, 0 ) ) );
+	scene->robot->SetCrawlingMode( true );
+
+	ode::HeightField* field = new ode::HeightField( scene->env, Eigen::Vector3d( 2, 0, -0.01 ), ENV_DATA_DIR "heightmap_rock_step.png", 0.3, 3, 3, 0, -1, 1 );
+	field->set_collision_group( "ground" );
+	scene->terrain.push_back( ode::Object::ptr_t( field ) );
+	return scene;
+}
+
+
+Bench_scene* crawling_scene()
+{
+	Bench_scene* scene = new Bench_scene( 0.6, false );
+	scene->robot = boost::shared_ptr<robot::Rover_1>( new robot::Crawler_1( scene->env, Eigen::Vector3d( 0, 0, 0 ), 30, 2, 10 ) );
+	return scene;
+}
+
+
+Bench_scene* procedural_scene()
+{
+	Bench_scene* scene = new Bench_scene( 0.5, true, false );
+	scene->robot = boost::shared_ptr<robot::Rover_1>( new robot::Rover_1( scene->env, Eigen::Vector3d( 0, 0, 0 ) ) );
+	scene->robot->SetCrawlingMode( true );
+
+	ode::terrain_params params;
+	params.seed = 1;
+	params.tile_size = 1;
+	params.tile_resolution = 32;
+	params.clear_radius = 0.5;
+	scene->stream = boost::shared_ptr<ode::Terrain_stream>( new ode::Terrain_stream( scene->env, ode::Terrain_generator( params ) ) );
+	scene->stream->update( scene->robot->GetPosition() );
+	return scene;
+}
+
+
+typedef struct scenario_t
+{
+	const char* name;
+	Bench_scene* (*build)();
+} scenario_t;
+
+
+const double timestep( 0.001 );
+const float speedf( 0.04 ), term( 0.5 );
+
+
+// Run a scenario and print its line of results:
+void run_scenario( const scenario_t& scenario, float duration )
+{
+	boost::shared_ptr<Bench_scene> scene( scenario.build() );
+	robot::Rover_1& robot = *scene->robot;
+	if ( scene->drive )
+		robot.DeactivateIC();
+
+	ode::profiler::reset();
+
+	double robot_time = 0;
+	float speed = 0;
+	long n_steps = duration/timestep;
+
+	auto start = bench_clock::now();
+	for ( long i = 0 ; i < n_steps ; i++ )
+	{
+		if ( scene->drive && speed < speedf )
+		{
+			speed += speedf/term*timestep;
+			robot.SetRobotSpeed( speed );
+		}
+
+		scene->env.next_step( timestep );
+
+		auto robot_start = bench_clock::now();
+		robot.next_step( timestep );
+		robot_time += seconds_since( robot_start );
+
+		if ( scene->stream )
+			scene->stream->update( robot.GetPosition() );
+	}
+	double wall_time = seconds_since( start );
+
+	// Peak RSS of this child process only:
+	struct rusage usage;
+	getrusage( RUSAGE_SELF, &usage );
+
+	const ode::profiler::counters_t& c = ode::profiler::counters();
+	double other_time = wall_time - scene->env.collision_time - scene->env.solver_time - robot_time;
+	printf( "%-10s %12.2f | %9.2f %9.2f | %9.2f %9.2f %9.2f %9.2f | %9.2f | %7.1f MB\n", scenario.name, duration/wall_time,
+	        scene->env.collision_time/duration*1e3, scene->env.solver_time/duration*1e3,
+	        c.time[ode::profiler::FT_SENSORS]/duration*1e3, c.time[ode::profiler::FILTERS]/duration*1e3,
+	        c.time[ode::profiler::CONTROLLER]/duration*1e3, c.time[ode::profiler::WHEEL_CONTROL]/duration*1e3,
+	        other_time/duration*1e3, usage.ru_maxrss/1024. );
+	if ( scene->stream )
+		printf( "%-10s %ld tiles generated, %d in the environment at the end\n", "", scene->stream->n_generated(), scene->stream->n_tiles() );
+	fflush( stdout );
+
+	if ( ode::profiler::enabled() )
+		ode::profiler::print_summary( stdout, duration );
+}
+
+
+int main( int argc, char* argv[] )
+{
+	float duration( 20 );
+	if ( argc > 1 )
+		duration = atof( argv[1] );
+
+	const scenario_t scenarios[] = { { "flat", flat_scene }, { "step", step_scene }, { "ramp", ramp_scene },
+	                                 { "heightmap", heightmap_scene }, { "crawling", crawling_scene }, { "procedural", procedural_scene } };
+
+	dInitODE();
+
+	printf( "%-10s %12s | %s %s | %s %s %s %s | %s | %10s\n", "scenario", "sim-s/wall-s",
+	        "collision", "   solver", "FT sensor", "  filters", "  control", "   wheels", "    other", "peak RSS" );
+	printf( "%-10s %12s | %73s | %10s\n", "", "", "ms per simulated second", "" );
+	fflush( stdout );
+
+	bool success = true;
+	for ( const scenario_t& scenario : scenarios )
+	{
+		if ( argc > 2 )
+		{
+			bool selected = false;
+			for ( int i = 2 ; i < argc ; i++ )
+				selected |= strcmp( argv[i], scenario.name ) == 0;
+			if ( ! selected )
+				continue;
+		}
+
+		pid_t pid = fork();
+		if ( pid < 0 )
+			throw std::runtime_error( "Could not fork the process of the scenario " + std::string( scenario.name ) );
+		if ( pid == 0 )
+		{
+			run_scenario( scenario, duration );
+			dCloseODE();
+			_exit( 0 );
+		}
+
+		int status;
+		waitpid( pid, &status, 0 );
+		if ( ! WIFEXITED( status ) || WEXITSTATUS( status ) != 0 )
+		{
+			printf( "%-10s \033[1;31mfailed\033[0;39m\n", scenario.name );
+			fflush( stdout );
+			success = false;
+		}
+	}
+
+	dCloseODE();
+
+	return success ? 0 : 1;
+}
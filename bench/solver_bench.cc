@@ -0,0 +1,127 @@
+/*
+** Benchmark of the world solvers and collision spaces of ode::Environment.
+** The rover of scene_1_mt drives over the step for a fixed duration with each combination
+** and the wall time per simulated second is reported together with the drift of the final
+** state with respect to the big-matrix solver with a hash space.
+**
+** Argument (optional):
+** Simulated duration in seconds ( default: 30 ).
+*/
+
+#include "step_scenario.hh"
+#include <chrono>
+
+
+typedef struct result_t
+{
+	double wall_time_per_sim_s;
+	Eigen::Vector3d final_pos;
+	double final_direction;
+	std::vector<double> final_state;
+} result_t;
+
+
+result_t run( const ode::env_config& config, float duration )
+{
+	Step_params params;
+	params.config = config;
+	params.timeout = duration;
+	params.x_goal = 100;
+	params.y_max = 100;
+	// No internal control for the bare rover:
+	params.IC_start = duration + 1;
+
+	Step_scenario<robot::Rover_1> scenario( params );
+
+	const float timestep( 0.001 );
+	auto start = std::chrono::steady_clock::now();
+	while ( ! scenario.next_step( timestep ) );
+	double wall_time = std::chrono::duration<double>( std::chrono::steady_clock::now() - start ).count();
+
+	return { wall_time/scenario.GetTime( timestep ), scenario.robot.GetPosition(), scenario.robot.GetDirection(), scenario.env.snapshot() };
+}
+
+
+// Largest difference between the body positions of two environment snapshots:
+double max_position_drift( const std::vector<double>& s1, const std::vector<double>& s2 )
+{
+	double drift = 0;
+	for ( size_t i = 1 ; i + ode::Environment::body_state_size <= std::min( s1.size(), s2.size() ) ; i += ode::Environment::body_state_size )
+		for ( int j = 0 ; j < 3 ; j++ )
+			drift = std::max( drift, fabs( s1[i+j] - s2[i+j] ) );
+	return drift;
+}
+
+
+int main( int argc, char* argv[] )
+{
+	float duration( 30 );
+	if ( argc > 1 )
+		duration = atof( argv[1] );
+
+	dInitODE();
+
+	const char* solver_names[] = { "WorldStep", "QuickStep" };
+	const char* broadphase_names[] = { "simple", "hash", "SAP", "quadtree" };
+
+	std::vector<ode::env_config> configs;
+
+	ode::env_config reference;
+	configs.push_back( reference );
+
+	for ( int broadphase : { ode::env_config::SIMPLE, ode::env_config::SAP, ode::env_config::QUADTREE } )
+	{
+		ode::env_config config;
+		config.broadphase = ode::env_config::broadphase_t( broadphase );
+		configs.push_back( config );
+	}
+
+	for ( int levels : { 0, 1 } )
+	{
+		ode::env_config config;
+		config.hash_min_level = levels ? -5 : -2;
+		config.hash_max_level = levels ? 2 : 4;
+		configs.push_back( config );
+	}
+
+	for ( int iterations : { 10, 20, 50 } )
+		for ( int broadphase : { ode::env_config::HASH, ode::env_config::SAP } )
+		{
+			ode::env_config config;
+			config.solver = ode::env_config::QUICK_STEP;
+			config.quickstep_iterations = iterations;
+			config.broadphase = ode::env_config::broadphase_t( broadphase );
+			configs.push_back( config );
+		}
+
+	ode::env_config auto_disable;
+	auto_disable.auto_disable = true;
+	configs.push_back( auto_disable );
+
+	printf( "%-10s %4s %4s %-9s %-7s %-5s | %10s | %10s %10s %10s\n",
+	        "solver", "iter", "sor", "space", "levels", "a-dis", "ms/sim s", "x drift", "dir drift", "max drift" );
+
+	result_t ref;
+	for ( size_t i = 0 ; i < configs.size() ; i++ )
+	{
+		const ode::env_config& c = configs[i];
+		result_t r = run( c, duration );
+		if ( i == 0 )
+			ref = r;
+
+		char levels[16] = "";
+		if ( c.broadphase == ode::env_config::HASH )
+			snprintf( levels, sizeof( levels ), "%d:%d", c.hash_min_level, c.hash_max_level );
+
+		printf( "%-10s %4d %4.1f %-9s %-7s %-5s | %10.2f | %10.2e %10.2e %10.2e\n",
+		        solver_names[c.solver], c.solver == ode::env_config::QUICK_STEP ? c.quickstep_iterations : 0, c.quickstep_sor,
+		        broadphase_names[c.broadphase], levels, c.auto_disable ? "on" : "off",
+		        r.wall_time_per_sim_s*1e3,
+		        ( r.final_pos - ref.final_pos ).norm(), fabs( r.final_direction - ref.final_direction ), max_position_drift( r.final_state, ref.final_state ) );
+		fflush( stdout );
+	}
+
+	dCloseODE();
+
+	return 0;
+}
@@ -0,0 +1,160 @@
+/*
+** Copyright (C) 2021 Arthur BOUTON
+**
+** This program is free software: you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation, version 3.
+**
+** This program is distributed in the hope that it will be useful, but
+** WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+** General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "actuator_bank.hh"
+#include <algorithm>
+#include <cmath>
+
+
+namespace ode
+{
+
+
+int Actuator_bank::add( dJointID hinge, mode_t mode, double torque_max, double torque_speed_ratio, double vel_max, double Kp, double min, double max )
+{
+	_joint.push_back( hinge );
+	_mode.push_back( mode );
+	_torque_max.push_back( torque_max );
+	_torque_speed_ratio.push_back( torque_speed_ratio );
+	_vel_max.push_back( vel_max );
+	_Kp.push_back( Kp );
+	_min.push_back( min );
+	_max.push_back( max );
+	_target.push_back( 0 );
+
+	_angle.push_back( 0 );
+	_rate.push_back( 0 );
+	_vel_cmd.push_back( 0 );
+	_fmax_cmd.push_back( 0 );
+	_torque_cmd.push_back( 0 );
+
+	return _joint.size() - 1;
+}
+
+
+double Actuator_bank::set_position( int i, double angle )
+{
+	_mode[i] = POSITION;
+	_target[i] = std::min( std::max( _min[i], angle ), _max[i] );
+	return _target[i];
+}
+
+
+double Actuator_bank::set_velocity( int i, double vel )
+{
+	_mode[i] = VELOCITY;
+	_target[i] = std::min( std::max( -_vel_max[i], vel ), _vel_max[i] );
+	return _target[i];
+}
+
+
+double Actuator_bank::set_torque( int i, double torque )
+{
+	_mode[i] = TORQUE;
+	_target[i] = std::min( std::max( -_torque_max[i], torque ), _torque_max[i] );
+	return _target[i];
+}
+
+
+void Actuator_bank::set_passive( int i )
+{
+	_mode[i] = PASSIVE;
+	_target[i] = 0;
+}
+
+
+void Actuator_bank::update( double dt )
+{
+	const int n = _joint.size();
+
+	for ( int i = 0 ; i < n ; i++ )
+	{
+		_angle[i] = dJointGetHingeAngle( _joint[i] );
+		_rate[i] = dJointGetHingeAngleRate( _joint[i] );
+	}
+
+	for ( int i = 0 ; i < n ; i++ )
+	{
+		// Torque available at the current speed:
+		double fmax = std::max( 0., _torque_max[i] - _torque_speed_ratio[i]*fabs( _rate[i] ) );
+		double vel = 0;
+		double torque = 0;
+
+		switch ( _mode[i] )
+		{
+			case POSITION :
+				vel = _Kp[i]/dt*( _target[i] - _angle[i] );
+				vel = std::min( std::max( -_vel_max[i], vel ), _vel_max[i] );
+				break;
+
+			case VELOCITY :
+				vel = _target[i];
+				// Stop at the limits:
+				if ( ( _angle[i] <= _min[i] && vel < 0 ) || ( _angle[i] >= _max[i] && vel > 0 ) )
+					vel = 0;
+				break;
+
+			case TORQUE :
+				torque = std::min( std::max( -fmax, _target[i] ), fmax );
+				// The motor must not brake the joint:
+				fmax = 0;
+				break;
+
+			case PASSIVE :
+				fmax = 0;
+				break;
+		}
+
+		_vel_cmd[i] = vel;
+		_fmax_cmd[i] = fmax;
+		_torque_cmd[i] = torque;
+	}
+
+	for ( int i = 0 ; i < n ; i++ )
+	{
+		dJointSetHingeParam( _joint[i], dParamFMax, _fmax_cmd[i] );
+		dJointSetHingeParam( _joint[i], dParamVel, _vel_cmd[i] );
+		if ( _torque_cmd[i] != 0 )
+			dJointAddHingeTorque( _joint[i], _torque_cmd[i] );
+	}
+}
+
+
+void Actuator_bank::save_state( double* state ) const
+{
+	for ( size_t i = 0 ; i < _joint.size() ; i++, state += state_size )
+	{
+		state[0] = _target[i];
+		state[1] = _mode[i];
+		state[2] = dJointGetHingeParam( _joint[i], dParamVel );
+		state[3] = dJointGetHingeParam( _joint[i], dParamFMax );
+	}
+}
+
+
+void Actuator_bank::load_state( const double* state )
+{
+	for ( size_t i = 0 ; i < _joint.size() ; i++, state += state_size )
+	{
+		_target[i] = state[0];
+		_mode[i] = mode_t( state[1] );
+		dJointSetHingeParam( _joint[i], dParamVel, state[2] );
+		dJointSetHingeParam( _joint[i], dParamFMax, state[3] );
+	}
+}
+
+
+}
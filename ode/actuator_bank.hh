@@ -0,0 +1,100 @@
+/*
+** Copyright (C) 2021 Arthur BOUTON
+**
+** This program is free software: you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation, version 3.
+**
+** This program is distributed in the hope that it will be useful, but
+** WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+** General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef ACTUATOR_BANK_HH
+#define ACTUATOR_BANK_HH
+
+#include <ode/ode.h>
+#include <vector>
+
+
+namespace ode
+{
+
+
+/// Motors of the hinge joints of a robot, updated together at every step.
+/// The parameters and commands are stored by kind ( structure of arrays ) so that the control laws
+/// are computed in a single loop, between one pass reading the joints and one pass writing the motor parameters.
+/// Each motor follows a linear torque-speed curve: the torque available is torque_max at rest and
+/// decreases by torque_speed_ratio per rad/s of the joint rate.
+/// The joints are not owned by the bank.
+class Actuator_bank
+{
+	public:
+
+	typedef enum { POSITION, VELOCITY, TORQUE, PASSIVE } mode_t;
+
+	/// Number of values saved by save_state for each actuator
+	static const int state_size = 4;
+
+	/// Register a hinge and return its index in the bank.
+	/// In position mode, the velocity command is Kp/dt times the angle error. The angles are bounded by [ min, max ].
+	int add( dJointID hinge, mode_t mode = VELOCITY, double torque_max = dInfinity, double torque_speed_ratio = 0,
+	         double vel_max = dInfinity, double Kp = 1, double min = -dInfinity, double max = dInfinity );
+
+	inline int size() const { return _joint.size(); }
+	inline dJointID get_joint( int i ) const { return _joint[i]; }
+	inline mode_t get_mode( int i ) const { return _mode[i]; }
+	inline double get_target( int i ) const { return _target[i]; }
+
+	/// Commands, bounded by the parameters of the actuator and applied at the next update:
+	double set_position( int i, double angle );
+	double set_velocity( int i, double vel );
+	double set_torque( int i, double torque );
+	void set_passive( int i );
+
+	inline void set_torque_max( int i, double torque_max, double torque_speed_ratio = 0 ) { _torque_max[i] = torque_max; _torque_speed_ratio[i] = torque_speed_ratio; }
+	inline void set_vel_max( int i, double vel_max ) { _vel_max[i] = vel_max; }
+	inline void set_Kp( int i, double Kp ) { _Kp[i] = Kp; }
+	inline void set_limits( int i, double min, double max ) { _min[i] = min; _max[i] = max; }
+
+	/// Current state of the joint, read from ODE.
+	inline double get_angle( int i ) const { return dJointGetHingeAngle( _joint[i] ); }
+	inline double get_rate( int i ) const { return dJointGetHingeAngleRate( _joint[i] ); }
+
+	/// Apply the commands to the motors.
+	void update( double dt );
+
+	/// Save the commands and the motor parameters of the joints
+	void save_state( double* state ) const;
+	void load_state( const double* state );
+
+	protected:
+
+	// Joints and parameters:
+	std::vector<dJointID> _joint;
+	std::vector<mode_t> _mode;
+	std::vector<double> _torque_max;
+	std::vector<double> _torque_speed_ratio;
+	std::vector<double> _vel_max;
+	std::vector<double> _Kp;
+	std::vector<double> _min;
+	std::vector<double> _max;
+	// Angle, velocity or torque depending on the mode:
+	std::vector<double> _target;
+
+	// Buffers of the updates:
+	std::vector<double> _angle;
+	std::vector<double> _rate;
+	std::vector<double> _vel_cmd;
+	std::vector<double> _fmax_cmd;
+	std::vector<double> _torque_cmd;
+};
+
+
+}
+
+#endif
@@ -0,0 +1,86 @@
+/*
+** Copyright (C) 2021 Arthur BOUTON
+**
+** This program is free software: you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation, version 3.
+**
+** This program is distributed in the hope that it will be useful, but
+** WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+** General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef ARENA_HH
+#define ARENA_HH
+
+#include <vector>
+#include <stdexcept>
+#include <new>
+#include <cstddef>
+#include <utility>
+
+
+namespace ode
+{
+
+
+/// Fixed-capacity region of memory in which objects are constructed next to each other
+/// and destroyed together, in the reverse order of their creation, with the arena.
+/// The objects never move, so that the pointers returned by create stay valid for the lifetime of the arena.
+class Arena
+{
+	public:
+
+	static constexpr size_t alignment = alignof( std::max_align_t );
+
+	// The memory returned by operator new is suitably aligned for any fundamental type:
+	Arena( size_t capacity ) : _memory( (char*) ::operator new( capacity ) ), _capacity( capacity ), _used( 0 ) {}
+
+	Arena( const Arena& ) = delete;
+	Arena& operator=( const Arena& ) = delete;
+
+	/// Construct an object of type T in the arena. A std::length_error is thrown if the capacity is exceeded.
+	template<class T, class... Args>
+	T* create( Args&&... args )
+	{
+		static_assert( alignof( T ) <= alignment, "Over-aligned type" );
+
+		size_t offset = ( _used + alignof( T ) - 1 )/alignof( T )*alignof( T );
+		if ( offset + sizeof( T ) > _capacity )
+			throw std::length_error( "Arena capacity exceeded" );
+
+		T* object = new ( _memory + offset ) T( std::forward<Args>( args )... );
+		_used = offset + sizeof( T );
+		_destructors.push_back( std::make_pair( (void*) object, &_destroy<T> ) );
+		return object;
+	}
+
+	inline size_t capacity() const { return _capacity; }
+	inline size_t used() const { return _used; }
+
+	~Arena()
+	{
+		for ( auto it = _destructors.rbegin() ; it != _destructors.rend() ; ++it )
+			it->second( it->first );
+		::operator delete( _memory );
+	}
+
+	protected:
+
+	template<class T>
+	static void _destroy( void* object ) { static_cast<T*>( object )->~T(); }
+
+	char* _memory;
+	size_t _capacity;
+	size_t _used;
+	std::vector<std::pair<void*,void(*)(void*)>> _destructors;
+};
+
+
+}
+
+#endif
@@ -17,6 +17,10 @@
 */
 
 #include <Eigen/Geometry>
+#include <atomic>
+#include <map>
+#include <mutex>
+#include <string>
 
 #include "environment.hh"
 #include "object.hh"
@@ -26,14 +30,78 @@ namespace ode
 {
 
 
+  namespace
+  {
+    std::mutex collision_groups_mutex;
+    std::map<std::string,int> collision_groups = { { "", 0 } };
+     //the random generator of ODE is shared by the whole process
+    std::mutex rand_mutex;
+     //worlds whose QuickSteps draw from a seeded sequence of the random generator
+    std::atomic<int> deterministic_quicksteps(0);
+  }
+
+   //geoms without collision feature belong to the empty group and have hard contacts
+  static const collision_feature no_collision_feature( HARD );
+
+  int intern_collision_group(const char* group)
+  {
+    std::lock_guard<std::mutex> lock(collision_groups_mutex);
+    auto it = collision_groups.find(group);
+    if (it != collision_groups.end())
+      return it->second;
+    int id = collision_groups.size();
+    if (id >= max_collision_groups)
+      throw std::runtime_error(std::string("Too many collision groups to add ") + group);
+    collision_groups[group] = id;
+    return id;
+  }
+
+  uint64_t derive_seed(uint64_t seed, uint64_t stream)
+  {
+    uint64_t z = seed + (stream + 1)*0x9e3779b97f4a7c15ULL;
+    z = (z ^ (z >> 30))*0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27))*0x94d049bb133111ebULL;
+    return z ^ (z >> 31);
+  }
+
+
   void Environment::_init(bool add_ground, double _angle)
   {
      //create world
     _world_id = dWorldCreate();
      //init gravity
     dWorldSetGravity(_world_id, 0, 0, -cst::g);
+     //solver
+    dWorldSetQuickStepNumIterations(_world_id, _config.quickstep_iterations);
+    dWorldSetQuickStepW(_world_id, _config.quickstep_sor);
+     //auto-disabling of the bodies at rest
+    dWorldSetAutoDisableFlag(_world_id, _config.auto_disable);
+    dWorldSetAutoDisableLinearThreshold(_world_id, _config.auto_disable_linear_threshold);
+    dWorldSetAutoDisableAngularThreshold(_world_id, _config.auto_disable_angular_threshold);
+    dWorldSetAutoDisableSteps(_world_id, _config.auto_disable_steps);
+    dWorldSetAutoDisableTime(_world_id, _config.auto_disable_time);
+    if (_config.deterministic && _config.solver == env_config::QUICK_STEP)
+      _count_deterministic_quicksteps(1);
      //space
-    _space_id = dHashSpaceCreate(0);
+    switch (_config.broadphase)
+    {
+      case env_config::SIMPLE:
+        _space_id = dSimpleSpaceCreate(0);
+        break;
+      case env_config::SAP:
+        _space_id = dSweepAndPruneSpaceCreate(0, _config.sap_axis_order);
+        break;
+      case env_config::QUADTREE:
+      {
+        dVector3 center = { _config.quadtree_center[0], _config.quadtree_center[1], _config.quadtree_center[2] };
+        dVector3 extents = { _config.quadtree_extents[0], _config.quadtree_extents[1], _config.quadtree_extents[2] };
+        _space_id = dQuadTreeSpaceCreate(0, center, extents, _config.quadtree_depth);
+        break;
+      }
+      default:
+        _space_id = dHashSpaceCreate(0);
+        dHashSpaceSetLevels(_space_id, _config.hash_min_level, _config.hash_max_level);
+    }
      //ground
     if (add_ground)
     {
@@ -48,15 +116,99 @@ namespace ode
     }
      //contact group1
     _contactgroup = dJointGroupCreate(0);
+    _contact_count = 0;
+    _step_count = 0;
+
+     //geoms of a same group do not collide
+    for (int i = 0; i < max_collision_groups; i++)
+      _group_filter[i] = ~(uint64_t(1) << i);
+
+    set_material(HARD, _mu);
+    set_material(SOFT, _mu, 0.005, 0.4);
+    //set_material(SOFT, _mu, 0.02, 0.5);
+    //set_material(SOFT, _mu, 0.01, 0.8);
 
     //dWorldSetContactMaxCorrectingVel(_world_id, 100);
 
     //dWorldSetContactSurfaceLayer(_world_id, 0.001);
   }
-  void Environment::_collision(dGeomID o1, dGeomID o2)
+  void Environment::snapshot(std::vector<double>& buffer) const
+  {
+    buffer.push_back(_objects.size());
+    for (const Object* o : _objects)
+    {
+      dBodyID b = o->get_body();
+      const dReal* v[] = { dBodyGetPosition(b), dBodyGetQuaternion(b), dBodyGetLinearVel(b), dBodyGetAngularVel(b), dBodyGetForce(b), dBodyGetTorque(b) };
+      const int n[] = { 3, 4, 3, 3, 3, 3 };
+      for (int i = 0; i < 6; i++)
+        buffer.insert(buffer.end(), v[i], v[i] + n[i]);
+      buffer.push_back(dBodyIsEnabled(b));
+    }
+    buffer.push_back(_step_count);
+  }
+  const double* Environment::restore(const double* data)
+  {
+    if (size_t(*data++) != _objects.size())
+      throw std::runtime_error("Snapshot incompatible with the current environment");
+    for (Object* o : _objects)
+    {
+      dBodyID b = o->get_body();
+      dBodySetPosition(b, data[0], data[1], data[2]);
+      dBodySetQuaternion(b, data + 3);
+      dBodySetLinearVel(b, data[7], data[8], data[9]);
+      dBodySetAngularVel(b, data[10], data[11], data[12]);
+      dBodySetForce(b, data[13], data[14], data[15]);
+      dBodySetTorque(b, data[16], data[17], data[18]);
+      if (data[19])
+        dBodyEnable(b);
+      else
+        dBodyDisable(b);
+      data += body_state_size;
+    }
+    _step_count = *data++;
+    dJointGroupEmpty(_contactgroup);
+    return data;
+  }
+  void Environment::set_group_collision(const char* group_1, const char* group_2, bool collide)
+  {
+    int i = intern_collision_group(group_1);
+    int j = intern_collision_group(group_2);
+    if (collide)
+    {
+      _group_filter[i] |= uint64_t(1) << j;
+      _group_filter[j] |= uint64_t(1) << i;
+    }
+    else
+    {
+      _group_filter[i] &= ~(uint64_t(1) << j);
+      _group_filter[j] &= ~(uint64_t(1) << i);
+    }
+  }
+  bool Environment::get_group_collision(const char* group_1, const char* group_2) const
+  {
+    return _group_filter[intern_collision_group(group_1)] >> intern_collision_group(group_2) & 1;
+  }
+  void Environment::set_material(contact_type type, double mu, double soft_cfm, double soft_erp)
   {
-	contact_type type = HARD;
+    assert(type != DISABLED);
+    _materials[type] = { mu, soft_cfm, soft_erp };
 
+    dSurfaceParameters& surface = _surfaces[type];
+    surface = dSurfaceParameters();
+    surface.mode = dContactApprox1;
+    //surface.mode = dContactApprox1 | dContactSlip1 | dContactSlip2;
+    surface.mu = mu;
+    //surface.slip1 = 0.5;
+    //surface.slip2 = 0.5;
+    if (type == SOFT)
+    {
+      surface.mode |= dContactSoftCFM | dContactSoftERP;
+      surface.soft_cfm = soft_cfm;
+      surface.soft_erp = soft_erp;
+    }
+  }
+  void Environment::_collision(dGeomID o1, dGeomID o2)
+  {
 	collision_feature* o1_collision_feature = (collision_feature*) dGeomGetData( o1 );
 	collision_feature* o2_collision_feature = (collision_feature*) dGeomGetData( o2 );
 
@@ -66,67 +218,32 @@ namespace ode
 	if ( o2_collision_feature != NULL && o2_collision_feature->callback )
 		o2_collision_feature->callback( o1_collision_feature );
 
+	const collision_feature* f1 = o1_collision_feature != NULL ? o1_collision_feature : &no_collision_feature;
+	const collision_feature* f2 = o2_collision_feature != NULL ? o2_collision_feature : &no_collision_feature;
 
-	if ( o1_collision_feature == NULL && o2_collision_feature == NULL )
+	if ( !( _group_filter[f1->group_id] >> f2->group_id & 1 ) )
 		return;
-	else if ( o1_collision_feature != NULL && o2_collision_feature != NULL )
-	{
-		if ( o1_collision_feature->type == DISABLED || o2_collision_feature->type == DISABLED )
-			return;
-		else if ( strcmp( o1_collision_feature->group, o2_collision_feature->group ) == 0 )
-			return;
-		else if ( o1_collision_feature->type == SOFT || o2_collision_feature->type == SOFT )
-			type = SOFT;
-	}
-	else if ( o1_collision_feature != NULL )
-	{
-		if ( *o1_collision_feature->group == '\0' )
-			return;
-		else if ( o1_collision_feature->type == DISABLED )
-			return;
-		else if ( o1_collision_feature->type == SOFT )
-			type = SOFT;
-	}
-	else
-	{
-		if ( *o2_collision_feature->group == '\0' )
-			return;
-		else if ( o2_collision_feature->type == DISABLED )
-			return;
-		else if ( o2_collision_feature->type == SOFT )
-			type = SOFT;
-	}
-		
-
-    static const int N = 10;
-    int i, n;
-    dContact contact[N];
-    n = dCollide(o1, o2, N, &contact[0].geom, sizeof(dContact));
-
-    if (n > 0)
-    {
-      for (i = 0; i < n; i++)
+
+	// The softest contact type prevails ( HARD < SOFT < DISABLED ):
+	int type = std::max( f1->type, f2->type );
+	if ( type == DISABLED )
+		return;
+
+    int n = dCollide(o1, o2, max_contacts, &_contacts[0].geom, sizeof(dContact));
+
+      for (int i = 0; i < n; i++)
       {
-        contact[i].surface.mode = dContactApprox1;
-        //contact[i].surface.mode = dContactApprox1 | dContactSlip1 | dContactSlip2;
-        contact[i].surface.mu = _mu;
-        //contact[i].surface.slip1 = 0.5;
-        //contact[i].surface.slip2 = 0.5;
-
-		if ( type == SOFT )
-		{
-			contact[i].surface.mode |= dContactSoftCFM | dContactSoftERP;
-			//contact[i].surface.soft_cfm = 0.02;
-			//contact[i].surface.soft_erp = 0.5;
-			contact[i].surface.soft_cfm = 0.005;
-			contact[i].surface.soft_erp = 0.4;
-			//contact[i].surface.soft_cfm = 0.01;
-			//contact[i].surface.soft_erp = 0.8;
-		}
-
-        dJointID c = dJointCreateContact( get_world(), get_contactgroup(), &contact[i] );
-        dJointAttach( c, dGeomGetBody( contact[i].geom.g1 ), dGeomGetBody( contact[i].geom.g2 ) );
+        _contacts[i].surface = _surfaces[type];
+
+        // the joints are created once the whole space has been traversed:
+        if (_config.deterministic)
+        {
+          _sorted_contacts.push_back(_contacts[i]);
+          continue;
+        }
 
+        dJointID c = dJointCreateContact( get_world(), get_contactgroup(), &_contacts[i] );
+        dJointAttach( c, dGeomGetBody( _contacts[i].geom.g1 ), dGeomGetBody( _contacts[i].geom.g2 ) );
 
         // grass
         // dBodyID obj = 0;
@@ -146,7 +263,75 @@ namespace ode
         //      std::cout<<"vel:"<<vel[0]<<std::endl;
         //   }
       }
+    _contact_count += n > 0 ? n : 0;
+  }
+  void Environment::_create_sorted_contacts()
+  {
+     // the contacts are ordered by their geometry, then by the classes of their geoms and the indices of
+     // the objects of their bodies, so that neither the traversal order of the broadphase nor the addresses
+     // of the geoms have any influence on the solver
+    if (_sorted_contacts.size() > 1)
+    {
+      std::map<dBodyID,int> body_indices;
+      for (size_t i = 0; i < _objects.size(); i++)
+        if (_objects[i]->get_body())
+          body_indices[_objects[i]->get_body()] = i;
+      auto body_index = [&body_indices](dGeomID g)
+      {
+        auto it = body_indices.find(dGeomGetBody(g));
+        return it != body_indices.end() ? it->second : -1;
+      };
+      std::stable_sort(_sorted_contacts.begin(), _sorted_contacts.end(), [&body_index](const dContact& a, const dContact& b)
+      {
+        const dReal* ka[] = { a.geom.pos, a.geom.normal };
+        const dReal* kb[] = { b.geom.pos, b.geom.normal };
+        for (int k = 0; k < 2; k++)
+          for (int i = 0; i < 3; i++)
+            if (ka[k][i] != kb[k][i])
+              return ka[k][i] < kb[k][i];
+        if (a.geom.depth != b.geom.depth)
+          return a.geom.depth < b.geom.depth;
+        int ta[] = { dGeomGetClass(a.geom.g1), dGeomGetClass(a.geom.g2), body_index(a.geom.g1), body_index(a.geom.g2) };
+        int tb[] = { dGeomGetClass(b.geom.g1), dGeomGetClass(b.geom.g2), body_index(b.geom.g1), body_index(b.geom.g2) };
+        return std::lexicographical_compare(ta, ta + 4, tb, tb + 4);
+      });
+    }
+    for (dContact& contact : _sorted_contacts)
+    {
+      dJointID c = dJointCreateContact(get_world(), get_contactgroup(), &contact);
+      dJointAttach(c, dGeomGetBody(contact.geom.g1), dGeomGetBody(contact.geom.g2));
+    }
+    _sorted_contacts.clear();
+  }
+  void Environment::_count_deterministic_quicksteps(int delta)
+  {
+    deterministic_quicksteps += delta;
+  }
+  void Environment::_solve(double dt)
+  {
+    if (_config.solver == env_config::QUICK_STEP)
+    {
+      if (_config.deterministic)
+      {
+         //dRandInt is called throughout the step, which serialises the deterministic QuickSteps of all the worlds
+        std::lock_guard<std::mutex> lock(rand_mutex);
+        dRandSetSeed(derive_seed(_config.seed, _step_count));
+        dWorldQuickStep(_world_id, dt);
+      }
+      else if (deterministic_quicksteps > 0)
+      {
+         //keep off the seeded sequence of the deterministic worlds
+        std::lock_guard<std::mutex> lock(rand_mutex);
+        dWorldQuickStep(_world_id, dt);
+      }
+      else
+        dWorldQuickStep(_world_id, dt);
     }
+    else
+      dWorldStep(_world_id, dt);
+     // remove all contact joints
+    dJointGroupEmpty(_contactgroup);
+    _step_count++;
   }
 
 
@@ -25,7 +25,12 @@
 #include <ode/ode.h>
 #include <ode/common.h>
 #include <set>
+#include <vector>
+#include <functional>
+#include <cstdint>
+#include <algorithm>
 #include "misc.hh"
+#include "profiler.hh"
 
 namespace ode
 {
@@ -38,16 +43,75 @@ namespace ode
 		DISABLED
 	} contact_type;
 
+	/// Maximal number of distinct collision groups ( group filters are stored as 64-bit masks )
+	static const int max_collision_groups = 64;
+
+	/// Integer identifier of a collision group, shared by all the environments of the process.
+	/// The empty group "" has the identifier 0.
+	int intern_collision_group( const char* group );
+
+	/// Seed of an independent stream derived from a base seed ( splitmix64 ), e.g. one per scenario of a batch
+	uint64_t derive_seed( uint64_t seed, uint64_t stream );
+
 	typedef struct collision_feature
 	{
 		const char* group;
+		int group_id;
 		contact_type type;
 		std::function<void(collision_feature*)> callback;
-		collision_feature( const char* arg ) : group( arg ) {}
-		collision_feature( contact_type arg ) : group( "\0" ), type( arg ) {}
-		collision_feature( std::function<void(collision_feature*)> arg ) : group( "\0" ), callback( arg ) {}
+		collision_feature( const char* arg ) : group( arg ), group_id( intern_collision_group( arg ) ), type( HARD ) {}
+		collision_feature( contact_type arg ) : group( "\0" ), group_id( 0 ), type( arg ) {}
+		collision_feature( std::function<void(collision_feature*)> arg ) : group( "\0" ), group_id( 0 ), type( HARD ), callback( arg ) {}
+		void set_group( const char* arg ) { group = arg; group_id = intern_collision_group( arg ); }
 	} collision_feature;
 
+	/// Surface parameters applied to the contacts of a given contact type
+	typedef struct contact_material
+	{
+		double mu;
+		double soft_cfm;
+		double soft_erp;
+	} contact_material;
+
+
+	/// Choice of the world solver, of the collision space and of the auto-disabling of the bodies
+	typedef struct env_config
+	{
+		/// big-matrix solver ( dWorldStep ) or iterative solver ( dWorldQuickStep )
+		typedef enum { WORLD_STEP, QUICK_STEP } solver_t;
+		/// broadphase of the collision space
+		typedef enum { SIMPLE, HASH, SAP, QUADTREE } broadphase_t;
+
+		solver_t solver = WORLD_STEP;
+		int quickstep_iterations = 20;
+		double quickstep_sor = 1.3;
+
+		broadphase_t broadphase = HASH;
+		int hash_min_level = -3;
+		int hash_max_level = 10;
+		int sap_axis_order = dSAP_AXES_XYZ;
+		double quadtree_center[3] = { 0, 0, 0 };
+		double quadtree_extents[3] = { 20, 20, 10 };
+		int quadtree_depth = 6;
+
+		bool auto_disable = false;
+		double auto_disable_linear_threshold = 0.01;
+		double auto_disable_angular_threshold = 0.01;
+		int auto_disable_steps = 10;
+		double auto_disable_time = 0;
+
+		/// reproducible stepping: the contacts are created in an order independent of the broadphase
+		/// and the random reordering of the constraints by QuickStep is seeded from seed and the step count.
+		/// As the random generator of ODE is global, a deterministic QuickStep holds a process-wide lock for
+		/// the whole solver step: the worlds of a VecEnvironment using it are solved one at a time, and only
+		/// their collision passes run in parallel. WorldStep does not draw random numbers and is not affected.
+		/// As long as a deterministic QuickStep world exists, the non-deterministic QuickSteps of the other
+		/// worlds take the same lock so that they do not draw from the seeded sequence; only the QuickSteps
+		/// already running when the deterministic world is created may still do so.
+		bool deterministic = false;
+		uint64_t seed = 0;
+	} env_config;
+
 
   class Object;
    //singleton : only one env
@@ -94,6 +158,12 @@ namespace ode
         _init(add_ground);
       }
 
+    Environment(const env_config& config, double mu = 0.7, bool add_ground = true) :
+        _ground(0x0), _pitch(0), _roll(0), _z(0), _mu(mu), _config(config)
+      {
+        _init(add_ground);
+      }
+
      ~Environment()
       {
 
@@ -105,6 +175,8 @@ namespace ode
         dSpaceDestroy(get_space());
         dWorldDestroy(get_world());
         dJointGroupDestroy(_contactgroup);
+        if (_config.deterministic && _config.solver == env_config::QUICK_STEP)
+          _count_deterministic_quicksteps(-1);
       }
        //interfaces
       dWorldID get_world()        const
@@ -127,12 +199,14 @@ namespace ode
       void next_step(double dt = time_step)
       {
          //check collisions
-        dSpaceCollide(_space_id, (void *)this, &_near_callback);
+        {
+          PROFILE_PHASE(COLLISION);
+          _collide();
+        }
+        PROFILE_CONTACTS(_contact_count);
          //next step
-        dWorldStep(_world_id, dt);
-         //dWorldQuickStep(_world_id, dt);
-         // remove all contact joints
-        dJointGroupEmpty(_contactgroup);
+        PROFILE_PHASE(SOLVER);
+        _solve(dt);
       }
       void disable_gravity()
       {
@@ -142,9 +216,40 @@ namespace ode
       {
         dWorldSetGravity(_world_id, x, y, z);
       }
+       //collision filtering between groups ( by default, geoms collide only with geoms of other groups )
+      void set_group_collision(const char* group_1, const char* group_2, bool collide);
+      bool get_group_collision(const char* group_1, const char* group_2) const;
+       //surface parameters of the contacts involving a given contact type ( SOFT prevails over HARD )
+      void set_material(contact_type type, double mu, double soft_cfm = 0, double soft_erp = 0);
+      const contact_material& get_material(contact_type type) const { return _materials[type]; }
+       //number of contact joints created during the last step
+      int get_contact_count() const { return _contact_count; }
+       //number of calls to next_step since the creation of the world ( saved in the snapshots )
+      unsigned long get_step_count() const { return _step_count; }
+      static const int max_contacts = 10;
+      const env_config& get_config() const { return _config; }
       double get_pitch() const { return _pitch; }
       double get_roll() const { return _roll; }
       double get_z() const { return _z; }
+       //objects owning a body in this world ( maintained by Object )
+      void add_object(Object* o) { _objects.push_back(o); }
+      void remove_object(Object* o)
+      {
+        _objects.erase(std::remove(_objects.begin(), _objects.end(), o), _objects.end());
+      }
+      const std::vector<Object*>& get_objects() const { return _objects; }
+       //save the dynamic state of every body ( pose, velocities and accumulated forces ) and the step count in a flat buffer
+      std::vector<double> snapshot() const
+      {
+        std::vector<double> buffer;
+        snapshot(buffer);
+        return buffer;
+      }
+      void snapshot(std::vector<double>& buffer) const;
+       //restore a state saved by snapshot and return a pointer to the end of the data read
+      const double* restore(const double* data);
+      void restore(const std::vector<double>& buffer) { restore(buffer.data()); }
+      static const int body_state_size = 20;
     protected:
     void _init(bool add_ground,double angle=0);
       static void _near_callback(void *data, dGeomID o1, dGeomID o2)
@@ -153,6 +258,20 @@ namespace ode
         env->_collision(o1, o2);
       }
       void _collision(dGeomID o1, dGeomID o2);
+       //collision pass, creating the contact joints of the step
+      void _collide()
+      {
+        _contact_count = 0;
+        dSpaceCollide(_space_id, (void *)this, &_near_callback);
+        if (_config.deterministic)
+          _create_sorted_contacts();
+      }
+       //contacts buffered by the collision pass of the deterministic mode, created in a stable order
+      void _create_sorted_contacts();
+       //world step followed by the removal of the contact joints
+      void _solve(double dt);
+       //number of deterministic QuickStep worlds in the process
+      static void _count_deterministic_quicksteps(int delta);
     //public: // ??
        // attributes
       dWorldID _world_id;
@@ -162,6 +281,15 @@ namespace ode
       double _pitch, _roll, _z;
     double angle;
 	double _mu;
+      env_config _config;
+      std::vector<Object*> _objects;
+      uint64_t _group_filter[max_collision_groups];
+      contact_material _materials[DISABLED];
+      dSurfaceParameters _surfaces[DISABLED];
+      dContact _contacts[max_contacts];
+      int _contact_count;
+      std::vector<dContact> _sorted_contacts;
+      unsigned long _step_count;
   };
 }
 
@@ -0,0 +1,119 @@
+/*
+** Copyright (C) 2021 Arthur BOUTON
+**
+** This program is free software: you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation, version 3.
+**
+** This program is distributed in the hope that it will be useful, but
+** WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+** General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef FILTER_BANK_HH
+#define FILTER_BANK_HH
+
+#include "lp_filter.hh"
+
+
+namespace ode
+{
+
+
+/// Bank of N second-order low-pass filters ( see LP_filter ) whose coefficients and states are stored
+/// contiguously by kind, so that all the channels are updated in a single loop that the compiler can vectorise.
+/// Each channel gives exactly the same outputs as an LP_filter with the same parameters, as long as
+/// the compiler does not contract the products and sums into FMA instructions differently in the two loops
+/// ( no FMA in the target instruction set, or -ffp-contract=off ).
+template<int N, typename T = double>
+class LP_filter_bank
+{
+	public:
+
+	static constexpr int size = N;
+
+	/// Number of values describing the internal state of the bank,
+	/// laid out as the states of N consecutive LP_filters.
+	static constexpr int state_size = N*LP_filter<T>::state_size;
+
+	LP_filter_bank()
+	{
+		for ( int k = 0 ; k < N ; k++ )
+		{
+			_b0[k] = _b1[k] = _b2[k] = _a1[k] = _a2[k] = 0;
+			_x1[k] = _x2[k] = _y1[k] = _y2[k] = 0;
+		}
+	}
+
+	/// Same parameters for every channel.
+	LP_filter_bank( double dt, double w0, double zeta ) : LP_filter_bank()
+	{
+		for ( int k = 0 ; k < N ; k++ )
+			set_channel( k, dt, w0, zeta );
+	}
+
+	void set_channel( int k, double dt, double w0, double zeta )
+	{
+		double K = 2/dt;
+		double a0 = K*K + 2*zeta*w0*K + w0*w0;
+		_b0[k] = w0*w0/a0;
+		_b1[k] = 2*_b0[k];
+		_b2[k] = _b0[k];
+		_a1[k] = 2*( w0*w0 - K*K )/a0;
+		_a2[k] = ( K*K - 2*zeta*w0*K + w0*w0 )/a0;
+	}
+
+	/// Filter the N values of x and write the results to y ( which can be x ).
+	inline void update( const T* x, T* y )
+	{
+		for ( int k = 0 ; k < N ; k++ )
+		{
+			T yk = _b0[k]*x[k] + _b1[k]*_x1[k] + _b2[k]*_x2[k] - _a1[k]*_y1[k] - _a2[k]*_y2[k];
+			_x2[k] = _x1[k];
+			_x1[k] = x[k];
+			_y2[k] = _y1[k];
+			_y1[k] = yk;
+		}
+		for ( int k = 0 ; k < N ; k++ )
+			y[k] = _y1[k];
+	}
+
+	inline T get_output( int k ) const { return _y1[k]; }
+	inline const T* get_outputs() const { return _y1; }
+
+	inline void save_state( double* state ) const
+	{
+		for ( int k = 0 ; k < N ; k++, state += LP_filter<T>::state_size )
+		{
+			state[0] = _x1[k];
+			state[1] = _x2[k];
+			state[2] = _y1[k];
+			state[3] = _y2[k];
+		}
+	}
+
+	inline void load_state( const double* state )
+	{
+		for ( int k = 0 ; k < N ; k++, state += LP_filter<T>::state_size )
+		{
+			_x1[k] = state[0];
+			_x2[k] = state[1];
+			_y1[k] = state[2];
+			_y2[k] = state[3];
+		}
+	}
+
+	protected:
+
+	T _b0[N], _b1[N], _b2[N], _a1[N], _a2[N];
+	T _x1[N], _x2[N], _y1[N], _y2[N];
+};
+
+
+}
+
+#endif
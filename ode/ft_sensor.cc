@@ -88,3 +88,15 @@ void FT_sensor::Update()
 }
 
 
+void FT_sensor::SaveState( double* state ) const
+{
+	Vector3d::Map( state ) = _F;
+	Vector3d::Map( state + 3 ) = _T;
+}
+
+
+void FT_sensor::LoadState( const double* state )
+{
+	_F = Vector3d::Map( state );
+	_T = Vector3d::Map( state + 3 );
+}
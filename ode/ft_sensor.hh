@@ -36,6 +36,10 @@ class FT_sensor
 	inline const Eigen::Vector3d* GetForces()  const { return &_F; }
 	inline const Eigen::Vector3d* GetTorques() const { return &_T; }
 
+	static const int state_size = 6;
+	void SaveState( double* state ) const;
+	void LoadState( const double* state );
+
 	protected:
 
 	void _set_rel_center_pos( const ode::Object* O, const Eigen::Vector3d& center, Eigen::Vector3d& oc );
@@ -0,0 +1,131 @@
+/*
+** Copyright (C) 2021 Arthur BOUTON
+**
+** This program is free software: you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation, version 3.
+**
+** This program is distributed in the hope that it will be useful, but
+** WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+** General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef HEADLESS_LOOP_HH
+#define HEADLESS_LOOP_HH
+
+#include <chrono>
+#include <cstdio>
+#include "profiler.hh"
+
+
+#ifndef DEFAULT_TIMESTEP
+#define DEFAULT_TIMESTEP 0.001 // Seconds
+#endif
+
+
+/// Simulation loop without display, for batch evaluations.
+/// The step functions are template parameters so that they can be inlined in the loop.
+class Headless_loop
+{
+	public:
+
+	Headless_loop( float timestep = DEFAULT_TIMESTEP, bool print_time = false ) :
+	               _timestep( timestep ), _time( 0 ), _print_time( print_time ), _nsec( 0 ), _wall_time( 0 ) {}
+
+	/// Call step_function( timestep, time ) until it returns true.
+	/// The profile of the steps of the loop is printed at its end ( when compiled with ROBDYN_PROFILING ).
+	template<class F>
+	void loop( F&& step_function )
+	{
+		// Profile of this loop only:
+		ode::profiler::reset();
+		long first_step = _time;
+		auto start = std::chrono::steady_clock::now();
+
+		while( true )
+		{
+			if ( _print_time )
+				_do_print_time();
+
+			if ( step_function( _timestep, _time*_timestep ) )
+				break;
+
+			_time++;
+		}
+
+		_wall_time += std::chrono::duration<double>( std::chrono::steady_clock::now() - start ).count();
+
+		if ( ode::profiler::enabled() )
+			ode::profiler::print_summary( stderr, ( _time - first_step )*_timestep );
+	}
+
+	/// Call physics_step( timestep, time ) steps_per_tick times in a row, then control_tick( steps_per_tick*timestep, time ),
+	/// and repeat until either of them returns true. The loop stops right away when physics_step returns true, even within a tick.
+	template<class P, class C>
+	void loop( P&& physics_step, C&& control_tick, int steps_per_tick )
+	{
+		// Profile of this loop only:
+		ode::profiler::reset();
+		long first_step = _time;
+		auto start = std::chrono::steady_clock::now();
+
+		bool done = false;
+		while( ! done )
+		{
+			if ( _print_time )
+				_do_print_time();
+
+			for ( int i = 0 ; i < steps_per_tick && ! done ; i++ )
+			{
+				done = physics_step( _timestep, _time*_timestep );
+				if ( ! done )
+					_time++;
+			}
+
+			if ( ! done )
+				done = control_tick( steps_per_tick*_timestep, _time*_timestep );
+		}
+
+		_wall_time += std::chrono::duration<double>( std::chrono::steady_clock::now() - start ).count();
+
+		if ( ode::profiler::enabled() )
+			ode::profiler::print_summary( stderr, ( _time - first_step )*_timestep );
+	}
+
+	inline double get_time() const { return _time*_timestep; }
+	inline long get_steps() const { return _time; }
+	inline double get_wall_time() const { return _wall_time; }
+	inline double get_steps_per_sec() const { return _wall_time > 0 ? _time/_wall_time : 0; }
+	inline double get_realtime_factor() const { return _wall_time > 0 ? get_time()/_wall_time : 0; }
+
+	void print_stats( FILE* stream = stderr ) const
+	{
+		fprintf( stream, "> %ld steps in %.3fs: %.0f steps/s ( real time x%.1f )\n", _time, _wall_time, get_steps_per_sec(), get_realtime_factor() );
+		fflush( stream );
+	}
+
+	protected:
+
+	void _do_print_time()
+	{
+		if ( _time*_timestep > _nsec + 1 )
+		{
+			_nsec++;
+			fprintf( stderr, "> Simulation time: %lds   \r", _nsec );
+			fflush( stderr );
+		}
+	}
+
+	float _timestep;
+	long _time;
+	bool _print_time;
+	long _nsec;
+	double _wall_time;
+};
+
+
+#endif
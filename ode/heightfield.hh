@@ -19,6 +19,7 @@
 
 #include <iostream>
 #include "object.hh"
+#include "terrain_cache.hh"
 #include <osgDB/ReadFile>
 
 
@@ -32,30 +33,63 @@ class HeightField : public Object
 
 	HeightField( Environment& env , const Eigen::Vector3d& pos, double* heightmap, int n_rows, int n_cols,
 	double l, double w, double skirt_height = 0, double bound_min = -dInfinity, double bound_max = dInfinity, bool casts_shadow = false ) :
-	Object( env, pos ), data( heightmap ), nrow( n_rows ), ncol( n_cols ), length( l ), width( w ), skirt( skirt_height ), min( bound_min ), max( bound_max ), texture_path( nullptr )
+	Object( env, pos ), terrain( new Terrain_data( heightmap, n_rows, n_cols ) ), nrow( n_rows ), ncol( n_cols ),
+	length( l ), width( w ), skirt( skirt_height ), min( bound_min ), max( bound_max ), texture_path( nullptr )
 	{
-		data_alloc = false;
 		_casts_shadow = casts_shadow;
 		init();
 	}
 
-	HeightField( Environment& env , const Eigen::Vector3d& pos, const char* heightimage_path, int z_scale,
+	HeightField( Environment& env , const Eigen::Vector3d& pos, const Terrain_data::ptr_t& terrain_data,
 	double l, double w, double skirt_height = 0, double bound_min = -dInfinity, double bound_max = dInfinity, bool casts_shadow = false ) :
-	Object( env, pos ), length( l ), width( w ), skirt( skirt_height ), min( bound_min ), max( bound_max ), texture_path( nullptr )
+	Object( env, pos ), terrain( terrain_data ), nrow( terrain_data->nrow() ), ncol( terrain_data->ncol() ),
+	length( l ), width( w ), skirt( skirt_height ), min( bound_min ), max( bound_max ), texture_path( nullptr )
 	{
-		osg::Image* heightimage = osgDB::readImageFile( heightimage_path );
-		if ( heightimage == nullptr )
+		_casts_shadow = casts_shadow;
+		init();
+	}
+
+	/// The heights are read from a grayscale image or from a binary terrain file ( .hfb, see Terrain_data ),
+	/// once per process: the height fields built from the same file share the same buffer.
+	HeightField( Environment& env , const Eigen::Vector3d& pos, const char* heightimage_path, int z_scale,
+	double l, double w, double skirt_height = 0, double bound_min = -dInfinity, double bound_max = dInfinity, bool casts_shadow = false,
+	bool single_precision = false ) :
+	Object( env, pos ), terrain( load_cached( heightimage_path, single_precision ) ), nrow( terrain->nrow() ), ncol( terrain->ncol() ),
+	length( l ), width( w ), skirt( skirt_height ), min( bound_min ), max( bound_max ), texture_path( nullptr )
+	{
+		_casts_shadow = casts_shadow;
+		init();
+	}
+
+	/// Decode the heights of a grayscale image.
+	static Terrain_data::ptr_t load_image( const char* heightimage_path, bool single_precision = false )
+	{
+		osg::ref_ptr<osg::Image> heightimage = osgDB::readImageFile( heightimage_path );
+		if ( ! heightimage.valid() )
 			throw std::runtime_error( std::string( "Can't open " ) + std::string( heightimage_path ) );
-		nrow = heightimage->t();
-		ncol = heightimage->s();
-		data = (double*) calloc( nrow*ncol, sizeof( double ) );
+		int nrow = heightimage->t();
+		int ncol = heightimage->s();
+		boost::shared_ptr<Terrain_data> terrain( new Terrain_data( nrow, ncol, single_precision ) );
 		for ( int r = 0 ; r < nrow ; r++ )
 			for ( int c = 0 ; c < ncol ; c++ )
-				data[(nrow-r-1)*ncol+c] = ( *heightimage->data( c, r ) )*0.3/255;
+			{
+				double height = ( *heightimage->data( c, r ) )*0.3/255;
+				if ( single_precision )
+					terrain->floats()[(nrow-r-1)*ncol+c] = height;
+				else
+					terrain->doubles()[(nrow-r-1)*ncol+c] = height;
+			}
+		return terrain;
+	}
 
-		data_alloc = true;
-		_casts_shadow = casts_shadow;
-		init();
+	/// Heights of a file taken from the process-wide cache.
+	static Terrain_data::ptr_t load_cached( const char* heightimage_path, bool single_precision = false )
+	{
+		std::string path( heightimage_path );
+		if ( path.size() > 4 && path.compare( path.size() - 4, 4, ".hfb" ) == 0 )
+			return terrain_cache::get_file( path );
+		return terrain_cache::get( path + ( single_precision ? ":f32" : ":f64" ),
+		                           [&]{ return load_image( heightimage_path, single_precision ); } );
 	}
 
 	void set_texture( const char* const path_to_texture )
@@ -63,6 +97,9 @@ class HeightField : public Object
 		texture_path = path_to_texture;
 	}
 
+	/// Height of the point i of the grid, in the row order of ODE.
+	inline double get_height( int i ) const { return terrain->height( i ); }
+
 	virtual void accept( ConstVisitor &v ) const
 	{
 		assert( !_geoms.empty() );
@@ -71,12 +108,19 @@ class HeightField : public Object
 
 	virtual ~HeightField()
 	{
-		if ( data_alloc )
-			free( data );
+		// The geom refers to the height field data and to the heights of terrain,
+		// so it is destroyed here rather than by ~Object, after them:
+		for ( dGeomID g : _geoms )
+		{
+			delete ( collision_feature* ) dGeomGetData( g );
+			dGeomDestroy( g );
+		}
+		_geoms.clear();
+		dGeomHeightfieldDataDestroy( _id );
 	}
 
 
-	double* data;
+	Terrain_data::ptr_t terrain;
 	int nrow;
 	int ncol;
 	double length;
@@ -91,7 +135,11 @@ class HeightField : public Object
 	void init()
 	{
 		_id = dGeomHeightfieldDataCreate();
-		dGeomHeightfieldDataBuildDouble( _id, data, 0, length, width, ncol, nrow, 1, 0, skirt, 0 );
+		// ODE keeps a reference to the heights instead of copying them ( bCopyHeightData = 0 ):
+		if ( terrain->single_precision() )
+			dGeomHeightfieldDataBuildSingle( _id, (const float*) terrain->data(), 0, length, width, ncol, nrow, 1, 0, skirt, 0 );
+		else
+			dGeomHeightfieldDataBuildDouble( _id, (const double*) terrain->data(), 0, length, width, ncol, nrow, 1, 0, skirt, 0 );
 		dGeomHeightfieldDataSetBounds( _id, min, max );
 		dGeomID g = dCreateHeightfield( _env.get_space(), _id, 1 );
 
@@ -106,7 +154,6 @@ class HeightField : public Object
 
 
 	dHeightfieldDataID _id;
-	bool data_alloc;
 };
 
 
@@ -0,0 +1,98 @@
+/*
+** Copyright (C) 2021 Arthur BOUTON
+**
+** This program is free software: you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation, version 3.
+**
+** This program is distributed in the hope that it will be useful, but
+** WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+** General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef LP_FILTER_HH
+#define LP_FILTER_HH
+
+#include <boost/shared_ptr.hpp>
+
+
+namespace ode
+{
+
+
+/// Second-order low-pass filter discretised with the bilinear transform:
+///   H(s) = w0^2/( s^2 + 2*zeta*w0*s + w0^2 )
+/// Same interface as filters::LP_second_order_bilinear, but with an internal state
+/// that can be saved and restored.
+template<typename T>
+class LP_filter
+{
+	public:
+
+	typedef boost::shared_ptr<LP_filter> ptr_t;
+
+	/// Number of values describing the internal state of the filter.
+	static constexpr int state_size = 4;
+
+	LP_filter( double dt, double w0, double zeta, const T* input = nullptr, T* output = nullptr ) :
+	           _input( input ), _output( output ), _x1( 0 ), _x2( 0 ), _y1( 0 ), _y2( 0 )
+	{
+		double K = 2/dt;
+		double a0 = K*K + 2*zeta*w0*K + w0*w0;
+		_b0 = w0*w0/a0;
+		_b1 = 2*_b0;
+		_b2 = _b0;
+		_a1 = 2*( w0*w0 - K*K )/a0;
+		_a2 = ( K*K - 2*zeta*w0*K + w0*w0 )/a0;
+	}
+
+	/// Filter the value read from the input pointer.
+	inline T update() { return update( *_input ); }
+
+	/// Filter a new value and write the result to the output pointer if any.
+	inline T update( T x )
+	{
+		T y = _b0*x + _b1*_x1 + _b2*_x2 - _a1*_y1 - _a2*_y2;
+		_x2 = _x1;
+		_x1 = x;
+		_y2 = _y1;
+		_y1 = y;
+		if ( _output != nullptr )
+			*_output = y;
+		return y;
+	}
+
+	inline T get_output() const { return _y1; }
+
+	inline void save_state( double* state ) const
+	{
+		state[0] = _x1;
+		state[1] = _x2;
+		state[2] = _y1;
+		state[3] = _y2;
+	}
+
+	inline void load_state( const double* state )
+	{
+		_x1 = state[0];
+		_x2 = state[1];
+		_y1 = state[2];
+		_y2 = state[3];
+	}
+
+	protected:
+
+	const T* _input;
+	T* _output;
+	T _b0, _b1, _b2, _a1, _a2;
+	T _x1, _x2, _y1, _y2;
+};
+
+
+}
+
+#endif
@@ -31,7 +31,7 @@ Object::Object( Environment & env, const Eigen::Vector3d& pos ) :
 				_servo2( 0x0 ),
 				_fix( 0x0 ),
 				_casts_shadow( true ),
-				_RGB( NULL ), _alpha( 1 ),
+				_alpha( 1 ), _has_color( false ),
 				_mesh_path( nullptr )
 {
 }
@@ -40,7 +40,10 @@ Object::Object( Environment & env, const Eigen::Vector3d& pos ) :
 Object::~Object()
 {
 	if ( _body )
+	{
+		_env.remove_object( this );
 		dBodyDestroy( _body );
+	}
 	if ( ! _geoms.empty() )
 	{
 		for ( dGeomID g : _geoms )
@@ -50,8 +53,6 @@ Object::~Object()
 		}
 		_geoms.clear();
 	}
-	if ( _RGB != NULL )
-		delete _RGB;
 }
 
 dBodyID Object::get_body() const { return _body; }
@@ -239,7 +240,7 @@ void Object::set_all_collision_group( const char* group )
 		{
 			collision_feature* feature = ( collision_feature* ) dGeomGetData( g );
 			if ( feature != NULL )
-				feature->group = group;
+				feature->set_group( group );
 			else
 				dGeomSetData( g, new collision_feature( group ) );
 		}
@@ -252,7 +253,7 @@ void Object::set_collision_group( const char* group, int index )
 	{
 		collision_feature* feature = ( collision_feature* ) dGeomGetData( index < 0 ? _geoms.back() : _geoms[index] );
 		if ( feature != NULL )
-			feature->group = group;
+			feature->set_group( group );
 		else
 			dGeomSetData( ( index < 0 ? _geoms.back() : _geoms[index] ), new collision_feature( group ) );
 	}
@@ -332,12 +333,11 @@ void Object::disable_shadow_casting() { _casts_shadow = false; }
 bool Object::casts_shadow() const { return _casts_shadow; }
 
 
-const float* Object::get_color() const { return _RGB; }
+const float* Object::get_color() const { return _has_color ? _RGB : NULL; }
 
 void Object::set_color( float r, float g, float b )
 {
-	if ( _RGB == NULL )
-		_RGB = new float[3];
+	_has_color = true;
 	_RGB[0] = r;
 	_RGB[1] = g;
 	_RGB[2] = b;
@@ -357,6 +357,7 @@ void Object::init()
 					  _init_pos.y(),
 					  _init_pos.z() );
 	dBodySetData( _body, this );
+	_env.add_object( this );
 }
 
 
@@ -379,6 +380,7 @@ void Object::_copy( const Object& o )
 	_init_pos = o.get_pos();
 
 	dBodySetData( _body, this );
+	_env.add_object( this );
 }
 
 
@@ -152,7 +152,8 @@ class Object
 	Servo*_servo2;
 	dJointID _fix;
 	bool _casts_shadow;
-	float *_RGB, _alpha;
+	float _RGB[3], _alpha;
+	bool _has_color;
 	const char* _mesh_path;
 };
 
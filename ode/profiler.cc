@@ -0,0 +1,113 @@
+/*
+** Copyright (C) 2021 Arthur BOUTON
+**
+** This program is free software: you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation, version 3.
+**
+** This program is distributed in the hope that it will be useful, but
+** WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+** General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "profiler.hh"
+#include <algorithm>
+
+
+namespace ode
+{
+namespace profiler
+{
+
+
+namespace
+{
+	thread_local counters_t thread_counters = counters_t();
+}
+
+
+const char* phase_name( phase_t phase )
+{
+	switch ( phase )
+	{
+		case COLLISION:     return "collision";
+		case SOLVER:        return "solver";
+		case FT_SENSORS:    return "FT sensors";
+		case FILTERS:       return "filters";
+		case WHEEL_CONTROL: return "wheel control";
+		case CONTROLLER:    return "controller";
+		default:            return "?";
+	}
+}
+
+
+const counters_t& counters()
+{
+	return thread_counters;
+}
+
+
+void reset()
+{
+	thread_counters = counters_t();
+}
+
+
+void merge( const counters_t& other )
+{
+	for ( int p = 0 ; p < N_PHASES ; p++ )
+	{
+		thread_counters.time[p] += other.time[p];
+		thread_counters.calls[p] += other.calls[p];
+	}
+	thread_counters.steps += other.steps;
+	thread_counters.contacts += other.contacts;
+	thread_counters.max_contacts = std::max( thread_counters.max_contacts, other.max_contacts );
+}
+
+
+void count_contacts( int n )
+{
+	thread_counters.steps++;
+	thread_counters.contacts += n;
+	thread_counters.max_contacts = std::max( thread_counters.max_contacts, n );
+}
+
+
+Scoped_timer::~Scoped_timer()
+{
+	thread_counters.time[_phase] += std::chrono::duration<double>( std::chrono::steady_clock::now() - _start ).count();
+	thread_counters.calls[_phase]++;
+}
+
+
+void print_summary( FILE* stream, double sim_time )
+{
+	if ( ! enabled() )
+	{
+		fprintf( stream, "> Profiling disabled ( compile with ROBDYN_PROFILING )\n" );
+		return;
+	}
+
+	const counters_t& c = thread_counters;
+
+	double total = 0;
+	for ( int p = 0 ; p < N_PHASES ; p++ )
+		total += c.time[p];
+
+	fprintf( stream, "> Profile of %ld steps:\n", c.steps );
+	for ( int p = 0 ; p < N_PHASES ; p++ )
+		fprintf( stream, ">   %-14s %10.3f ms %6.1f %% %9.3f µs/call\n", phase_name( phase_t( p ) ), c.time[p]*1e3,
+		         c.time[p]/( sim_time > 0 ? sim_time : total )*100, c.calls[p] > 0 ? c.time[p]/c.calls[p]*1e6 : 0. );
+	fprintf( stream, ">   %-14s %10.3f ms %6.1f %%\n", "total", total*1e3, total/( sim_time > 0 ? sim_time : total )*100 );
+	fprintf( stream, ">   contacts per step: %.2f on average, %d at most\n", c.steps > 0 ? double( c.contacts )/c.steps : 0., c.max_contacts );
+	fflush( stream );
+}
+
+
+}
+}
@@ -0,0 +1,110 @@
+/*
+** Copyright (C) 2021 Arthur BOUTON
+**
+** This program is free software: you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation, version 3.
+**
+** This program is distributed in the hope that it will be useful, but
+** WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+** General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef PROFILER_HH
+#define PROFILER_HH
+
+#include <chrono>
+#include <cstdio>
+
+
+namespace ode
+{
+namespace profiler
+{
+
+
+/// Phases of a simulation step timed when ROBDYN_PROFILING is defined.
+typedef enum phase_t
+{
+	COLLISION,
+	SOLVER,
+	FT_SENSORS,
+	FILTERS,
+	WHEEL_CONTROL,
+	CONTROLLER,
+	N_PHASES
+} phase_t;
+
+const char* phase_name( phase_t phase );
+
+/// Counters accumulated by the calling thread since the last reset.
+typedef struct counters_t
+{
+	double time[N_PHASES]; // Seconds
+	long calls[N_PHASES];
+	long steps;
+	long contacts;
+	int max_contacts;
+} counters_t;
+
+const counters_t& counters();
+void reset();
+
+/// Add the counters of another thread to those of the calling thread.
+void merge( const counters_t& other );
+
+/// Register the contact joints created during one step of the environment.
+void count_contacts( int n );
+
+/// Print the time spent in each phase and the contact statistics of the calling thread.
+/// The share of each phase is relative to sim_time if given ( seconds simulated ), to the total of the phases otherwise.
+void print_summary( FILE* stream = stderr, double sim_time = 0 );
+
+/// Whether the instrumentation has been compiled in.
+inline constexpr bool enabled()
+{
+#ifdef ROBDYN_PROFILING
+	return true;
+#else
+	return false;
+#endif
+}
+
+
+/// Add the time elapsed between construction and destruction to a phase of the calling thread.
+class Scoped_timer
+{
+	public:
+
+	Scoped_timer( phase_t phase ) : _phase( phase ), _start( std::chrono::steady_clock::now() ) {}
+	~Scoped_timer();
+
+	protected:
+
+	phase_t _phase;
+	std::chrono::steady_clock::time_point _start;
+};
+
+
+}
+}
+
+
+#define PROFILER_CONCAT_( a, b ) a##b
+#define PROFILER_CONCAT( a, b ) PROFILER_CONCAT_( a, b )
+
+#ifdef ROBDYN_PROFILING
+/// Time the rest of the enclosing scope as the given phase.
+#define PROFILE_PHASE( phase ) ode::profiler::Scoped_timer PROFILER_CONCAT( _profile_timer_, __LINE__ )( ode::profiler::phase )
+#define PROFILE_CONTACTS( n ) ode::profiler::count_contacts( n )
+#else
+#define PROFILE_PHASE( phase )
+#define PROFILE_CONTACTS( n )
+#endif
+
+
+#endif
@@ -3,30 +3,42 @@
 
 #include <vector>
 #include <map>
-#include <boost/foreach.hpp>
 
 #include "servo.hh"
 #include "object.hh"
 #include "visitor.hh"
+#include "arena.hh"
+#include "actuator_bank.hh"
 
 
 namespace robot
 {
 
 
+class Robot_blueprint;
+
+
 class Robot
 {
 	public:
 
 	typedef boost::shared_ptr<Robot> ptr_t;
 
-	Robot() {}
+	/// Default size in bytes of the arena in which the bodies and servos are built
+	static constexpr size_t default_arena_capacity = 1 << 14;
+
+	Robot( size_t arena_capacity = default_arena_capacity ) : _arena( arena_capacity ), _main_body( nullptr ) {}
 
-	inline const std::vector<ode::Object::ptr_t>& bodies() const { return _bodies; }
-	inline std::vector<ode::Object::ptr_t>& bodies() { return _bodies; }
+	/// Non-owning handles on the parts, valid as long as the robot exists
+	inline const std::vector<ode::Object*>& bodies() const { return _bodies; }
+	inline const std::vector<ode::Servo*>& servos() const { return _servos; }
 
-	inline const std::vector<ode::Servo::ptr_t>& servos() const { return _servos; }
-	inline std::vector<ode::Servo::ptr_t>& servos() { return _servos; }
+	/// ODE bodies of the parts, in the order of bodies()
+	inline const std::vector<dBodyID>& body_ids() const { return _body_ids; }
+
+	/// Motors of the joints which are not driven by servos
+	inline const ode::Actuator_bank& actuators() const { return _actuators; }
+	inline ode::Actuator_bank& actuators() { return _actuators; }
 
 	Eigen::Vector3d get_pos() const { return _main_body->get_pos(); }
 	Eigen::Vector3d get_rot() const { return _main_body->get_rot(); }
@@ -34,25 +46,25 @@ class Robot
 	
 	void disable_shadow_casting()
 	{
-		BOOST_FOREACH( ode::Object::ptr_t o, _bodies ) 
+		for ( ode::Object* o : _bodies )
 			o->disable_shadow_casting();
 	}
 
 	void set_collision_group( const char* group )
 	{
-		BOOST_FOREACH( ode::Object::ptr_t o, _bodies ) 
+		for ( ode::Object* o : _bodies )
 			o->set_collision_group( group );
 	}
 
 	void set_color( float r, float g, float b )
 	{
-		BOOST_FOREACH( ode::Object::ptr_t o, _bodies ) 
+		for ( ode::Object* o : _bodies )
 			o->set_color( r, g, b );
 	}
 
 	void set_alpha( float a )
 	{
-		BOOST_FOREACH( ode::Object::ptr_t o, _bodies ) 
+		for ( ode::Object* o : _bodies )
 			o->set_alpha( a );
 	}
 
@@ -60,15 +72,89 @@ class Robot
 
 	virtual void next_step( double dt = ode::Environment::time_step )
 	{
-		BOOST_FOREACH( ode::Servo::ptr_t s, _servos ) 
+		for ( ode::Servo* s : _servos )
 			s->next_step( dt );
+		_actuators.update( dt );
+	}
+
+	/// Internal state of the robot in a flat buffer ( the bodies are saved by Environment::snapshot )
+	std::vector<double> snapshot() const
+	{
+		std::vector<double> buffer;
+		save_state( buffer );
+		return buffer;
+	}
+
+	void restore( const std::vector<double>& buffer ) { load_state( buffer.data() ); }
+
+	/// Append the internal state to the buffer
+	virtual void save_state( std::vector<double>& buffer ) const
+	{
+		size_t offset = buffer.size();
+		buffer.resize( offset + _servos.size()*ode::Servo::state_size + _actuators.size()*ode::Actuator_bank::state_size );
+		for ( const ode::Servo* s : _servos )
+		{
+			s->save_state( &buffer[offset] );
+			offset += ode::Servo::state_size;
+		}
+		_actuators.save_state( buffer.data() + offset );
+	}
+
+	/// Load a state written by save_state and return a pointer to the end of the data read
+	virtual const double* load_state( const double* data )
+	{
+		for ( ode::Servo* s : _servos )
+		{
+			s->load_state( data );
+			data += ode::Servo::state_size;
+		}
+		_actuators.load_state( data );
+		return data + _actuators.size()*ode::Actuator_bank::state_size;
+	}
+
+	virtual ~Robot()
+	{
+		for ( dJointID joint : _joints )
+			dJointDestroy( joint );
 	}
 
 	protected:
 
-	std::vector<ode::Object::ptr_t> _bodies;
-	std::vector<ode::Servo::ptr_t> _servos;
-	ode::Object::ptr_t _main_body;
+	/// Build a part of the robot next to the previous ones
+	template<class O, class... Args>
+	O* _add_body( Args&&... args )
+	{
+		O* body = _arena.create<O>( std::forward<Args>( args )... );
+		_bodies.push_back( body );
+		_body_ids.push_back( body->get_body() );
+		return body;
+	}
+
+	/// Build a servo next to the parts ( destroyed before the bodies it links )
+	template<class... Args>
+	ode::Servo* _add_servo( Args&&... args )
+	{
+		ode::Servo* servo = _arena.create<ode::Servo>( std::forward<Args>( args )... );
+		_servos.push_back( servo );
+		return servo;
+	}
+
+	/// Build the parts and joints of a blueprint at the given position ( see robot_blueprint.cc ).
+	/// The parts, joints and actuators of the robot then have the indices of the blueprint.
+	/// The first part becomes the main body if there is none yet.
+	void _build( ode::Environment& env, const Eigen::Vector3d& pose, const Robot_blueprint& blueprint );
+
+	// The parts are destroyed with the arena, in the reverse order of their creation:
+	ode::Arena _arena;
+	std::vector<ode::Object*> _bodies;
+	std::vector<dBodyID> _body_ids;
+	std::vector<ode::Servo*> _servos;
+	ode::Actuator_bank _actuators;
+	ode::Object* _main_body;
+
+	// Joints built from a blueprint, destroyed with the robot, and the indices of their actuators ( -1 if none ):
+	std::vector<dJointID> _joints;
+	std::vector<int> _joint_actuators;
 };
 
 
@@ -0,0 +1,392 @@
+/*
+** Copyright (C) 2021 Arthur BOUTON
+**
+** This program is free software: you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation, version 3.
+**
+** This program is distributed in the hope that it will be useful, but
+** WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+** General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "robot_blueprint.hh"
+#include "robot.hh"
+#include "box.hh"
+#include "cylinder.hh"
+#include "sphere.hh"
+#include "wheel.hh"
+#include <yaml-cpp/yaml.h>
+#include <mutex>
+#include <stdexcept>
+
+
+#define DEG_TO_RAD 0.017453292519943295
+
+
+namespace robot
+{
+
+
+static std::runtime_error _error( const std::string& path, const std::string& message )
+{
+	return std::runtime_error( "Invalid robot description " + path + ": " + message );
+}
+
+
+// Vector of 3 values, or of the same value repeated:
+static Eigen::Vector3d _vector( const YAML::Node& node, const Eigen::Vector3d& default_value = Eigen::Vector3d::Zero(), double scale = 1 )
+{
+	if ( ! node )
+		return default_value;
+	if ( node.IsScalar() )
+		return Eigen::Vector3d::Constant( node.as<double>()*scale );
+
+	std::vector<double> values = node.as<std::vector<double>>();
+	Eigen::Vector3d vector = Eigen::Vector3d::Zero();
+	for ( size_t i = 0 ; i < values.size() && i < 3 ; i++ )
+		vector[i] = values[i]*scale;
+	return vector;
+}
+
+
+template<typename T>
+static T _value( const YAML::Node& node, const char* key, const T& default_value )
+{
+	return node[key] ? node[key].as<T>() : default_value;
+}
+
+
+static Robot_blueprint::shape_t _shape( const std::string& shape, const std::string& path )
+{
+	if ( shape == "box" )
+		return Robot_blueprint::BOX;
+	if ( shape == "cylinder" )
+		return Robot_blueprint::CYLINDER;
+	if ( shape == "sphere" )
+		return Robot_blueprint::SPHERE;
+	if ( shape == "wheel" )
+		return Robot_blueprint::WHEEL;
+	throw _error( path, "unknown shape " + shape );
+}
+
+
+Robot_blueprint::Robot_blueprint( const std::string& yaml_file_path ) : _path( yaml_file_path )
+{
+	YAML::Node root;
+	try
+	{
+		root = YAML::LoadFile( yaml_file_path );
+	}
+	catch ( const YAML::Exception& e )
+	{
+		throw std::runtime_error( "Unable to load the robot description " + yaml_file_path + ": " + e.what() );
+	}
+
+	try
+	{
+		_name = _value<std::string>( root, "name", yaml_file_path );
+
+		if ( ! root["bodies"] || root["bodies"].size() == 0 )
+			throw _error( _path, "no bodies" );
+
+		for ( const YAML::Node& node : root["bodies"] )
+		{
+			body_t body;
+			body.name = node["name"].as<std::string>();
+			body.shape = _shape( node["shape"].as<std::string>(), _path );
+			body.mass = node["mass"].as<double>();
+			body.size = _vector( node["size"] );
+			body.pos = _vector( node["pos"] );
+			body.rot = _vector( node["rot"], Eigen::Vector3d::Zero(), DEG_TO_RAD );
+			body.casts_shadow = _value( node, "casts_shadow", true );
+			body.create_geom = _value( node, "create_geom", true );
+			body.soft = _value( node, "soft", false );
+			body.has_color = bool( node["color"] );
+			Eigen::Vector3d color = _vector( node["color"] );
+			for ( int i = 0 ; i < 3 ; i++ )
+				body.color[i] = color[i];
+			body.mesh = _value<std::string>( node, "mesh", "" );
+
+			for ( const YAML::Node& geom_node : node["geoms"] )
+			{
+				geom_t geom;
+				geom.shape = _shape( geom_node["shape"].as<std::string>(), _path );
+				if ( geom.shape == WHEEL )
+					throw _error( _path, "wheels cannot be additional geometries of " + body.name );
+				geom.size = _vector( geom_node["size"] );
+				geom.pos = _vector( geom_node["pos"] );
+				geom.rot = _vector( geom_node["rot"], Eigen::Vector3d::Zero(), DEG_TO_RAD );
+				body.geoms.push_back( geom );
+			}
+
+			if ( ! _body_indices.insert( std::make_pair( body.name, int( _bodies.size() ) ) ).second )
+				throw _error( _path, "duplicate body " + body.name );
+			_bodies.push_back( body );
+		}
+
+		for ( const YAML::Node& node : root["joints"] )
+		{
+			joint_t joint;
+			joint.name = node["name"].as<std::string>();
+
+			std::string type = node["type"].as<std::string>();
+			if ( type == "hinge" )
+				joint.type = HINGE;
+			else if ( type == "slider" )
+				joint.type = SLIDER;
+			else if ( type == "fixed" )
+				joint.type = FIXED;
+			else
+				throw _error( _path, "unknown joint type " + type );
+
+			std::vector<std::string> bodies = node["bodies"].as<std::vector<std::string>>();
+			if ( bodies.empty() || bodies.size() > 2 )
+				throw _error( _path, "the joint " + joint.name + " must link one or two bodies" );
+			joint.body_1 = _find( _body_indices, bodies[0], "body", _path );
+			joint.body_2 = bodies.size() > 1 && bodies[1] != "world" ? _find( _body_indices, bodies[1], "body", _path ) : -1;
+
+			joint.anchor = _vector( node["anchor"] );
+			joint.axis = _vector( node["axis"], Eigen::Vector3d( 0, 0, 1 ) );
+
+			// Angles of the stops of the hinges in degrees:
+			double stop_scale = joint.type == HINGE ? DEG_TO_RAD : 1;
+			joint.lo_stop = -dInfinity;
+			joint.hi_stop = dInfinity;
+			if ( node["stops"] )
+			{
+				std::vector<double> stops = node["stops"].as<std::vector<double>>();
+				if ( stops.size() != 2 )
+					throw _error( _path, "the stops of the joint " + joint.name + " must be [ lo, hi ]" );
+				joint.lo_stop = stops[0]*stop_scale;
+				joint.hi_stop = stops[1]*stop_scale;
+			}
+			joint.fmax = _value( node, "fmax", -1. );
+
+			const YAML::Node actuator = node["actuator"];
+			joint.actuated = bool( actuator );
+			joint.mode = ode::Actuator_bank::VELOCITY;
+			joint.torque_max = dInfinity;
+			joint.torque_speed_ratio = 0;
+			joint.vel_max = dInfinity;
+			joint.Kp = 1;
+			joint.min = -dInfinity;
+			joint.max = dInfinity;
+			if ( actuator )
+			{
+				if ( joint.type != HINGE )
+					throw _error( _path, "only hinges can be actuated: " + joint.name );
+
+				std::string mode = _value<std::string>( actuator, "mode", "velocity" );
+				if ( mode == "position" )
+					joint.mode = ode::Actuator_bank::POSITION;
+				else if ( mode == "velocity" )
+					joint.mode = ode::Actuator_bank::VELOCITY;
+				else if ( mode == "torque" )
+					joint.mode = ode::Actuator_bank::TORQUE;
+				else if ( mode == "passive" )
+					joint.mode = ode::Actuator_bank::PASSIVE;
+				else
+					throw _error( _path, "unknown actuator mode " + mode );
+
+				joint.torque_max = _value( actuator, "torque_max", joint.torque_max );
+				joint.torque_speed_ratio = _value( actuator, "torque_speed_ratio", joint.torque_speed_ratio );
+				joint.vel_max = _value( actuator, "vel_max", joint.vel_max );
+				joint.Kp = _value( actuator, "Kp", joint.Kp );
+				if ( actuator["limits"] )
+				{
+					std::vector<double> limits = actuator["limits"].as<std::vector<double>>();
+					if ( limits.size() != 2 )
+						throw _error( _path, "the limits of the actuator " + joint.name + " must be [ min, max ]" );
+					joint.min = limits[0]*DEG_TO_RAD;
+					joint.max = limits[1]*DEG_TO_RAD;
+				}
+			}
+
+			if ( ! _joint_indices.insert( std::make_pair( joint.name, int( _joints.size() ) ) ).second )
+				throw _error( _path, "duplicate joint " + joint.name );
+			_joints.push_back( joint );
+		}
+
+		for ( const YAML::Node& node : root["ft_sensors"] )
+		{
+			ft_sensor_t sensor;
+			sensor.name = node["name"].as<std::string>();
+
+			std::vector<std::string> bodies = node["bodies"].as<std::vector<std::string>>();
+			if ( bodies.size() != 2 )
+				throw _error( _path, "the sensor " + sensor.name + " must link two bodies" );
+			sensor.body_1 = _find( _body_indices, bodies[0], "body", _path );
+			sensor.body_2 = _find( _body_indices, bodies[1], "body", _path );
+
+			sensor.center = _vector( node["center"] );
+			sensor.k_lin = _vector( node["k_lin"] );
+			sensor.k_ang = _vector( node["k_ang"] );
+			sensor.c_lin = _vector( node["c_lin"] );
+			sensor.c_ang = _vector( node["c_ang"] );
+
+			if ( ! _ft_sensor_indices.insert( std::make_pair( sensor.name, int( _ft_sensors.size() ) ) ).second )
+				throw _error( _path, "duplicate sensor " + sensor.name );
+			_ft_sensors.push_back( sensor );
+		}
+	}
+	catch ( const YAML::Exception& e )
+	{
+		throw _error( _path, e.what() );
+	}
+}
+
+
+static std::mutex _cache_mutex;
+static std::map<std::string,Robot_blueprint::ptr_t> _cache;
+
+
+Robot_blueprint::ptr_t Robot_blueprint::load( const std::string& yaml_file_path )
+{
+	std::lock_guard<std::mutex> lock( _cache_mutex );
+
+	ptr_t& blueprint = _cache[yaml_file_path];
+	if ( ! blueprint )
+	{
+		try
+		{
+			blueprint = ptr_t( new Robot_blueprint( yaml_file_path ) );
+		}
+		catch ( ... )
+		{
+			_cache.erase( yaml_file_path );
+			throw;
+		}
+	}
+	return blueprint;
+}
+
+
+void Robot_blueprint::clear_cache()
+{
+	std::lock_guard<std::mutex> lock( _cache_mutex );
+	_cache.clear();
+}
+
+
+int Robot_blueprint::_find( const std::map<std::string,int>& indices, const std::string& name, const std::string& what, const std::string& path )
+{
+	auto it = indices.find( name );
+	if ( it == indices.end() )
+		throw _error( path, "no " + what + " named " + name );
+	return it->second;
+}
+
+
+int Robot_blueprint::body( const std::string& name ) const { return _find( _body_indices, name, "body", _path ); }
+
+
+int Robot_blueprint::joint( const std::string& name ) const { return _find( _joint_indices, name, "joint", _path ); }
+
+
+const Robot_blueprint::ft_sensor_t& Robot_blueprint::ft_sensor( const std::string& name ) const
+{
+	return _ft_sensors[_find( _ft_sensor_indices, name, "sensor", _path )];
+}
+
+
+void Robot::_build( ode::Environment& env, const Eigen::Vector3d& pose, const Robot_blueprint& blueprint )
+{
+	size_t first_body = _bodies.size();
+
+	for ( const Robot_blueprint::body_t& body : blueprint.bodies() )
+	{
+		ode::Object* object;
+		const Eigen::Vector3d& s = body.size;
+		switch ( body.shape )
+		{
+			case Robot_blueprint::BOX:
+				object = _add_body<ode::Box>( env, pose + body.pos, body.mass, s[0], s[1], s[2], body.casts_shadow, body.create_geom );
+				break;
+			case Robot_blueprint::CYLINDER:
+				object = _add_body<ode::Cylinder>( env, pose + body.pos, body.mass, s[0], s[1], body.casts_shadow, body.create_geom );
+				break;
+			case Robot_blueprint::SPHERE:
+				object = _add_body<ode::Sphere>( env, pose + body.pos, body.mass, s[0], body.casts_shadow, body.create_geom );
+				break;
+			default:
+				object = _add_body<ode::Wheel>( env, pose + body.pos, body.mass, s[0], s[1], int( s[2] ), body.casts_shadow );
+		}
+
+		if ( ! body.rot.isZero() )
+			object->set_rotation( body.rot[0], body.rot[1], body.rot[2] );
+
+		for ( const Robot_blueprint::geom_t& geom : body.geoms )
+		{
+			if ( geom.shape == Robot_blueprint::BOX )
+				object->add_box_geom( geom.size[0], geom.size[1], geom.size[2] );
+			else if ( geom.shape == Robot_blueprint::CYLINDER )
+				object->add_cylinder_geom( geom.size[0], geom.size[1] );
+			else
+				object->add_sphere_geom( geom.size[0] );
+			if ( ! geom.rot.isZero() )
+				object->set_geom_rot( geom.rot[0], geom.rot[1], geom.rot[2] );
+			object->set_geom_abs_pos( pose + geom.pos );
+		}
+
+		if ( body.soft )
+			object->set_contact_type( ode::SOFT );
+		if ( body.has_color )
+			object->set_color( body.color[0], body.color[1], body.color[2] );
+		if ( ! body.mesh.empty() )
+			object->set_mesh( body.mesh.c_str() );
+	}
+
+	if ( _main_body == nullptr )
+		_main_body = _bodies[first_body];
+
+	for ( const Robot_blueprint::joint_t& joint : blueprint.joints() )
+	{
+		dJointID id;
+		if ( joint.type == Robot_blueprint::HINGE )
+			id = dJointCreateHinge( env.get_world(), 0 );
+		else if ( joint.type == Robot_blueprint::SLIDER )
+			id = dJointCreateSlider( env.get_world(), 0 );
+		else
+			id = dJointCreateFixed( env.get_world(), 0 );
+
+		dBodyID body_2 = joint.body_2 >= 0 ? _bodies[first_body + joint.body_2]->get_body() : 0;
+		dJointAttach( id, _bodies[first_body + joint.body_1]->get_body(), body_2 );
+
+		Eigen::Vector3d anchor = pose + joint.anchor;
+		if ( joint.type == Robot_blueprint::HINGE )
+		{
+			dJointSetHingeAnchor( id, anchor.x(), anchor.y(), anchor.z() );
+			dJointSetHingeAxis( id, joint.axis.x(), joint.axis.y(), joint.axis.z() );
+			if ( joint.lo_stop > -dInfinity )
+				dJointSetHingeParam( id, dParamLoStop, joint.lo_stop );
+			if ( joint.hi_stop < dInfinity )
+				dJointSetHingeParam( id, dParamHiStop, joint.hi_stop );
+			if ( joint.fmax >= 0 )
+				dJointSetHingeParam( id, dParamFMax, joint.fmax );
+		}
+		else if ( joint.type == Robot_blueprint::SLIDER )
+		{
+			dJointSetSliderAxis( id, joint.axis.x(), joint.axis.y(), joint.axis.z() );
+			if ( joint.lo_stop > -dInfinity )
+				dJointSetSliderParam( id, dParamLoStop, joint.lo_stop );
+			if ( joint.hi_stop < dInfinity )
+				dJointSetSliderParam( id, dParamHiStop, joint.hi_stop );
+			if ( joint.fmax >= 0 )
+				dJointSetSliderParam( id, dParamFMax, joint.fmax );
+		}
+		else
+			dJointSetFixed( id );
+
+		_joints.push_back( id );
+		_joint_actuators.push_back( joint.actuated ? _actuators.add( id, joint.mode, joint.torque_max, joint.torque_speed_ratio,
+		                                                                 joint.vel_max, joint.Kp, joint.min, joint.max ) : -1 );
+	}
+}
+
+
+}
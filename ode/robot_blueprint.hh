@@ -0,0 +1,137 @@
+/*
+** Copyright (C) 2021 Arthur BOUTON
+**
+** This program is free software: you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation, version 3.
+**
+** This program is distributed in the hope that it will be useful, but
+** WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+** General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef ROBOT_BLUEPRINT_HH
+#define ROBOT_BLUEPRINT_HH
+
+#include <boost/shared_ptr.hpp>
+#include <Eigen/Core>
+#include <string>
+#include <vector>
+#include <map>
+#include "actuator_bank.hh"
+
+
+namespace robot
+{
+
+
+/// Parts, joints and force-torque sensors of a robot compiled from a YAML description ( see robots/rover_1.yaml ).
+/// The references between parts are resolved into indices and the quantities converted into the units of ODE,
+/// so that Robot::_build only creates the ODE objects when the blueprint is instantiated into an environment.
+/// A blueprint is immutable once loaded and is shared by all the robots built from it, in any thread.
+class Robot_blueprint
+{
+	public:
+
+	typedef boost::shared_ptr<const Robot_blueprint> ptr_t;
+
+	typedef enum { BOX, CYLINDER, SPHERE, WHEEL } shape_t;
+	typedef enum { HINGE, SLIDER, FIXED } joint_type_t;
+
+	/// Additional geometry of a part, at a position relative to the robot
+	typedef struct geom_t
+	{
+		shape_t shape;
+		Eigen::Vector3d size;
+		Eigen::Vector3d pos;
+		Eigen::Vector3d rot; // Euler angles in rad
+	} geom_t;
+
+	/// The sizes are { length, width, height } for a box, { radius, length } for a cylinder, { radius } for a sphere
+	/// and { radius, width, def } for a wheel. The positions are relative to the robot.
+	typedef struct body_t
+	{
+		std::string name;
+		shape_t shape;
+		double mass;
+		Eigen::Vector3d size;
+		Eigen::Vector3d pos;
+		Eigen::Vector3d rot; // Euler angles in rad
+		bool casts_shadow;
+		bool create_geom;
+		bool soft;
+		bool has_color;
+		float color[3];
+		std::string mesh;
+		std::vector<geom_t> geoms;
+	} body_t;
+
+	/// Joint between two parts, or between a part and the world if body_2 < 0.
+	typedef struct joint_t
+	{
+		std::string name;
+		joint_type_t type;
+		int body_1, body_2;
+		Eigen::Vector3d anchor;
+		Eigen::Vector3d axis;
+		double lo_stop, hi_stop; // rad or m, ±dInfinity if free
+		double fmax; // Maximal force of the ODE motor, negative if not set
+		/// Motor registered in the actuator bank of the robot, if actuated:
+		bool actuated;
+		ode::Actuator_bank::mode_t mode;
+		double torque_max, torque_speed_ratio, vel_max, Kp, min, max;
+	} joint_t;
+
+	/// Force-torque sensor measuring the stiffness and damping between two parts
+	typedef struct ft_sensor_t
+	{
+		std::string name;
+		int body_1, body_2;
+		Eigen::Vector3d center;
+		Eigen::Vector3d k_lin, k_ang, c_lin, c_ang;
+	} ft_sensor_t;
+
+	/// Parse and compile a description file.
+	Robot_blueprint( const std::string& yaml_file_path );
+
+	/// Blueprint of the description file, compiled only once per process.
+	static ptr_t load( const std::string& yaml_file_path );
+
+	/// Release the blueprints of the cache ( those still in use are freed along with their last user ).
+	static void clear_cache();
+
+	inline const std::string& name() const { return _name; }
+
+	/// The first part is the main body of the robot.
+	inline const std::vector<body_t>& bodies() const { return _bodies; }
+	inline const std::vector<joint_t>& joints() const { return _joints; }
+	inline const std::vector<ft_sensor_t>& ft_sensors() const { return _ft_sensors; }
+
+	/// Indices of the elements of the given names, throwing if there are none:
+	int body( const std::string& name ) const;
+	int joint( const std::string& name ) const;
+	const ft_sensor_t& ft_sensor( const std::string& name ) const;
+
+	protected:
+
+	static int _find( const std::map<std::string,int>& indices, const std::string& name, const std::string& what, const std::string& path );
+
+	std::string _name;
+	std::string _path;
+	std::vector<body_t> _bodies;
+	std::vector<joint_t> _joints;
+	std::vector<ft_sensor_t> _ft_sensors;
+	std::map<std::string,int> _body_indices;
+	std::map<std::string,int> _joint_indices;
+	std::map<std::string,int> _ft_sensor_indices;
+};
+
+
+}
+
+
+#endif
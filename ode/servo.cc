@@ -179,6 +179,28 @@ double Servo::get_true_vel() const
 }
 
 
+void Servo::save_state( double* state ) const
+{
+	state[0] = _angle;
+	state[1] = _vel;
+	state[2] = _mode;
+	state[3] = _passive;
+	state[4] = dJointGetHingeParam( _joint, dParamVel );
+	state[5] = dJointGetHingeParam( _joint, dParamFMax );
+}
+
+
+void Servo::load_state( const double* state )
+{
+	_angle = state[0];
+	_vel = state[1];
+	_mode = servo_mode_t( state[2] );
+	_passive = state[3];
+	dJointSetHingeParam( _joint, dParamVel, state[4] );
+	dJointSetHingeParam( _joint, dParamFMax, state[5] );
+}
+
+
 Servo::~Servo()
 {
 	dJointDestroy( _joint );
@@ -66,6 +66,12 @@ class Servo
 	double get_true_angle() const;
 	double get_true_vel() const;
 
+	/// number of values saved by save_state
+	static const int state_size = 6;
+	/// save the command and the motor parameters of the joint
+	void save_state( double* state ) const;
+	void load_state( const double* state );
+
 	~Servo();
 
 	protected:
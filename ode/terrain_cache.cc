@@ -0,0 +1,152 @@
+/*
+** Copyright (C) 2021 Arthur BOUTON
+**
+** This program is free software: you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation, version 3.
+**
+** This program is distributed in the hope that it will be useful, but
+** WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+** General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "terrain_cache.hh"
+#include <map>
+#include <mutex>
+#include <cstring>
+#include <cstdio>
+#include <stdexcept>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+
+namespace ode
+{
+
+
+Terrain_data::Terrain_data( int nrow, int ncol, bool single_precision ) :
+                            _nrow( nrow ), _ncol( ncol ), _single( single_precision ), _map( nullptr ), _map_size( 0 )
+{
+	if ( _single )
+	{
+		_floats.resize( nrow*ncol, 0 );
+		_data = _floats.data();
+	}
+	else
+	{
+		_doubles.resize( nrow*ncol, 0 );
+		_data = _doubles.data();
+	}
+}
+
+
+Terrain_data::Terrain_data( const double* heights, int nrow, int ncol ) :
+                            _nrow( nrow ), _ncol( ncol ), _single( false ), _data( heights ), _map( nullptr ), _map_size( 0 )
+{
+}
+
+
+Terrain_data::ptr_t Terrain_data::map_file( const std::string& path )
+{
+	int fd = open( path.c_str(), O_RDONLY );
+	if ( fd < 0 )
+		throw std::runtime_error( "Can't open " + path );
+
+	struct stat st;
+	if ( fstat( fd, &st ) < 0 || size_t( st.st_size ) < sizeof( file_header ) )
+	{
+		close( fd );
+		throw std::runtime_error( "Invalid terrain file " + path );
+	}
+
+	void* map = mmap( nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0 );
+	close( fd );
+	if ( map == MAP_FAILED )
+		throw std::runtime_error( "Can't map " + path );
+
+	boost::shared_ptr<Terrain_data> terrain( new Terrain_data() );
+	terrain->_map = map;
+	terrain->_map_size = st.st_size;
+
+	const file_header* header = (const file_header*) map;
+	if ( strncmp( header->magic, "HFB1", 4 ) != 0 )
+		throw std::runtime_error( "Invalid terrain file " + path );
+	terrain->_nrow = header->nrow;
+	terrain->_ncol = header->ncol;
+	terrain->_single = header->single_precision;
+	terrain->_data = (const char*) map + sizeof( file_header );
+
+	size_t data_size = size_t( terrain->_nrow )*terrain->_ncol*( terrain->_single ? sizeof( float ) : sizeof( double ) );
+	if ( terrain->_nrow <= 0 || terrain->_ncol <= 0 || sizeof( file_header ) + data_size > terrain->_map_size )
+		throw std::runtime_error( "Truncated terrain file " + path );
+
+	return terrain;
+}
+
+
+void Terrain_data::save( const std::string& path ) const
+{
+	file_header header = file_header();
+	memcpy( header.magic, "HFB1", 4 );
+	header.single_precision = _single;
+	header.nrow = _nrow;
+	header.ncol = _ncol;
+
+	FILE* file = fopen( path.c_str(), "wb" );
+	if ( file == nullptr )
+		throw std::runtime_error( "Can't write " + path );
+	size_t n = size_t( _nrow )*_ncol;
+	bool ok = fwrite( &header, sizeof( header ), 1, file ) == 1 &&
+	          fwrite( _data, _single ? sizeof( float ) : sizeof( double ), n, file ) == n;
+	fclose( file );
+	if ( ! ok )
+		throw std::runtime_error( "Can't write " + path );
+}
+
+
+Terrain_data::~Terrain_data()
+{
+	if ( _map != nullptr )
+		munmap( _map, _map_size );
+}
+
+
+namespace terrain_cache
+{
+	// Terrains indexed by their key:
+	static std::mutex _cache_mutex;
+	static std::map<std::string,Terrain_data::ptr_t> _cache;
+
+
+	Terrain_data::ptr_t get( const std::string& key, const std::function<Terrain_data::ptr_t()>& loader )
+	{
+		std::lock_guard<std::mutex> lock( _cache_mutex );
+
+		Terrain_data::ptr_t& terrain = _cache[key];
+		if ( ! terrain )
+			terrain = loader();
+		return terrain;
+	}
+
+
+	Terrain_data::ptr_t get_file( const std::string& path )
+	{
+		return get( path, [&path]{ return Terrain_data::map_file( path ); } );
+	}
+
+
+	void clear()
+	{
+		std::lock_guard<std::mutex> lock( _cache_mutex );
+		_cache.clear();
+	}
+}
+
+
+}
@@ -0,0 +1,109 @@
+/*
+** Copyright (C) 2021 Arthur BOUTON
+**
+** This program is free software: you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation, version 3.
+**
+** This program is distributed in the hope that it will be useful, but
+** WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+** General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef TERRAIN_CACHE_HH
+#define TERRAIN_CACHE_HH
+
+#include <boost/shared_ptr.hpp>
+#include <functional>
+#include <string>
+#include <vector>
+#include <cstdint>
+
+
+namespace ode
+{
+
+
+/// Grid of heights in the row order expected by dGeomHeightfieldDataBuild*,
+/// stored in double or single precision and shared read-only between height fields.
+/// The heights are either owned, borrowed from the caller or memory-mapped from a terrain file.
+class Terrain_data
+{
+	public:
+
+	typedef boost::shared_ptr<const Terrain_data> ptr_t;
+
+	/// Header of the binary terrain files ( .hfb ), followed by nrow*ncol heights of the given precision.
+	typedef struct file_header
+	{
+		char magic[4]; // "HFB1"
+		uint32_t single_precision;
+		int32_t nrow;
+		int32_t ncol;
+		char padding[48]; // Keep the heights aligned on 64 bytes
+	} file_header;
+
+	/// Zero-initialised heights owned by the object.
+	Terrain_data( int nrow, int ncol, bool single_precision = false );
+
+	/// Heights owned by the caller, which must outlive the object.
+	Terrain_data( const double* heights, int nrow, int ncol );
+
+	/// Map a terrain file in memory ( read-only ).
+	static ptr_t map_file( const std::string& path );
+
+	/// Write heights in the binary terrain format.
+	void save( const std::string& path ) const;
+
+	inline int nrow() const { return _nrow; }
+	inline int ncol() const { return _ncol; }
+	inline bool single_precision() const { return _single; }
+
+	/// Raw buffer of type float or double depending on the precision.
+	inline const void* data() const { return _data; }
+
+	inline double height( int i ) const { return _single ? ( (const float*) _data )[i] : ( (const double*) _data )[i]; }
+
+	/// Writable access to the heights owned by the object, to be filled before sharing it.
+	inline double* doubles() { return _single ? nullptr : _doubles.data(); }
+	inline float* floats() { return _single ? _floats.data() : nullptr; }
+
+	~Terrain_data();
+
+	protected:
+
+	Terrain_data() : _nrow( 0 ), _ncol( 0 ), _single( false ), _data( nullptr ), _map( nullptr ), _map_size( 0 ) {}
+
+	int _nrow, _ncol;
+	bool _single;
+	const void* _data;
+	std::vector<double> _doubles;
+	std::vector<float> _floats;
+	void* _map;
+	size_t _map_size;
+};
+
+
+/// Process-wide cache of terrains, so that the environments rebuilt at every reset or running in parallel
+/// share the same height buffer instead of loading it again.
+namespace terrain_cache
+{
+	/// Terrain stored under key, created by loader if it is not in the cache yet.
+	Terrain_data::ptr_t get( const std::string& key, const std::function<Terrain_data::ptr_t()>& loader );
+
+	/// Terrain file mapped in memory and cached under its path.
+	Terrain_data::ptr_t get_file( const std::string& path );
+
+	/// Release the terrains of the cache ( those still in use are freed along with their last height field ).
+	void clear();
+}
+
+
+}
+
+
+#endif
@@ -0,0 +1,266 @@
+/*
+** Copyright (C) 2021 Arthur BOUTON
+**
+** This program is free software: you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation, version 3.
+**
+** This program is distributed in the hope that it will be useful, but
+** WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+** General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "terrain_generator.hh"
+#include <random>
+#include <cmath>
+
+
+namespace ode
+{
+
+
+// Mix of the seed and the indices of a tile ( splitmix64 ):
+static uint64_t _tile_seed( uint64_t seed, int i, int j )
+{
+	uint64_t z = seed ^ ( uint64_t( uint32_t( i ) ) << 32 | uint32_t( j ) );
+	for ( int k = 0 ; k < 2 ; k++ )
+	{
+		z += 0x9e3779b97f4a7c15ULL;
+		z = ( z ^ ( z >> 30 ) )*0xbf58476d1ce4e5b9ULL;
+		z = ( z ^ ( z >> 27 ) )*0x94d049bb133111ebULL;
+		z = z ^ ( z >> 31 );
+	}
+	return z;
+}
+
+
+std::vector<Terrain_generator::feature> Terrain_generator::_tile_features( int i, int j ) const
+{
+	const terrain_params& p = _params;
+	std::mt19937_64 gen( _tile_seed( p.seed, i, j ) );
+	std::uniform_real_distribution<double> uniform( 0, 1 );
+	auto draw = [&]( double min, double max ) { return min + ( max - min )*uniform( gen ); };
+
+	// Every feature fits in a disk of radius tile_size/2, so that only the neighbouring tiles can reach a tile:
+	const double reach = p.tile_size/2;
+	const double total_weight = p.step_weight + p.ramp_weight + p.groove_weight + p.rocks_weight;
+
+	std::vector<feature> features;
+	int n_features = std::uniform_int_distribution<int>( 0, p.max_features )( gen );
+	for ( int k = 0 ; k < n_features ; k++ )
+	{
+		feature f;
+		f.x = ( i + draw( -0.5, 0.5 ) )*p.tile_size;
+		f.y = ( j + draw( -0.5, 0.5 ) )*p.tile_size;
+		double direction = draw( -M_PI, M_PI );
+		f.cos_dir = cos( direction );
+		f.sin_dir = sin( direction );
+
+		double type = draw( 0, total_weight );
+		if ( ( type -= p.step_weight ) < 0 )
+		{
+			f.type = STEP;
+			f.a = draw( 0.2, 0.5 )*reach;
+			f.b = draw( 0.3, 0.8 )*reach;
+			f.height = draw( p.min_step_height, p.max_step_height );
+		}
+		else if ( ( type -= p.ramp_weight ) < 0 )
+		{
+			f.type = RAMP;
+			f.a = draw( 0.6, 0.9 )*reach;
+			f.b = draw( 0.2, 0.4 )*reach;
+			// The ramp rises along its first third:
+			f.height = tan( draw( p.min_ramp_slope, p.max_ramp_slope )*M_PI/180 )*f.a*2/3;
+		}
+		else if ( ( type -= p.groove_weight ) < 0 )
+		{
+			f.type = GROOVE;
+			f.a = draw( 0.5, 0.9 )*reach;
+			f.b = draw( p.min_groove_width, p.max_groove_width )/2;
+			f.height = -draw( p.min_groove_depth, p.max_groove_depth );
+		}
+		else
+		{
+			// Rock field:
+			double field_radius = draw( 0.3, 0.6 )*reach;
+			int n_rocks = std::uniform_int_distribution<int>( 1, std::max( 1, p.max_rocks ) )( gen );
+			for ( int r = 0 ; r < n_rocks ; r++ )
+			{
+				feature rock;
+				rock.type = ROCK;
+				double angle = draw( -M_PI, M_PI );
+				double distance = field_radius*sqrt( uniform( gen ) );
+				rock.x = f.x + distance*cos( angle );
+				rock.y = f.y + distance*sin( angle );
+				rock.cos_dir = 1;
+				rock.sin_dir = 0;
+				rock.height = draw( 0.2, 1 )*p.max_rock_height;
+				rock.a = rock.b = std::min( reach - field_radius, rock.height*draw( 1, 2 ) );
+				if ( hypot( rock.x, rock.y ) > p.clear_radius + rock.a )
+					features.push_back( rock );
+			}
+			continue;
+		}
+
+		// Keep the starting area flat:
+		if ( hypot( f.x, f.y ) > p.clear_radius + hypot( f.a, f.b ) )
+			features.push_back( f );
+	}
+
+	return features;
+}
+
+
+double Terrain_generator::_feature_height( const feature& f, double x, double y )
+{
+	// Coordinates along and across the feature:
+	double u = ( x - f.x )*f.cos_dir + ( y - f.y )*f.sin_dir;
+	double v = -( x - f.x )*f.sin_dir + ( y - f.y )*f.cos_dir;
+
+	switch ( f.type )
+	{
+		case STEP :
+		case GROOVE :
+			return fabs( u ) <= f.a && fabs( v ) <= f.b ? f.height : 0;
+
+		case RAMP :
+			if ( fabs( u ) > f.a || fabs( v ) > f.b )
+				return 0;
+			// Rising slope, plateau and falling slope:
+			return f.height*std::min( 1., ( f.a - fabs( u ) )/( f.a*2/3 ) );
+
+		case ROCK :
+		{
+			// Smooth bump vanishing at the radius a:
+			double r2 = ( u*u + v*v )/( f.a*f.a );
+			return r2 < 1 ? f.height*( 1 - r2 )*( 1 - r2 ) : 0;
+		}
+	}
+	return 0;
+}
+
+
+double Terrain_generator::_height( const std::vector<feature>& features, double x, double y ) const
+{
+	// The highest raised feature carved by the deepest groove:
+	double raised = 0, hollowed = 0;
+	for ( const feature& f : features )
+	{
+		double h = _feature_height( f, x, y );
+		if ( f.type == GROOVE )
+			hollowed = std::min( hollowed, h );
+		else
+			raised = std::max( raised, h );
+	}
+	return raised + hollowed;
+}
+
+
+double Terrain_generator::height( double x, double y ) const
+{
+	int i = tile_index( x );
+	int j = tile_index( y );
+	std::vector<feature> features;
+	for ( int di = -1 ; di <= 1 ; di++ )
+		for ( int dj = -1 ; dj <= 1 ; dj++ )
+		{
+			std::vector<feature> tile_features = _tile_features( i + di, j + dj );
+			features.insert( features.end(), tile_features.begin(), tile_features.end() );
+		}
+	return _height( features, x, y );
+}
+
+
+Terrain_data::ptr_t Terrain_generator::generate_tile( int i, int j ) const
+{
+	const terrain_params& p = _params;
+
+	// Features of the tile and of its neighbours, excluding those which can't reach it:
+	std::vector<feature> features;
+	for ( int di = -1 ; di <= 1 ; di++ )
+		for ( int dj = -1 ; dj <= 1 ; dj++ )
+			for ( const feature& f : _tile_features( i + di, j + dj ) )
+			{
+				double reach = hypot( f.a, f.b ) + p.tile_size/2;
+				if ( fabs( f.x - i*p.tile_size ) <= reach && fabs( f.y - j*p.tile_size ) <= reach )
+					features.push_back( f );
+			}
+
+	const int n = p.tile_resolution;
+	boost::shared_ptr<Terrain_data> terrain( new Terrain_data( n, n, p.single_precision ) );
+	const double x0 = ( i - 0.5 )*p.tile_size;
+	const double y0 = ( j + 0.5 )*p.tile_size;
+	const double step = p.tile_size/( n - 1 );
+
+	// The rows go along -y and the columns along x:
+	for ( int r = 0 ; r < n ; r++ )
+		for ( int c = 0 ; c < n ; c++ )
+		{
+			double h = _height( features, x0 + c*step, y0 - r*step );
+			if ( p.single_precision )
+				terrain->floats()[r*n+c] = h;
+			else
+				terrain->doubles()[r*n+c] = h;
+		}
+
+	return terrain;
+}
+
+
+double Terrain_generator::min_height() const
+{
+	return _params.groove_weight > 0 ? -_params.max_groove_depth : 0;
+}
+
+
+double Terrain_generator::max_height() const
+{
+	double max_ramp_height = tan( _params.max_ramp_slope*M_PI/180 )*0.9*_params.tile_size/2*2/3;
+	return std::max( std::max( _params.max_step_height, _params.max_rock_height ), max_ramp_height );
+}
+
+
+Terrain_stream::Terrain_stream( Environment& env, const Terrain_generator& generator, int radius ) :
+                                _env( env ), _generator( generator ), _radius( radius ), _initialised( false ), _i( 0 ), _j( 0 ), _n_generated( 0 )
+{
+}
+
+
+void Terrain_stream::update( const Eigen::Vector3d& position )
+{
+	int i = _generator.tile_index( position.x() );
+	int j = _generator.tile_index( position.y() );
+	if ( _initialised && i == _i && j == _j )
+		return;
+	_initialised = true;
+	_i = i;
+	_j = j;
+
+	// Drop the tiles out of reach:
+	for ( auto it = _tiles.begin() ; it != _tiles.end() ; )
+		if ( abs( it->first.first - i ) > _radius || abs( it->first.second - j ) > _radius )
+			it = _tiles.erase( it );
+		else
+			++it;
+
+	// Create the missing ones:
+	const double size = _generator.params().tile_size;
+	for ( int ti = i - _radius ; ti <= i + _radius ; ti++ )
+		for ( int tj = j - _radius ; tj <= j + _radius ; tj++ )
+		{
+			tile_ptr_t& tile = _tiles[std::make_pair( ti, tj )];
+			if ( tile )
+				continue;
+			tile = tile_ptr_t( new HeightField( _env, Eigen::Vector3d( ti*size, tj*size, 0 ), _generator.generate_tile( ti, tj ), size, size,
+			                                    0, _generator.min_height() - 0.01, _generator.max_height() + 0.01 ) );
+			tile->set_collision_group( "ground" );
+			_n_generated++;
+		}
+}
+
+
+}
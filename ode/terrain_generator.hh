@@ -0,0 +1,140 @@
+/*
+** Copyright (C) 2021 Arthur BOUTON
+**
+** This program is free software: you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation, version 3.
+**
+** This program is distributed in the hope that it will be useful, but
+** WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+** General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef TERRAIN_GENERATOR_HH
+#define TERRAIN_GENERATOR_HH
+
+#include "heightfield.hh"
+#include <map>
+#include <vector>
+#include <cstdint>
+
+
+namespace ode
+{
+
+
+/// Parameters of the procedural terrains. The lengths are in metres.
+typedef struct terrain_params
+{
+	uint64_t seed = 0;
+	double tile_size = 2;
+	int tile_resolution = 64; // Number of points along each side of a tile
+	bool single_precision = false;
+	// Radius around the origin kept flat so that the robot can start on it:
+	double clear_radius = 1;
+	// Maximum number of features whose centre lies in a tile:
+	int max_features = 3;
+	// Relative frequencies of the features:
+	double step_weight = 1;
+	double ramp_weight = 1;
+	double groove_weight = 1;
+	double rocks_weight = 1;
+	// Ranges of the dimensions of the features:
+	double min_step_height = 0.05, max_step_height = 0.2;
+	double min_ramp_slope = 5, max_ramp_slope = 20; // Degrees
+	double min_groove_depth = 0.05, max_groove_depth = 0.2;
+	double min_groove_width = 0.1, max_groove_width = 0.4;
+	double max_rock_height = 0.15;
+	int max_rocks = 12; // Per rock field
+} terrain_params;
+
+
+/// Seeded generator of endless terrains made of square height field tiles with steps, ramps, grooves and rock fields.
+/// Tile ( i, j ) is centred on ( i*tile_size, j*tile_size ) and only depends on the seed and on its indices,
+/// so that the tiles can be generated in any order and match at their borders.
+/// The heights lie in [ -max_groove_depth, max( max_step_height, max_ramp_height, max_rock_height ) ] around the zero level:
+/// the grooves are only hollow if the environment is created without its ground plane.
+class Terrain_generator
+{
+	public:
+
+	Terrain_generator( const terrain_params& params = terrain_params() ) : _params( params ) {}
+
+	inline const terrain_params& params() const { return _params; }
+
+	/// Heights of the tile ( i, j ), in the row order of HeightField.
+	Terrain_data::ptr_t generate_tile( int i, int j ) const;
+
+	/// Height of the terrain at the point ( x, y ).
+	double height( double x, double y ) const;
+
+	/// Index of the tile containing the coordinate x ( or y ).
+	inline int tile_index( double x ) const { return floor( x/_params.tile_size + 0.5 ); }
+
+	/// Bounds of the heights, for the bounding boxes of the tiles.
+	double min_height() const;
+	double max_height() const;
+
+	protected:
+
+	typedef enum { STEP, RAMP, GROOVE, ROCK } feature_type;
+
+	/// Rectangular feature of half-length a along its direction and half-width b.
+	typedef struct feature
+	{
+		feature_type type;
+		double x, y;
+		double cos_dir, sin_dir;
+		double a, b;
+		double height;
+	} feature;
+
+	std::vector<feature> _tile_features( int i, int j ) const;
+
+	static double _feature_height( const feature& f, double x, double y );
+
+	double _height( const std::vector<feature>& features, double x, double y ) const;
+
+	terrain_params _params;
+};
+
+
+/// Tiles of a procedural terrain created around a moving position and destroyed once they are left behind.
+/// The tiles are added to the environment in the collision group "ground".
+class Terrain_stream
+{
+	public:
+
+	typedef boost::shared_ptr<HeightField> tile_ptr_t;
+
+	/// The tiles within radius tiles of the current one are kept in the environment.
+	Terrain_stream( Environment& env, const Terrain_generator& generator, int radius = 1 );
+
+	/// Create the missing tiles around position and drop those out of reach ( typically with robot.GetPosition() ).
+	void update( const Eigen::Vector3d& position );
+
+	inline int n_tiles() const { return _tiles.size(); }
+	inline long n_generated() const { return _n_generated; }
+	inline const std::map<std::pair<int,int>,tile_ptr_t>& tiles() const { return _tiles; }
+	inline const Terrain_generator& generator() const { return _generator; }
+
+	protected:
+
+	Environment& _env;
+	const Terrain_generator _generator;
+	const int _radius;
+	std::map<std::pair<int,int>,tile_ptr_t> _tiles;
+	bool _initialised;
+	int _i, _j;
+	long _n_generated;
+};
+
+
+}
+
+
+#endif
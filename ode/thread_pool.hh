@@ -0,0 +1,141 @@
+/*
+** Copyright (C) 2021 Arthur BOUTON
+**
+** This program is free software: you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation, version 3.
+**
+** This program is distributed in the hope that it will be useful, but
+** WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+** General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef THREAD_POOL_HH
+#define THREAD_POOL_HH
+
+#include <ode/ode.h>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <functional>
+#include <exception>
+#include <algorithm>
+
+
+namespace ode
+{
+
+
+/// Fixed set of worker threads executing parallel loops over independent jobs.
+/// Each worker allocates its own ODE thread-local data so that separate worlds
+/// can be stepped concurrently ( ODE must have been initialised with dInitODE2 ).
+class ThreadPool
+{
+	public:
+
+	ThreadPool( int n_threads = 0 ) : _job( nullptr ), _n_jobs( 0 ), _n_busy( 0 ), _generation( 0 ), _quit( false )
+	{
+		if ( n_threads <= 0 )
+			n_threads = std::max( 1u, std::thread::hardware_concurrency() );
+
+		for ( int i = 0 ; i < n_threads ; i++ )
+			_workers.push_back( std::thread( &ThreadPool::_work, this ) );
+	}
+
+	inline int size() const { return _workers.size(); }
+
+	/// Call job( i ) for every i in [ 0, n_jobs ) and return once all of them are done.
+	/// The first exception thrown by a job is rethrown here.
+	void parallel_for( int n_jobs, const std::function<void(int)>& job )
+	{
+		if ( n_jobs <= 0 )
+			return;
+
+		std::unique_lock<std::mutex> lock( _mutex );
+		_job = &job;
+		_n_jobs = n_jobs;
+		_next_job = 0;
+		_n_busy = _workers.size();
+		_error = nullptr;
+		_generation++;
+		_start_cond.notify_all();
+		_done_cond.wait( lock, [this]{ return _n_busy == 0; } );
+		_job = nullptr;
+
+		if ( _error )
+			std::rethrow_exception( _error );
+	}
+
+	~ThreadPool()
+	{
+		{
+			std::lock_guard<std::mutex> lock( _mutex );
+			_quit = true;
+		}
+		_start_cond.notify_all();
+		for ( std::thread& t : _workers )
+			t.join();
+	}
+
+	protected:
+
+	void _work()
+	{
+		dAllocateODEDataForThread( dAllocateMaskAll );
+
+		unsigned long generation = 0;
+		while ( true )
+		{
+			{
+				std::unique_lock<std::mutex> lock( _mutex );
+				_start_cond.wait( lock, [&]{ return _quit || _generation != generation; } );
+				if ( _quit )
+					break;
+				generation = _generation;
+			}
+
+			int i;
+			while ( ( i = _next_job++ ) < _n_jobs )
+			{
+				try
+				{
+					( *_job )( i );
+				}
+				catch ( ... )
+				{
+					std::lock_guard<std::mutex> lock( _mutex );
+					if ( !_error )
+						_error = std::current_exception();
+				}
+			}
+
+			std::lock_guard<std::mutex> lock( _mutex );
+			if ( --_n_busy == 0 )
+				_done_cond.notify_one();
+		}
+
+		dCleanupODEAllDataForThread();
+	}
+
+	std::vector<std::thread> _workers;
+	std::mutex _mutex;
+	std::condition_variable _start_cond, _done_cond;
+	const std::function<void(int)>* _job;
+	int _n_jobs;
+	std::atomic<int> _next_job;
+	int _n_busy;
+	unsigned long _generation;
+	bool _quit;
+	std::exception_ptr _error;
+};
+
+
+}
+
+#endif
@@ -0,0 +1,218 @@
+/*
+** Copyright (C) 2021 Arthur BOUTON
+**
+** This program is free software: you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation, version 3.
+**
+** This program is distributed in the hope that it will be useful, but
+** WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+** General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "trajectory_log.hh"
+#include <cstring>
+#include <stdexcept>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+
+namespace ode
+{
+
+
+int Record_layout::add( const char* name, type_t type, int count )
+{
+	if ( strlen( name ) >= sizeof( field_t::name ) )
+		throw std::runtime_error( std::string( "Field name too long: " ) + name );
+	if ( find( name ) >= 0 )
+		throw std::runtime_error( std::string( "Field already in the layout: " ) + name );
+
+	field_t field = field_t();
+	strncpy( field.name, name, sizeof( field.name ) - 1 );
+	field.type = type;
+	field.count = count;
+	size_t align = type_size( type );
+	field.offset = ( _size + align - 1 )/align*align;
+	_size = field.offset + count*align;
+
+	_fields.push_back( field );
+	return _fields.size() - 1;
+}
+
+
+int Record_layout::find( const char* name ) const
+{
+	for ( size_t i = 0 ; i < _fields.size() ; i++ )
+		if ( strncmp( _fields[i].name, name, sizeof( field_t::name ) ) == 0 )
+			return i;
+	return -1;
+}
+
+
+bool Record_layout::operator==( const Record_layout& other ) const
+{
+	return _size == other._size && _fields.size() == other._fields.size() &&
+	       memcmp( _fields.data(), other._fields.data(), _fields.size()*sizeof( field_t ) ) == 0;
+}
+
+
+// Layout described by the header of a log file:
+static Record_layout _read_layout( const trajectory_header& header, const Record_layout::field_t* fields, size_t available, const std::string& path )
+{
+	if ( strncmp( header.magic, "TRJ1", 4 ) != 0 || sizeof( trajectory_header ) + header.n_fields*sizeof( Record_layout::field_t ) > available )
+		throw std::runtime_error( "Invalid trajectory log " + path );
+
+	Record_layout layout;
+	for ( uint32_t i = 0 ; i < header.n_fields ; i++ )
+		layout.add( fields[i].name, Record_layout::type_t( fields[i].type ), fields[i].count );
+	if ( layout.size() != header.record_size )
+		throw std::runtime_error( "Invalid trajectory log " + path );
+	return layout;
+}
+
+
+static trajectory_header _make_header( const Record_layout& layout )
+{
+	trajectory_header header = trajectory_header();
+	memcpy( header.magic, "TRJ1", 4 );
+	header.n_fields = layout.n_fields();
+	header.record_size = layout.size();
+	header.header_size = sizeof( trajectory_header ) + layout.n_fields()*sizeof( Record_layout::field_t );
+	return header;
+}
+
+
+Trajectory_writer::Trajectory_writer( const std::string& path, const Record_layout& layout, bool append, size_t buffered_records ) :
+                                      _layout( layout ), _file( nullptr ), _path( path ), _buffer( layout.size()*std::max( buffered_records, size_t( 1 ) ) ),
+                                      _buffered_records( std::max( buffered_records, size_t( 1 ) ) ), _n_buffered( 0 ), _n_records( 0 )
+{
+	trajectory_header header = _make_header( layout );
+
+	// Append to an existing log of the same layout:
+	if ( append && ( _file = fopen( path.c_str(), "r+b" ) ) != nullptr )
+	{
+		trajectory_header existing;
+		std::vector<Record_layout::field_t> fields;
+		bool ok = fread( &existing, sizeof( existing ), 1, _file ) == 1 && strncmp( existing.magic, "TRJ1", 4 ) == 0;
+		if ( ok )
+		{
+			fields.resize( existing.n_fields );
+			ok = fread( fields.data(), sizeof( Record_layout::field_t ), fields.size(), _file ) == fields.size();
+		}
+		if ( ! ok || _read_layout( existing, fields.data(), sizeof( existing ) + fields.size()*sizeof( Record_layout::field_t ), path ) != layout )
+		{
+			fclose( _file );
+			throw std::runtime_error( "Can't append to " + path + ", whose layout is different" );
+		}
+		fseek( _file, 0, SEEK_END );
+		if ( ( ftell( _file ) - existing.header_size ) % existing.record_size != 0 )
+		{
+			fclose( _file );
+			throw std::runtime_error( "Truncated trajectory log " + path );
+		}
+		return;
+	}
+
+	_file = fopen( path.c_str(), "wb" );
+	if ( _file == nullptr )
+		throw std::runtime_error( "Can't write " + path );
+	if ( fwrite( &header, sizeof( header ), 1, _file ) != 1 ||
+	     fwrite( layout._fields.data(), sizeof( Record_layout::field_t ), layout.n_fields(), _file ) != size_t( layout.n_fields() ) )
+	{
+		fclose( _file );
+		throw std::runtime_error( "Can't write " + path );
+	}
+}
+
+
+void Trajectory_writer::commit( const std::vector<char>& record )
+{
+	std::lock_guard<std::mutex> lock( _mutex );
+
+	memcpy( &_buffer[_n_buffered*_layout.size()], record.data(), _layout.size() );
+	_n_records++;
+	if ( ++_n_buffered == _buffered_records )
+		_write_buffer();
+}
+
+
+void Trajectory_writer::flush()
+{
+	std::lock_guard<std::mutex> lock( _mutex );
+	_write_buffer();
+	fflush( _file );
+}
+
+
+void Trajectory_writer::_write_buffer()
+{
+	if ( _n_buffered > 0 && fwrite( _buffer.data(), _layout.size(), _n_buffered, _file ) != _n_buffered )
+		throw std::runtime_error( "Can't write " + _path );
+	_n_buffered = 0;
+}
+
+
+Trajectory_writer::~Trajectory_writer()
+{
+	try
+	{
+		flush();
+	}
+	catch ( const std::exception& e )
+	{
+		fprintf( stderr, "%s\n", e.what() );
+	}
+	fclose( _file );
+}
+
+
+Trajectory_reader::Trajectory_reader( const std::string& path ) : _map( nullptr ), _map_size( 0 ), _records( nullptr ), _n_records( 0 )
+{
+	int fd = open( path.c_str(), O_RDONLY );
+	if ( fd < 0 )
+		throw std::runtime_error( "Can't open " + path );
+
+	struct stat st;
+	if ( fstat( fd, &st ) < 0 || size_t( st.st_size ) < sizeof( trajectory_header ) )
+	{
+		close( fd );
+		throw std::runtime_error( "Invalid trajectory log " + path );
+	}
+
+	_map = mmap( nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0 );
+	close( fd );
+	if ( _map == MAP_FAILED )
+		throw std::runtime_error( "Can't map " + path );
+	_map_size = st.st_size;
+
+	try
+	{
+		const trajectory_header* header = (const trajectory_header*) _map;
+		_layout = _read_layout( *header, (const Record_layout::field_t*)( header + 1 ), _map_size, path );
+		if ( header->header_size > _map_size )
+			throw std::runtime_error( "Truncated trajectory log " + path );
+		_records = (const char*) _map + header->header_size;
+		_n_records = _layout.size() > 0 ? ( _map_size - header->header_size )/_layout.size() : 0;
+	}
+	catch ( ... )
+	{
+		munmap( _map, _map_size );
+		throw;
+	}
+}
+
+
+Trajectory_reader::~Trajectory_reader()
+{
+	munmap( _map, _map_size );
+}
+
+
+}
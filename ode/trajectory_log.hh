@@ -0,0 +1,203 @@
+/*
+** Copyright (C) 2021 Arthur BOUTON
+**
+** This program is free software: you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation, version 3.
+**
+** This program is distributed in the hope that it will be useful, but
+** WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+** General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef TRAJECTORY_LOG_HH
+#define TRAJECTORY_LOG_HH
+
+#include <boost/shared_ptr.hpp>
+#include <string>
+#include <vector>
+#include <mutex>
+#include <cstdio>
+#include <cstdint>
+
+
+namespace ode
+{
+
+
+/// Layout of the fixed-size records of a trajectory log, made of named fields of one or several values.
+class Record_layout
+{
+	public:
+
+	typedef enum { FLOAT32 = 'f', FLOAT64 = 'd', INT32 = 'i' } type_t;
+
+	/// Description of a field as stored in the header of the log files.
+	typedef struct field_t
+	{
+		char name[48];
+		uint32_t type;
+		uint32_t count;
+		uint32_t offset;
+		uint32_t padding;
+	} field_t;
+
+	Record_layout() : _size( 0 ) {}
+
+	/// Append a field and return its index. The values of each field are aligned on their size.
+	int add( const char* name, type_t type, int count = 1 );
+
+	/// Index of the field of the given name, or -1 if there is none.
+	int find( const char* name ) const;
+
+	inline int n_fields() const { return _fields.size(); }
+	inline const field_t& field( int i ) const { return _fields[i]; }
+	/// Size of a record in bytes, rounded up to a multiple of 8.
+	inline size_t size() const { return ( _size + 7 ) & ~size_t( 7 ); }
+
+	bool operator==( const Record_layout& other ) const;
+	inline bool operator!=( const Record_layout& other ) const { return !( *this == other ); }
+
+	static size_t type_size( type_t type ) { return type == FLOAT64 ? 8 : 4; }
+
+	protected:
+
+	std::vector<field_t> _fields;
+	size_t _size;
+
+	friend class Trajectory_writer;
+	friend class Trajectory_reader;
+};
+
+
+/// Header of the trajectory log files ( .trj ), followed by n_fields descriptions of fields and by the records.
+typedef struct trajectory_header
+{
+	char magic[4]; // "TRJ1"
+	uint32_t n_fields;
+	uint32_t record_size;
+	uint32_t header_size; // Offset of the first record, multiple of 64 bytes
+	char padding[48];
+} trajectory_header;
+
+
+/// Buffered writer of fixed-size binary records.
+/// A record is filled field by field and then committed, which copies it into a buffer written to the file
+/// in large blocks. Several threads can commit their own records to the same writer.
+/// When the file already exists with the same layout, the records are appended to it.
+class Trajectory_writer
+{
+	public:
+
+	typedef boost::shared_ptr<Trajectory_writer> ptr_t;
+
+	Trajectory_writer( const std::string& path, const Record_layout& layout, bool append = true, size_t buffered_records = 4096 );
+
+	inline const Record_layout& layout() const { return _layout; }
+
+	/// Zeroed record of the size of the layout, to be filled by the caller.
+	inline std::vector<char> new_record() const { return std::vector<char>( _layout.size(), 0 ); }
+
+	/// Copy count values of the field of index i into a record, converting them to the type of the field.
+	template<typename T>
+	void set( std::vector<char>& record, int i, const T* values, int count ) const;
+
+	template<typename T>
+	inline void set( std::vector<char>& record, int i, T value ) const { set( record, i, &value, 1 ); }
+
+	/// Append a record to the log.
+	void commit( const std::vector<char>& record );
+
+	/// Write the buffered records to the file.
+	void flush();
+
+	/// Number of records committed since the opening of the file.
+	inline long n_records() const { return _n_records; }
+
+	~Trajectory_writer();
+
+	protected:
+
+	void _write_buffer();
+
+	Record_layout _layout;
+	FILE* _file;
+	std::string _path;
+	std::mutex _mutex;
+	std::vector<char> _buffer;
+	size_t _buffered_records;
+	size_t _n_buffered;
+	long _n_records;
+};
+
+
+/// Read-only view of a trajectory log mapped in memory.
+class Trajectory_reader
+{
+	public:
+
+	explicit Trajectory_reader( const std::string& path );
+
+	inline const Record_layout& layout() const { return _layout; }
+	inline long size() const { return _n_records; }
+
+	/// Raw record of index k.
+	inline const char* record( long k ) const { return _records + k*_layout.size(); }
+
+	/// Read count values of the field of index i in the record k, converted to T.
+	template<typename T>
+	void get( long k, int i, T* values, int count ) const;
+
+	template<typename T>
+	inline T get( long k, int i ) const { T value; get( k, i, &value, 1 ); return value; }
+
+	~Trajectory_reader();
+
+	protected:
+
+	Record_layout _layout;
+	void* _map;
+	size_t _map_size;
+	const char* _records;
+	long _n_records;
+};
+
+
+template<typename T>
+void Trajectory_writer::set( std::vector<char>& record, int i, const T* values, int count ) const
+{
+	const Record_layout::field_t& f = _layout.field( i );
+	char* dst = record.data() + f.offset;
+	for ( int j = 0 ; j < count && j < int( f.count ) ; j++ )
+		switch ( f.type )
+		{
+			case Record_layout::FLOAT32: ( (float*) dst )[j] = values[j]; break;
+			case Record_layout::FLOAT64: ( (double*) dst )[j] = values[j]; break;
+			default: ( (int32_t*) dst )[j] = values[j];
+		}
+}
+
+
+template<typename T>
+void Trajectory_reader::get( long k, int i, T* values, int count ) const
+{
+	const Record_layout::field_t& f = _layout.field( i );
+	const char* src = record( k ) + f.offset;
+	for ( int j = 0 ; j < count && j < int( f.count ) ; j++ )
+		switch ( f.type )
+		{
+			case Record_layout::FLOAT32: values[j] = ( (const float*) src )[j]; break;
+			case Record_layout::FLOAT64: values[j] = ( (const double*) src )[j]; break;
+			default: values[j] = ( (const int32_t*) src )[j];
+		}
+}
+
+
+}
+
+
+#endif
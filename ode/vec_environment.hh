@@ -0,0 +1,129 @@
+/*
+** Copyright (C) 2021 Arthur BOUTON
+**
+** This program is free software: you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation, version 3.
+**
+** This program is distributed in the hope that it will be useful, but
+** WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+** General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef VEC_ENVIRONMENT_HH
+#define VEC_ENVIRONMENT_HH
+
+#include "thread_pool.hh"
+#include <boost/shared_ptr.hpp>
+
+
+namespace ode
+{
+
+
+/// Set of N independent scenarios, each one owning its own world, stepped together on a thread pool.
+///
+/// The scenario type S must provide:
+///   static constexpr int state_dim;
+///   bool next_step( float timestep );     // One simulation step. Returns true when the episode is over.
+///   bool control_tick() const;            // True if the last step triggered the controller of the robot.
+///   void get_state( float* state ) const; // Write the current state in a buffer of size state_dim.
+///   float get_reward() const;             // Reward obtained at the last control tick.
+template<class S>
+class VecEnvironment
+{
+	public:
+
+	typedef boost::shared_ptr<S> scenario_ptr_t;
+	typedef std::function<S*(int)> factory_t;
+
+	VecEnvironment( int n_envs, factory_t factory, float timestep = 0.001, int n_threads = 0 ) :
+	                _factory( factory ), _timestep( timestep ), _pool( std::min( n_envs, n_threads > 0 ? n_threads : int( std::thread::hardware_concurrency() ) ) ),
+	                _scenarios( n_envs ), _states( n_envs*S::state_dim, 0 ), _rewards( n_envs, 0 ), _dones( n_envs, 0 )
+	{
+		reset();
+	}
+
+	inline int size() const { return _scenarios.size(); }
+	inline int n_threads() const { return _pool.size(); }
+
+	inline S& operator[]( int i ) { return *_scenarios[i]; }
+	inline const S& operator[]( int i ) const { return *_scenarios[i]; }
+
+	/// Stacked buffers of shapes ( N, state_dim ), ( N ) and ( N ) updated by each call to step().
+	inline const float* states() const { return _states.data(); }
+	inline const float* rewards() const { return _rewards.data(); }
+	inline const unsigned char* dones() const { return _dones.data(); }
+
+	/// Build again every scenario from the factory.
+	void reset()
+	{
+		_pool.parallel_for( size(), [this]( int i )
+		{
+			_scenarios[i].reset();
+			_scenarios[i] = scenario_ptr_t( _factory( i ) );
+			_dones[i] = 0;
+			_rewards[i] = 0;
+			_scenarios[i]->get_state( &_states[i*S::state_dim] );
+		} );
+	}
+
+	/// Advance every running scenario up to its next control tick or to the end of its episode.
+	/// Returns the number of scenarios still running.
+	int step()
+	{
+		_pool.parallel_for( size(), [this]( int i )
+		{
+			if ( _dones[i] )
+				return;
+
+			S& scenario = *_scenarios[i];
+			bool done;
+			do
+				done = scenario.next_step( _timestep );
+			while ( !done && !scenario.control_tick() );
+
+			_dones[i] = done;
+			_rewards[i] = scenario.get_reward();
+			scenario.get_state( &_states[i*S::state_dim] );
+		} );
+
+		int n_running = 0;
+		for ( unsigned char done : _dones )
+			n_running += !done;
+		return n_running;
+	}
+
+	/// Run every episode until its end.
+	void run()
+	{
+		_pool.parallel_for( size(), [this]( int i )
+		{
+			S& scenario = *_scenarios[i];
+			while ( !_dones[i] )
+				_dones[i] = scenario.next_step( _timestep );
+
+			_rewards[i] = scenario.get_reward();
+			scenario.get_state( &_states[i*S::state_dim] );
+		} );
+	}
+
+	protected:
+
+	factory_t _factory;
+	float _timestep;
+	ThreadPool _pool;
+	std::vector<scenario_ptr_t> _scenarios;
+	std::vector<float> _states;
+	std::vector<float> _rewards;
+	std::vector<unsigned char> _dones;
+};
+
+
+}
+
+#endif
@@ -82,8 +82,7 @@ namespace ode
     virtual void visit(typename Const<Cylinder>::type& e) {}
     virtual void visit(typename Const<Wheel>::type& e) {}
     virtual void visit(typename Const<HeightField>::type& e) {}
-    typedef boost::shared_ptr<Object> obj_ptr_t;
-    virtual void visit(typename Const<std::vector<obj_ptr_t> >::type& l) {}
+    virtual void visit(typename Const<std::vector<Object*> >::type& l) {}
     virtual ~GenVisitor () {}
   };
   
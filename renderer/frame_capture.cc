@@ -0,0 +1,277 @@
+/* 
+** Copyright (C) 2019 Arthur BOUTON
+** 
+** This program is free software: you can redistribute it and/or modify  
+** it under the terms of the GNU General Public License as published by  
+** the Free Software Foundation, version 3.
+**
+** This program is distributed in the hope that it will be useful, but 
+** WITHOUT ANY WARRANTY; without even the implied warranty of 
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU 
+** General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License 
+** along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "frame_capture.hh"
+#include <osg/GLExtensions>
+#include <osg/BufferObject>
+#include <osg/Image>
+#include <osgDB/WriteFile>
+#include <algorithm>
+#include <climits>
+#include <cstring>
+#include <stdexcept>
+
+
+namespace renderer
+{
+
+
+namespace
+{
+	// Deletion of the pixel buffer objects of a capture, which may no longer exist when it runs:
+	class Release_buffers : public osg::GraphicsOperation
+	{
+		public:
+
+		Release_buffers( const unsigned int pbo[2] ) : osg::GraphicsOperation( "Release_buffers", false )
+		{
+			_pbo[0] = pbo[0];
+			_pbo[1] = pbo[1];
+		}
+
+		virtual void operator()( osg::GraphicsContext* context )
+		{
+			context->getState()->get<osg::GLExtensions>()->glDeleteBuffers( 2, _pbo );
+		}
+
+		protected:
+
+		unsigned int _pbo[2];
+	};
+}
+
+
+Frame_capture::Frame_capture( const std::string& path_pattern, int queue_size ) : Frame_capture( path_pattern, nullptr, queue_size ) {}
+
+
+Frame_capture::Frame_capture( const std::string& path_pattern, FILE* pipe, int queue_size ) :
+                              _path_pattern( path_pattern ), _pipe( pipe ), _queue_size( std::max( queue_size, 1 ) ),
+                              _pbo_width( 0 ), _pbo_height( 0 ), _next_pbo( 0 ), _pending_pbo( -1 ), _pending_index( -1 ),
+                              _requested_index( -1 ), _quit( false ), _n_written( 0 )
+{
+	_pbo[0] = _pbo[1] = 0;
+	_encoder = std::thread( &Frame_capture::_encode, this );
+}
+
+
+osg::ref_ptr<Frame_capture> Frame_capture::pipe( const std::string& command, int queue_size )
+{
+	FILE* pipe = popen( command.c_str(), "w" );
+	if ( pipe == nullptr )
+		throw std::runtime_error( "Can't run " + command );
+	return new Frame_capture( "", pipe, queue_size );
+}
+
+
+std::string Frame_capture::ffmpeg_command( int width, int height, int fps, const std::string& output )
+{
+	char command[1000];
+	snprintf( command, sizeof( command ), "ffmpeg -loglevel error -y -f rawvideo -pix_fmt rgba -s %dx%d -r %d -i - -c:v libx264 -pix_fmt yuv420p %s",
+	          width, height, fps, output.c_str() );
+	return command;
+}
+
+
+void Frame_capture::attach( osg::Camera* camera ) { camera->setFinalDrawCallback( this ); }
+
+
+void Frame_capture::detach( osg::Camera* camera )
+{
+	if ( camera->getFinalDrawCallback() == this )
+		camera->setFinalDrawCallback( nullptr );
+}
+
+
+void Frame_capture::request( long index ) { _requested_index = index; }
+
+
+void Frame_capture::operator()( osg::RenderInfo& render_info ) const
+{
+	osg::GLExtensions* ext = render_info.getState()->get<osg::GLExtensions>();
+	const osg::Viewport* viewport = render_info.getCurrentCamera()->getViewport();
+	int width = viewport->width();
+	int height = viewport->height();
+
+	// (Re)allocate the buffers to the size of the window, discarding the frame being read:
+	if ( width != _pbo_width || height != _pbo_height )
+	{
+		if ( _pbo[0] == 0 )
+		{
+			ext->glGenBuffers( 2, _pbo );
+			_context = render_info.getState()->getGraphicsContext();
+		}
+		for ( int i = 0 ; i < 2 ; i++ )
+		{
+			ext->glBindBuffer( GL_PIXEL_PACK_BUFFER_ARB, _pbo[i] );
+			ext->glBufferData( GL_PIXEL_PACK_BUFFER_ARB, width*height*4, nullptr, GL_STREAM_READ_ARB );
+		}
+		_pbo_width = width;
+		_pbo_height = height;
+		_pending_pbo = -1;
+	}
+
+	// Start the transfer of the requested frame, which does not wait for the end of the rendering:
+	int reading_pbo = -1;
+	long index = _requested_index.exchange( -1 );
+	if ( index >= 0 )
+	{
+		reading_pbo = _next_pbo;
+		_next_pbo = 1 - _next_pbo;
+		ext->glBindBuffer( GL_PIXEL_PACK_BUFFER_ARB, _pbo[reading_pbo] );
+		glReadBuffer( GL_BACK );
+		glReadPixels( viewport->x(), viewport->y(), width, height, GL_RGBA, GL_UNSIGNED_BYTE, nullptr );
+	}
+
+	// Hand the frame read at the previous rendering to the encoder:
+	if ( _pending_pbo >= 0 )
+	{
+		frame_t frame;
+		frame.index = _pending_index;
+		frame.width = width;
+		frame.height = height;
+		{
+			std::lock_guard<std::mutex> lock( _mutex );
+			if ( ! _free_buffers.empty() )
+			{
+				frame.pixels.swap( _free_buffers.back() );
+				_free_buffers.pop_back();
+			}
+		}
+		frame.pixels.resize( width*height*4 );
+
+		ext->glBindBuffer( GL_PIXEL_PACK_BUFFER_ARB, _pbo[_pending_pbo] );
+		const void* pixels = ext->glMapBuffer( GL_PIXEL_PACK_BUFFER_ARB, GL_READ_ONLY_ARB );
+		if ( pixels != nullptr )
+		{
+			memcpy( frame.pixels.data(), pixels, frame.pixels.size() );
+			ext->glUnmapBuffer( GL_PIXEL_PACK_BUFFER_ARB );
+			_push( frame );
+		}
+	}
+	ext->glBindBuffer( GL_PIXEL_PACK_BUFFER_ARB, 0 );
+
+	_pending_pbo = reading_pbo;
+	_pending_index = index;
+}
+
+
+void Frame_capture::_push( frame_t& frame ) const
+{
+	std::unique_lock<std::mutex> lock( _mutex );
+	_cond.wait( lock, [this]{ return _queue.size() < _queue_size; } );
+	_queue.push_back( frame_t() );
+	std::swap( _queue.back(), frame );
+	_cond.notify_all();
+}
+
+
+void Frame_capture::_encode()
+{
+	std::unique_lock<std::mutex> lock( _mutex );
+	while ( true )
+	{
+		_cond.wait( lock, [this]{ return _quit || ! _queue.empty(); } );
+		if ( _queue.empty() )
+			return;
+
+		frame_t frame;
+		std::swap( frame, _queue.front() );
+		_queue.pop_front();
+		_cond.notify_all();
+
+		lock.unlock();
+		try
+		{
+			_write( frame );
+		}
+		catch ( const std::exception& e )
+		{
+			fprintf( stderr, "%s\n", e.what() );
+		}
+		lock.lock();
+
+		_free_buffers.push_back( std::vector<unsigned char>() );
+		_free_buffers.back().swap( frame.pixels );
+	}
+}
+
+
+void Frame_capture::_write( frame_t& frame )
+{
+	const size_t row = frame.width*4;
+
+	bool raw = _pipe != nullptr || ( _path_pattern.size() > 4 && _path_pattern.compare( _path_pattern.size() - 4, 4, ".raw" ) == 0 );
+	if ( ! raw )
+	{
+		char path[PATH_MAX];
+		snprintf( path, sizeof( path ), _path_pattern.c_str(), int( frame.index ) );
+		osg::ref_ptr<osg::Image> image( new osg::Image );
+		image->setImage( frame.width, frame.height, 1, GL_RGBA, GL_RGBA, GL_UNSIGNED_BYTE, frame.pixels.data(), osg::Image::NO_DELETE );
+		if ( ! osgDB::writeImageFile( *image, path ) )
+			throw std::runtime_error( std::string( "Can't write " ) + path );
+		_n_written++;
+		return;
+	}
+
+	// Top row first:
+	std::vector<unsigned char> line( row );
+	for ( int r = 0 ; r < frame.height/2 ; r++ )
+	{
+		unsigned char* top = &frame.pixels[r*row];
+		unsigned char* bottom = &frame.pixels[( frame.height - 1 - r )*row];
+		memcpy( line.data(), top, row );
+		memcpy( top, bottom, row );
+		memcpy( bottom, line.data(), row );
+	}
+
+	FILE* file = _pipe;
+	char path[PATH_MAX];
+	if ( file == nullptr )
+	{
+		snprintf( path, sizeof( path ), _path_pattern.c_str(), int( frame.index ) );
+		if ( ( file = fopen( path, "wb" ) ) == nullptr )
+			throw std::runtime_error( std::string( "Can't write " ) + path );
+	}
+	bool ok = fwrite( frame.pixels.data(), 1, frame.pixels.size(), file ) == frame.pixels.size();
+	if ( file != _pipe )
+		fclose( file );
+	if ( ! ok )
+		throw std::runtime_error( "Can't write the frame " + std::to_string( frame.index ) );
+	_n_written++;
+}
+
+
+Frame_capture::~Frame_capture()
+{
+	{
+		std::lock_guard<std::mutex> lock( _mutex );
+		_quit = true;
+		_cond.notify_all();
+	}
+	_encoder.join();
+
+	if ( _pipe != nullptr )
+		pclose( _pipe );
+
+	// The buffers can only be deleted with their context current, which is the case when the operations of
+	// the context run at its next rendering. If the context is gone, the buffers went with it:
+	osg::ref_ptr<osg::GraphicsContext> context;
+	if ( _pbo[0] != 0 && _context.lock( context ) )
+		context->add( new Release_buffers( _pbo ) );
+}
+
+
+}
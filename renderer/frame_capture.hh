@@ -0,0 +1,114 @@
+/* 
+** Copyright (C) 2019 Arthur BOUTON
+** 
+** This program is free software: you can redistribute it and/or modify  
+** it under the terms of the GNU General Public License as published by  
+** the Free Software Foundation, version 3.
+**
+** This program is distributed in the hope that it will be useful, but 
+** WITHOUT ANY WARRANTY; without even the implied warranty of 
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU 
+** General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License 
+** along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef FRAME_CAPTURE_HH
+#define FRAME_CAPTURE_HH 
+
+#include <osg/Camera>
+#include <osg/GraphicsContext>
+#include <osg/observer_ptr>
+#include <string>
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <cstdio>
+
+
+namespace renderer
+{
+
+
+/// Capture of the rendered frames without stalling the rendering loop.
+/// Attached as the final draw callback of a camera, it reads the frames requested back into two pixel buffer
+/// objects used in turn, so that the transfer of a frame overlaps the rendering of the next one, and hands
+/// the pixels to a background thread that encodes them:
+///   - into files named after a printf pattern of the frame index, in any image format of osgDB ( PNG by default )
+///     or in raw RGBA if the extension is .raw,
+///   - or as raw RGBA frames, top row first, piped to the standard input of a command such as an ffmpeg encoder.
+/// A requested frame is read back at the end of its rendering and handed to the encoder at the next one.
+/// Up to queue_size frames wait for the encoder, after which the rendering waits for it.
+class Frame_capture : public osg::Camera::DrawCallback
+{
+	public:
+
+	Frame_capture( const std::string& path_pattern, int queue_size = 8 );
+
+	/// Frames piped to a command.
+	static osg::ref_ptr<Frame_capture> pipe( const std::string& command, int queue_size = 8 );
+
+	/// Command encoding the raw frames of a pipe into a H.264 video.
+	static std::string ffmpeg_command( int width, int height, int fps, const std::string& output );
+
+	void attach( osg::Camera* camera );
+	void detach( osg::Camera* camera );
+
+	/// Capture the next rendered frame under the given index.
+	void request( long index );
+
+	/// Number of frames encoded so far.
+	inline long n_written() const { return _n_written; }
+
+	virtual void operator()( osg::RenderInfo& render_info ) const;
+
+	protected:
+
+	typedef struct frame_t
+	{
+		long index;
+		int width, height;
+		std::vector<unsigned char> pixels; // RGBA, bottom row first as read by OpenGL
+	} frame_t;
+
+	Frame_capture( const std::string& path_pattern, FILE* pipe, int queue_size );
+
+	/// Wait for the encoding of the pending frames, stop the encoder and release the pixel buffer objects.
+	virtual ~Frame_capture();
+
+	void _push( frame_t& frame ) const;
+	void _encode();
+	void _write( frame_t& frame );
+
+	std::string _path_pattern;
+	FILE* _pipe;
+	size_t _queue_size;
+
+	// Pixel buffer objects, used by the drawing thread only, and the context they belong to:
+	mutable unsigned int _pbo[2];
+	mutable osg::observer_ptr<osg::GraphicsContext> _context;
+	mutable int _pbo_width, _pbo_height;
+	mutable int _next_pbo;
+	mutable int _pending_pbo;
+	mutable long _pending_index;
+
+	mutable std::atomic<long> _requested_index;
+
+	// Frames waiting for the encoder and buffers to be reused:
+	mutable std::mutex _mutex;
+	mutable std::condition_variable _cond;
+	mutable std::deque<frame_t> _queue;
+	mutable std::vector<std::vector<unsigned char>> _free_buffers;
+	bool _quit;
+	std::atomic<long> _n_written;
+	std::thread _encoder;
+};
+
+
+}
+
+#endif
@@ -64,24 +64,28 @@ class PositionCallback : public NodeCallback
 };
 
 
-// apply ode transformation
+// apply ode transformation, unless the poses are replayed
 class UpdateCallback : public NodeCallback
 {
 	public:
 
-	UpdateCallback( const ode::Object& obj ) : _obj( obj ) {}
+	UpdateCallback( const ode::Object& obj, const bool& replay ) : _obj( obj ), _replay( replay ) {}
 
 	virtual void operator()( Node* node, NodeVisitor* nv )
 	{
-		PositionAttitudeTransform* pat = dynamic_cast<PositionAttitudeTransform*>( node );
-		pat->setPosition( _osg_pos( _obj ) );
-		pat->setAttitude( _osg_quat( _obj ) );
+		if ( !_replay )
+		{
+			PositionAttitudeTransform* pat = dynamic_cast<PositionAttitudeTransform*>( node );
+			pat->setPosition( _osg_pos( _obj ) );
+			pat->setAttitude( _osg_quat( _obj ) );
+		}
 		traverse( node, nv );
 	}
 
 	protected:
 
 	const ode::Object& _obj;
+	const bool& _replay;
 };
 
 
@@ -101,7 +105,8 @@ OsgVisitor::OsgVisitor( unsigned int screen, int wwidth, int wheight, int wxpos,
 						_keh( new KeyboardEventHandler( &_viewer ) ),
 						_wwidth( wwidth ),
 						_wheight( wheight ),
-						_ground_texture_path( "../env_data/checker.tga" )
+						_ground_texture_path( "../env_data/checker.tga" ),
+						_replay( false )
 {
 	if ( wwidth != 0 && wheight != 0 )
 		_viewer.setUpViewInWindow( wxpos, wypos, wwidth, wheight, screen );
@@ -153,13 +158,13 @@ void OsgVisitor::set_window_name( std::string name )
 }
 
 
-void OsgVisitor::visit( const std::vector<ode::Object::ptr_t>& v )
+void OsgVisitor::visit( const std::vector<ode::Object*>& v )
 {
 	assert( v.size() );//hack..
 	if ( !_viewer.getSceneData() )
 		_create_ground( v[0]->get_env() );
 
-	BOOST_FOREACH( ode::Object::ptr_t o, v )
+	for ( const ode::Object* o : v )
 		o->accept( *this );
 }
 
@@ -190,8 +195,13 @@ void OsgVisitor::_create_std_object( const ode::Object& o, ShapeDrawable* drawab
 		pat->addChild( pLoadedModel );
 	}
 
-	ref_ptr<NodeCallback> cb( new UpdateCallback( o ) );
+	// Initial pose, kept by the objects not driven by set_pose in replay mode:
+	pat->setPosition( _osg_pos( o ) );
+	pat->setAttitude( _osg_quat( o ) );
+
+	ref_ptr<NodeCallback> cb( new UpdateCallback( o, _replay ) );
 	pat->setUpdateCallback( cb );
+	_pats[&o] = pat;
 
 	_root->addChild( pat );
 	_set_tm( pat );
@@ -283,8 +293,13 @@ void OsgVisitor::visit( const ode::Wheel& o )
 		pat->addChild( geode.get() );
 	}
 
-	ref_ptr<NodeCallback> cb( new UpdateCallback( o ) );
+	// Initial pose, kept by the objects not driven by set_pose in replay mode:
+	pat->setPosition( _osg_pos( o ) );
+	pat->setAttitude( _osg_quat( o ) );
+
+	ref_ptr<NodeCallback> cb( new UpdateCallback( o, _replay ) );
 	pat->setUpdateCallback( cb );
+	_pats[&o] = pat;
 
 	_root->addChild( pat );
 	_set_tm( pat );
@@ -297,7 +312,6 @@ void OsgVisitor::visit( const ode::HeightField& o )
 	if ( !o.casts_shadow() )
 		geode->setNodeMask( geode->getNodeMask() & ~CASTS_SHADOW );
 
-	double* data = o.data;
 	int nrow = o.nrow;
 	int ncol = o.ncol;
 	double length = o.length;
@@ -313,7 +327,7 @@ void OsgVisitor::visit( const ode::HeightField& o )
 
 	for ( int r = 0 ; r < nrow ; r++ )
 		for ( int c = 0 ; c < ncol ; c++ )
-			heightField->setHeight( c, r, *( data + ( nrow - r - 1 )*ncol + c ) );
+			heightField->setHeight( c, r, o.get_height( ( nrow - r - 1 )*ncol + c ) );
 
 	ShapeDrawable* drawable = new osg::ShapeDrawable( heightField );
 	//_set_object_color( drawable, o );
@@ -364,6 +378,25 @@ void OsgVisitor::update()
 bool OsgVisitor::done() { return _viewer.done(); }
 
 
+std::vector<const ode::Object*> OsgVisitor::get_moving_objects() const
+{
+	std::vector<const ode::Object*> objects;
+	for ( const auto& pat : _pats )
+		objects.push_back( pat.first );
+	return objects;
+}
+
+
+void OsgVisitor::set_pose( const ode::Object& o, const Vec3d& pos, const Quat& q )
+{
+	auto it = _pats.find( &o );
+	if ( it == _pats.end() )
+		return;
+	it->second->setPosition( pos );
+	it->second->setAttitude( q );
+}
+
+
 void OsgVisitor::_set_tm( ref_ptr<PositionAttitudeTransform> pat )
 {
 	if ( _pat_ref == NULL )
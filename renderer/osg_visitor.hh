@@ -68,7 +68,18 @@ class OsgVisitor : public ode::ConstVisitor
 
 	bool done();
 
-	virtual void visit( const std::vector<ode::Object::ptr_t>& v );
+	/// In replay mode, the transforms of the objects are no longer read from their bodies at each update
+	/// but only set by set_pose, so that a recorded episode can be rendered without any physics.
+	inline void set_replay( bool replay ) { _replay = replay; }
+	inline bool get_replay() const { return _replay; }
+
+	/// Pose of the node of an object visited beforehand ( quaternion in the OSG order ).
+	void set_pose( const ode::Object& o, const osg::Vec3d& pos, const osg::Quat& q );
+
+	/// Objects visited whose node follows the pose of their body.
+	std::vector<const ode::Object*> get_moving_objects() const;
+
+	virtual void visit( const std::vector<ode::Object*>& v );
 	virtual void visit( const ode::Box& );
 	virtual void visit( const ode::CappedCyl& );
 	virtual void visit( const ode::Sphere& );
@@ -116,6 +127,8 @@ class OsgVisitor : public ode::ConstVisitor
 	int _wwidth, _wheight;
 	const char* _ground_texture_path;
 	std::map<const char*,OsgText::ptr_t> _texts;
+	bool _replay;
+	std::map<const ode::Object*,osg::ref_ptr<osg::PositionAttitudeTransform>> _pats;
 };
 
 
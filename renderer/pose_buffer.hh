@@ -0,0 +1,92 @@
+/* 
+** Copyright (C) 2019 Arthur BOUTON
+** 
+** This program is free software: you can redistribute it and/or modify  
+** it under the terms of the GNU General Public License as published by  
+** the Free Software Foundation, version 3.
+**
+** This program is distributed in the hope that it will be useful, but 
+** WITHOUT ANY WARRANTY; without even the implied warranty of 
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU 
+** General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License 
+** along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef POSE_BUFFER_HH
+#define POSE_BUFFER_HH 
+
+#include "renderer/osg_visitor.hh"
+#include <vector>
+#include <mutex>
+
+
+namespace renderer
+{
+
+
+/// Double-buffered snapshot of the poses of a set of objects, published by the thread running the
+/// physics and applied to the display by the rendering thread.
+/// The physics fills the back buffer without any lock and only waits for the rendering while
+/// the buffers are swapped, the rendering holding the lock just the time to copy the front buffer to the nodes.
+class Pose_buffer
+{
+	public:
+
+	Pose_buffer( const std::vector<const ode::Object*>& objects ) :
+	             _objects( objects ), _front( 0 ), _n_published( 0 )
+	{
+		for ( int i = 0 ; i < 2 ; i++ )
+		{
+			_poses[i].resize( 7*objects.size() );
+			_time[i] = 0;
+		}
+	}
+
+	/// Copy the current poses of the bodies to the back buffer and make it the front one.
+	void publish( double time )
+	{
+		std::vector<double>& poses = _poses[1 - _front];
+		for ( size_t i = 0 ; i < _objects.size() ; i++ )
+		{
+			dBodyID body = _objects[i]->get_body();
+			std::copy( dBodyGetPosition( body ), dBodyGetPosition( body ) + 3, &poses[7*i] );
+			std::copy( dBodyGetQuaternion( body ), dBodyGetQuaternion( body ) + 4, &poses[7*i+3] );
+		}
+
+		std::lock_guard<std::mutex> lock( _mutex );
+		_time[1 - _front] = time;
+		_front = 1 - _front;
+		_n_published++;
+	}
+
+	/// Set the nodes of the display to the latest poses published and return their simulation time.
+	double apply( OsgVisitor& display )
+	{
+		std::lock_guard<std::mutex> lock( _mutex );
+		const std::vector<double>& poses = _poses[_front];
+		for ( size_t i = 0 ; i < _objects.size() ; i++ )
+		{
+			const double* p = &poses[7*i];
+			display.set_pose( *_objects[i], osg::Vec3d( p[0], p[1], p[2] ), osg::Quat( p[4], p[5], p[6], p[3] ) );
+		}
+		return _time[_front];
+	}
+
+	inline long n_published() const { return _n_published; }
+
+	protected:
+
+	std::vector<const ode::Object*> _objects;
+	std::vector<double> _poses[2];
+	double _time[2];
+	int _front;
+	long _n_published;
+	std::mutex _mutex;
+};
+
+
+}
+
+#endif
@@ -0,0 +1,148 @@
+/* 
+** Copyright (C) 2019 Arthur BOUTON
+** 
+** This program is free software: you can redistribute it and/or modify  
+** it under the terms of the GNU General Public License as published by  
+** the Free Software Foundation, version 3.
+**
+** This program is distributed in the hope that it will be useful, but 
+** WITHOUT ANY WARRANTY; without even the implied warranty of 
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU 
+** General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License 
+** along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "replay_loop.hh"
+#include <chrono>
+#include <thread>
+#include <stdexcept>
+
+
+Replay_loop::Replay_loop( renderer::OsgVisitor* display_ptr, const ode::Trajectory_reader& log, const std::vector<const ode::Object*>& objects,
+                          const char* poses_field, int fps ) :
+                          _display_ptr( display_ptr ), _log( log ), _objects( objects ),
+                          _time_field( log.layout().find( "time" ) ), _poses_field( log.layout().find( poses_field ) ),
+                          _fps( fps ), _warp_factor( 1 ), _time( 0 ), _n_captures( 0 )
+{
+	if ( _time_field < 0 || _poses_field < 0 )
+		throw std::runtime_error( std::string( "No time or " ) + poses_field + " field in the trajectory log" );
+	if ( log.layout().field( _poses_field ).count != 7*objects.size() )
+		throw std::runtime_error( "The poses of the trajectory log do not match the objects to replay" );
+
+	_pose_1.resize( 7*objects.size() );
+	_pose_2.resize( 7*objects.size() );
+
+	_display_ptr->set_replay( true );
+}
+
+
+std::pair<long,long> Replay_loop::episode_range( const ode::Trajectory_reader& log, int episode )
+{
+	int field = log.layout().find( "episode" );
+	if ( field < 0 || log.size() == 0 )
+		return std::make_pair( 0L, log.size() );
+
+	if ( episode < 0 )
+		episode = log.get<int>( log.size() - 1, field );
+
+	long first = 0;
+	while ( first < log.size() && log.get<int>( first, field ) != episode )
+		first++;
+	long last = first;
+	while ( last < log.size() && log.get<int>( last, field ) == episode )
+		last++;
+	return std::make_pair( first, last );
+}
+
+
+void Replay_loop::start_captures( const char* path )
+{
+	stop_captures();
+	_frame_capture = new renderer::Frame_capture( path );
+	_frame_capture->attach( _display_ptr->get_viewer()->getCamera() );
+	_n_captures = 0;
+}
+
+
+void Replay_loop::start_capture_pipe( const char* command )
+{
+	stop_captures();
+	_frame_capture = renderer::Frame_capture::pipe( command );
+	_frame_capture->attach( _display_ptr->get_viewer()->getCamera() );
+	_n_captures = 0;
+}
+
+
+void Replay_loop::stop_captures()
+{
+	if ( ! _frame_capture.valid() )
+		return;
+
+	// The last frame requested is read back at the next rendering:
+	if ( ! _display_ptr->done() )
+		_display_ptr->update();
+	_frame_capture->detach( _display_ptr->get_viewer()->getCamera() );
+	_frame_capture = nullptr;
+}
+
+
+void Replay_loop::_set_poses( long k, double alpha )
+{
+	_log.get( k, _poses_field, _pose_1.data(), _pose_1.size() );
+	_log.get( k + ( alpha > 0 ? 1 : 0 ), _poses_field, _pose_2.data(), _pose_2.size() );
+
+	for ( size_t i = 0 ; i < _objects.size() ; i++ )
+	{
+		const float* p1 = &_pose_1[7*i];
+		const float* p2 = &_pose_2[7*i];
+		osg::Vec3d pos = osg::Vec3d( p1[0], p1[1], p1[2] )*( 1 - alpha ) + osg::Vec3d( p2[0], p2[1], p2[2] )*alpha;
+		osg::Quat q;
+		q.slerp( alpha, osg::Quat( p1[4], p1[5], p1[6], p1[3] ), osg::Quat( p2[4], p2[5], p2[6], p2[3] ) );
+		_display_ptr->set_pose( *_objects[i], pos, q );
+	}
+}
+
+
+bool Replay_loop::play( long first, long last )
+{
+	if ( first >= last )
+		return true;
+
+	const double t_start = _log.get<double>( first, _time_field );
+	const double t_end = _log.get<double>( last - 1, _time_field );
+
+	auto start = std::chrono::steady_clock::now();
+	long k = first;
+	for ( long frame = 0 ; ; frame++ )
+	{
+		if ( _display_ptr->done() )
+			return false;
+
+		_time = t_start + double( frame )/_fps;
+		if ( _time > t_end )
+			break;
+
+		// Records surrounding the time of the frame:
+		while ( k + 1 < last && _log.get<double>( k + 1, _time_field ) <= _time )
+			k++;
+		double alpha = 0;
+		if ( k + 1 < last )
+		{
+			double t_k = _log.get<double>( k, _time_field );
+			alpha = ( _time - t_k )/( _log.get<double>( k + 1, _time_field ) - t_k );
+		}
+		_set_poses( k, alpha );
+
+		if ( _frame_capture.valid() )
+			_frame_capture->request( _n_captures++ );
+
+		_display_ptr->update();
+
+		if ( ! _frame_capture.valid() )
+			std::this_thread::sleep_until( start + std::chrono::duration<double>( ( frame + 1 )/( _fps*_warp_factor ) ) );
+	}
+
+	return true;
+}
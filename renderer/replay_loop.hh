@@ -0,0 +1,73 @@
+/* 
+** Copyright (C) 2019 Arthur BOUTON
+** 
+** This program is free software: you can redistribute it and/or modify  
+** it under the terms of the GNU General Public License as published by  
+** the Free Software Foundation, version 3.
+**
+** This program is distributed in the hope that it will be useful, but 
+** WITHOUT ANY WARRANTY; without even the implied warranty of 
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU 
+** General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License 
+** along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef REPLAY_LOOP_HH
+#define REPLAY_LOOP_HH 
+
+#include "renderer/osg_visitor.hh"
+#include "renderer/sim_loop.hh"
+#include "ode/trajectory_log.hh"
+
+
+/// Rendering of an episode recorded in a trajectory log, without any physics.
+/// The poses of the objects are read from a field of the log holding the position and
+/// the quaternion ( w, x, y, z ) of each object in turn, and interpolated at the frame rate.
+/// The frames are paced on the wall clock or, while capturing, rendered as fast as possible.
+class Replay_loop
+{
+	public:
+
+	Replay_loop( renderer::OsgVisitor* display_ptr, const ode::Trajectory_reader& log, const std::vector<const ode::Object*>& objects,
+	             const char* poses_field = "poses", int fps = DEFAULT_FPS );
+
+	/// Play the records [first,last) of the log. Returns false if the window has been closed.
+	bool play( long first, long last );
+
+	/// Range of records [first,last) of an episode of the log, the last one if episode < 0.
+	static std::pair<long,long> episode_range( const ode::Trajectory_reader& log, int episode = -1 );
+
+	inline void set_fps( int fps ) { _fps = fps; }
+	inline void set_timewarp( float warp_factor ) { _warp_factor = warp_factor; }
+	inline double get_time() const { return _time; }
+
+	/// The frames are encoded in the background, to files ( see renderer::Frame_capture ) or piped to a command.
+	void start_captures( const char* path = DEFAULT_CAPTURE_PATH );
+	void start_capture_pipe( const char* command );
+	void stop_captures();
+
+	~Replay_loop() { stop_captures(); }
+
+	protected:
+
+	void _set_poses( long k, double alpha );
+
+	renderer::OsgVisitor* _display_ptr;
+	const ode::Trajectory_reader& _log;
+	std::vector<const ode::Object*> _objects;
+	int _time_field;
+	int _poses_field;
+	int _fps;
+	float _warp_factor;
+	double _time;
+
+	std::vector<float> _pose_1, _pose_2;
+
+	osg::ref_ptr<renderer::Frame_capture> _frame_capture;
+	long _n_captures;
+};
+
+
+#endif
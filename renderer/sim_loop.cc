@@ -15,24 +15,28 @@
 */
 
 #include "sim_loop.hh"
+#include "ode/profiler.hh"
+#include <cerrno>
+#include <cmath>
+#include <exception>
 
 
 Sim_loop::Sim_loop( float timestep, renderer::OsgVisitor* display_ptr, bool print_time, int log_level ) :
                     _timestep( timestep ), _display_ptr( display_ptr ), _log_level( log_level ), _time( 0 ),
-					_print_time( print_time ), _nsec( 0 ), _is_paused( false ), _warp_factor( 1 )
+					_print_time( print_time ), _nsec( 0 ), _physics_thread( false ), _is_paused( false ), _warp_factor( 1 )
 {
+	reset_frame_stats();
+
 	if ( _display_ptr != nullptr )
 	{
 		_fps = DEFAULT_FPS;
 		_ufperiod = 1e6/_fps;
 		_utimestep = _timestep*1e6;
-		_chrono = 0;
 		_step_counter_u = 0;
 		_stopped = false;
 		_fps_captures = DEFAULT_FPS;
 		_capture_rate = int( 1./_fps_captures/_timestep );
 		_capture = false;
-		_image = nullptr;
 
 		_paused_text = _display_ptr->add_text( "", 0 );
 		_paused_text->set_pos( 50, 95 );
@@ -46,8 +50,7 @@ Sim_loop::Sim_loop( float timestep, renderer::OsgVisitor* display_ptr, bool prin
 
 		_display_ptr->update();
 
-		gettimeofday( &_tv, nullptr );
-		_old_clock = 1e6*_tv.tv_sec + _tv.tv_usec;
+		_frame_deadline = sim_clock::now() + std::chrono::microseconds( _ufperiod );
 	}
 }
 
@@ -59,16 +62,19 @@ void Sim_loop::set_fps_captures( int fps )
 }
 
 
-void Sim_loop::start_captures( const char* path )
+void Sim_loop::start_captures( const char* path ) { _start_captures( new renderer::Frame_capture( path ) ); }
+
+
+void Sim_loop::start_capture_pipe( const char* command ) { _start_captures( renderer::Frame_capture::pipe( command ) ); }
+
+
+void Sim_loop::_start_captures( osg::ref_ptr<renderer::Frame_capture> capture )
 {
 	assert( _display_ptr != nullptr );
 
-	_path_captures = path;
-
-	if ( _image == nullptr )
-		_image = new osg::Image;
-	_image->allocateImage( _display_ptr->get_window_width(), _display_ptr->get_window_height(), 1, GL_RGBA, GL_UNSIGNED_BYTE );
-	_display_ptr->get_viewer()->getCamera()->attach( osg::Camera::COLOR_BUFFER, _image.get() );
+	stop_captures();
+	_frame_capture = capture;
+	_frame_capture->attach( _display_ptr->get_viewer()->getCamera() );
 	_step_counter_c = 0;
 
 	_capture = true;
@@ -77,19 +83,86 @@ void Sim_loop::start_captures( const char* path )
 
 void Sim_loop::stop_captures()
 {
-	//_display_ptr->get_viewer()->getCamera()->detach( osg::Camera::COLOR_BUFFER );
-	//delete _image;
+	if ( _frame_capture.valid() )
+	{
+		// The last frame requested is read back at the next rendering:
+		if ( ! _display_ptr->done() )
+			_display_ptr->update();
+		_frame_capture->detach( _display_ptr->get_viewer()->getCamera() );
+		// Wait for the encoding of the remaining frames:
+		_frame_capture = nullptr;
+	}
 
 	_capture = false;
 }
 
 
-void Sim_loop::_update_chrono()
+void Sim_loop::_next_frame( const sim_clock::time_point& now )
 {
-	gettimeofday( &_tv, nullptr );
-	_new_clock = 1e6*_tv.tv_sec + _tv.tv_usec;
-	_chrono += _new_clock - _old_clock;
-	_old_clock = _new_clock;
+	double jitter = std::chrono::duration<double,std::micro>( now - _frame_deadline ).count();
+	_jitter_sum += jitter;
+	_jitter_sq_sum += jitter*jitter;
+	_jitter_max = std::max( _jitter_max, jitter );
+	if ( _n_frames == 0 )
+		_first_frame = now;
+	else
+		_period_max = std::max( _period_max, std::chrono::duration<double,std::micro>( now - _last_frame ).count() );
+	_last_frame = now;
+	_n_frames++;
+
+	// The deadlines follow each other by exactly a period, unless the loop is too late to catch up:
+	if ( jitter > _ufperiod )
+	{
+		_n_late++;
+		_frame_deadline = now + std::chrono::microseconds( _ufperiod );
+	}
+	else
+		_frame_deadline += std::chrono::microseconds( _ufperiod );
+}
+
+
+void Sim_loop::_sleep_until( const sim_clock::time_point& deadline )
+{
+	// steady_clock is based on CLOCK_MONOTONIC:
+	long long ns = std::chrono::duration_cast<std::chrono::nanoseconds>( deadline.time_since_epoch() ).count();
+	timespec ts;
+	ts.tv_sec = ns/1000000000;
+	ts.tv_nsec = ns%1000000000;
+	while ( clock_nanosleep( CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, nullptr ) == EINTR );
+}
+
+
+frame_stats Sim_loop::get_frame_stats() const
+{
+	frame_stats stats;
+	stats.n_frames = _n_frames;
+	stats.n_late = _n_late;
+	stats.mean_jitter = _n_frames > 0 ? _jitter_sum/_n_frames : 0;
+	stats.rms_jitter = _n_frames > 0 ? sqrt( _jitter_sq_sum/_n_frames ) : 0;
+	stats.max_jitter = _jitter_max;
+	stats.mean_period = _n_frames > 1 ? std::chrono::duration<double,std::micro>( _last_frame - _first_frame ).count()/( _n_frames - 1 ) : 0;
+	stats.max_period = _period_max;
+	return stats;
+}
+
+
+void Sim_loop::reset_frame_stats()
+{
+	_n_frames = 0;
+	_n_late = 0;
+	_jitter_sum = 0;
+	_jitter_sq_sum = 0;
+	_jitter_max = 0;
+	_period_max = 0;
+}
+
+
+void Sim_loop::print_frame_stats( FILE* stream ) const
+{
+	frame_stats stats = get_frame_stats();
+	fprintf( stream, "> %ld frames, period %.0f µs ( target %ld, max %.0f ) | jitter mean %.0f µs, rms %.0f, max %.0f | %ld late\n",
+	         stats.n_frames, stats.mean_period, _ufperiod, stats.max_period, stats.mean_jitter, stats.rms_jitter, stats.max_jitter, stats.n_late );
+	fflush( stream );
 }
 
 
@@ -104,54 +177,68 @@ void Sim_loop::_do_print_time()
 }
 
 
+void Sim_loop::_update_controls()
+{
+	if ( _is_paused != _display_ptr->get_keh()->paused() )
+	{
+		_is_paused = !_is_paused;
+		if ( _is_paused )
+			_paused_text->set_text( "PAUSED" );
+		else
+			_paused_text->set_text( "" );
+	}
+
+	if ( _warp_factor != _display_ptr->get_keh()->get_warp_factor() )
+	{
+		_warp_factor = _display_ptr->get_keh()->get_warp_factor();
+		set_timewarp( _warp_factor );
+		if ( _warp_factor == 1 )
+			_warp_text->set_text( "" );
+		else if ( _warp_factor > 1 )
+			_warp_text->set_text( std::string( "real time \u00D7" ) + std::to_string( int( _warp_factor ) ) );
+		else if ( _warp_factor < 1 )
+			_warp_text->set_text( std::string( "real time \u00F7" ) + std::to_string( int( 1/_warp_factor ) ) );
+	}
+}
+
+
 void Sim_loop::loop( std::function<bool(float,double)> step_function )
 {
-	if ( _display_ptr != nullptr )
+	// Profile of this loop only:
+	ode::profiler::reset();
+	long first_step = _time;
+
+	if ( _display_ptr != nullptr && _physics_thread && ! _capture )
+		_threaded_loop( step_function );
+	else if ( _display_ptr != nullptr )
 	{
+		_frame_deadline = sim_clock::now() + std::chrono::microseconds( _ufperiod );
+
 		while( !_display_ptr->done() )
 		{
-			_update_chrono();
+			_update_controls();
 
-			if ( _is_paused != _display_ptr->get_keh()->paused() )
-			{
-				_is_paused = !_is_paused;
-				if ( _is_paused )
-					_paused_text->set_text( "PAUSED" );
-				else
-					_paused_text->set_text( "" );
-			}
-
-			if ( _warp_factor != _display_ptr->get_keh()->get_warp_factor() )
-			{
-				_warp_factor = _display_ptr->get_keh()->get_warp_factor();
-				set_timewarp( _warp_factor );
-				if ( _warp_factor == 1 )
-					_warp_text->set_text( "" );
-				else if ( _warp_factor > 1 )
-					_warp_text->set_text( std::string( "real time \u00D7" ) + std::to_string( int( _warp_factor ) ) );
-				else if ( _warp_factor < 1 )
-					_warp_text->set_text( std::string( "real time \u00F7" ) + std::to_string( int( 1/_warp_factor ) ) );
-			}
-
-			if ( _chrono >= _ufperiod )
+			sim_clock::time_point now = sim_clock::now();
+			if ( now >= _frame_deadline )
 			{
 				_display_ptr->update();
 
 				bool overrun = _utimestep*_step_counter_u < _ufperiod && !_stopped;
+				// Wall-clock time of the frame not covered by the simulation:
+				long lag = _ufperiod + std::chrono::duration_cast<std::chrono::microseconds>( now - _frame_deadline ).count() - _utimestep*_step_counter_u;
 
 				if ( _log_level == 1 && overrun )
-					fprintf( stderr, "\033[1;31mOverrun: %li µs\033[0;39m\n", _chrono - _utimestep*_step_counter_u );
+					fprintf( stderr, "\033[1;31mOverrun: %li µs\033[0;39m\n", lag );
 				else if ( _log_level >= 2 )
 				{
 					osg::Vec3f eye, center, up;
 					_display_ptr->get_viewer()->getCamera()->getViewMatrixAsLookAt( eye, center, up );
 					printf( "%sDisplay lead: %+6li%s | eye: %f %f %f | center: %f %f %f | up: %f %f %f\n",
-					        overrun ? "\033[1;31m" : "", overrun ? _utimestep*_step_counter_u - _chrono : _display_lead, overrun ? "\033[0;39m" : "",
+					        overrun ? "\033[1;31m" : "", overrun ? -lag : _display_lead, overrun ? "\033[0;39m" : "",
 							eye.x(), eye.y(), eye.z(), center.x(), center.y(), center.z(), up.x(), up.y(), up.z() );
 				}
 
-				//_chrono = 0;
-				_chrono -= _ufperiod;
+				_next_frame( now );
 				_step_counter_u = 0;
 				_stopped = false;
 			}
@@ -170,10 +257,8 @@ void Sim_loop::loop( std::function<bool(float,double)> step_function )
 					{
 						if ( _step_counter_c % _capture_rate == 0 )
 						{
-							char image_path[PATH_MAX];
-							sprintf( image_path, _path_captures, _step_counter_c/_capture_rate );
+							_frame_capture->request( _step_counter_c/_capture_rate );
 							_display_ptr->update();
-							osgDB::writeImageFile( *_image, image_path );
 						}
 						_step_counter_c++;
 					}
@@ -184,20 +269,16 @@ void Sim_loop::loop( std::function<bool(float,double)> step_function )
 				}
 				else
 				{
-					_update_chrono();
-					_display_lead = _ufperiod - _chrono;
-					if ( _display_lead > 0 )
-						usleep( _display_lead );
+					_display_lead = std::chrono::duration_cast<std::chrono::microseconds>( _frame_deadline - sim_clock::now() ).count();
+					_sleep_until( _frame_deadline );
 				}
 			}
 			else
 			{
 				_stopped = true;
 
-				_update_chrono();
-				_display_lead = _ufperiod - _chrono;
-				if ( _display_lead > 0 )
-					usleep( _display_lead );
+				_display_lead = std::chrono::duration_cast<std::chrono::microseconds>( _frame_deadline - sim_clock::now() ).count();
+				_sleep_until( _frame_deadline );
 			}
 		}
 	}
@@ -214,6 +295,130 @@ void Sim_loop::loop( std::function<bool(float,double)> step_function )
 			_time++;
 		}
 	}
+
+	if ( _display_ptr != nullptr && _log_level >= 1 )
+		print_frame_stats();
+
+	// Time spent in each phase of the steps ( when compiled with ROBDYN_PROFILING ):
+	if ( ode::profiler::enabled() )
+		ode::profiler::print_summary( stderr, ( _time - first_step )*_timestep );
+}
+
+
+void Sim_loop::_threaded_loop( std::function<bool(float,double)>& step_function )
+{
+	renderer::Pose_buffer poses( _display_ptr->get_moving_objects() );
+	poses.publish( get_time() );
+	_display_ptr->set_replay( true );
+
+	// Controls of the keyboard forwarded by the rendering thread:
+	std::atomic<bool> paused( _display_ptr->get_keh()->paused() );
+	std::atomic<int> single_steps( 0 );
+	std::atomic<float> warp_factor( _warp_factor );
+	std::atomic<bool> quit( false );
+	std::atomic<bool> finished( false );
+
+	// Profile of the physics thread, merged into that of the calling thread, and exception raised by the step function:
+	ode::profiler::counters_t physics_counters = ode::profiler::counters_t();
+	std::exception_ptr physics_error;
+
+	// Physics at the real-time rate, anchored again on the clock after each pause or change of warp factor:
+	std::thread physics( [&]()
+	{
+		try
+		{
+			sim_clock::time_point anchor = sim_clock::now();
+			long anchor_step = _time;
+			float warp = warp_factor;
+
+			while ( ! quit )
+			{
+				bool single_step = false;
+				if ( paused )
+				{
+					single_step = single_steps > 0;
+					if ( ! single_step )
+					{
+						std::this_thread::sleep_for( std::chrono::milliseconds( 1 ) );
+						anchor = sim_clock::now();
+						anchor_step = _time;
+						continue;
+					}
+					single_steps--;
+				}
+				if ( warp != warp_factor )
+				{
+					warp = warp_factor;
+					anchor = sim_clock::now();
+					anchor_step = _time;
+				}
+
+				auto step_time = anchor + std::chrono::duration_cast<sim_clock::duration>( std::chrono::duration<double>( ( _time - anchor_step )*_timestep/warp ) );
+				auto now = sim_clock::now();
+				if ( ! single_step && step_time > now )
+				{
+					_sleep_until( std::min( step_time, now + std::chrono::milliseconds( 1 ) ) );
+					continue;
+				}
+
+				// Give up catching up when the physics is slower than real time by more than a frame:
+				double lag = std::chrono::duration<double>( now - step_time ).count();
+				if ( lag*1e6 > _ufperiod )
+				{
+					if ( _log_level == 1 )
+						fprintf( stderr, "\033[1;31mOverrun: %li µs\033[0;39m\n", long( lag*1e6 ) );
+					anchor = now;
+					anchor_step = _time;
+				}
+
+				if ( _print_time )
+					_do_print_time();
+
+				bool done = step_function( _timestep, _time*_timestep );
+				_time++;
+				poses.publish( get_time() );
+
+				if ( done )
+					break;
+			}
+		}
+		catch ( ... )
+		{
+			physics_error = std::current_exception();
+		}
+		physics_counters = ode::profiler::counters();
+		finished = true;
+	} );
+
+	_frame_deadline = sim_clock::now();
+	while ( ! _display_ptr->done() && ! finished )
+	{
+		_next_frame( sim_clock::now() );
+
+		_update_controls();
+		paused = _display_ptr->get_keh()->paused();
+		if ( _display_ptr->get_keh()->do_single_step() )
+			single_steps++;
+		warp_factor = _warp_factor;
+
+		poses.apply( *_display_ptr );
+		_display_ptr->update();
+
+		_sleep_until( _frame_deadline );
+	}
+
+	quit = true;
+	physics.join();
+	ode::profiler::merge( physics_counters );
+
+	// Last state of the simulation:
+	poses.apply( *_display_ptr );
+	if ( ! _display_ptr->done() )
+		_display_ptr->update();
+	_display_ptr->set_replay( false );
+
+	if ( physics_error )
+		std::rethrow_exception( physics_error );
 }
 
 
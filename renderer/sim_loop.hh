@@ -18,16 +18,38 @@
 #define SIM_LOOP_HH 
 
 #include "renderer/osg_visitor.hh"
-#include <sys/time.h>
-#include <unistd.h>
+#include <time.h>
 #include <osgDB/ReadFile>
 #include <osgDB/WriteFile>
 #include "renderer/osg_text.hh"
+#include "renderer/frame_capture.hh"
+#include "renderer/pose_buffer.hh"
+#include <atomic>
+#include <thread>
+#include <chrono>
 
 
 #define DEFAULT_TIMESTEP 0.001 // Seconds
 #define DEFAULT_FPS 25 // Frames per second
-#define DEFAULT_CAPTURE_PATH "/tmp/robdyn_%05d.bmp"
+#define DEFAULT_CAPTURE_PATH "/tmp/robdyn_%05d.png"
+
+
+typedef std::chrono::steady_clock sim_clock;
+
+
+// Pacing of the displayed frames, in microseconds. The jitter of a frame is the delay between its deadline and its rendering:
+typedef struct frame_stats
+{
+	long n_frames;
+	// Frames rendered more than a period after their deadline, after which the deadlines are anchored again on the clock:
+	long n_late;
+	double mean_jitter;
+	double rms_jitter;
+	double max_jitter;
+	// Intervals between consecutive frames:
+	double mean_period;
+	double max_period;
+} frame_stats;
 
 
 class Sim_loop
@@ -43,15 +65,31 @@ class Sim_loop
 
 	inline void set_timewarp( float warp_factor ) { _utimestep = _timestep*1e6/warp_factor; }
 
+	// Run the physics on its own thread, the rendering only reading the latest poses it has published,
+	// so that a slow rendering does not slow the simulation down. The callbacks of the texts of the display
+	// then run concurrently with the simulation. Ignored while capturing frames, each of which has to wait
+	// for the simulation to reach its time.
+	inline void set_physics_thread( bool physics_thread ) { _physics_thread = physics_thread; }
+
 	virtual void set_fps_captures( int fps );
+	// The frames are encoded in the background, to files ( see renderer::Frame_capture ) or piped to a command:
 	virtual void start_captures( const char* path = DEFAULT_CAPTURE_PATH );
+	virtual void start_capture_pipe( const char* command );
 	virtual void stop_captures();
 
+	frame_stats get_frame_stats() const;
+	void reset_frame_stats();
+	void print_frame_stats( FILE* stream = stderr ) const;
+
 	virtual ~Sim_loop();
 
 	protected:
 
-	virtual void _update_chrono();
+	virtual void _next_frame( const sim_clock::time_point& now );
+	// Sleep on CLOCK_MONOTONIC up to an absolute deadline, so that the delays of the wake-ups do not add up:
+	static void _sleep_until( const sim_clock::time_point& deadline );
+	virtual void _update_controls();
+	virtual void _threaded_loop( std::function<bool(float,double)>& step_function );
 	virtual void _do_print_time();
 
 	float _timestep;
@@ -62,21 +100,26 @@ class Sim_loop
 	long _nsec;
 
 	int _fps;
-	timeval _tv;
-	unsigned long long _old_clock, _new_clock;
-	unsigned long _chrono;
+	sim_clock::time_point _frame_deadline;
 	long _ufperiod, _utimestep;
 	unsigned int _step_counter_u;
 	bool _stopped;
 	long _display_lead;
 
+	virtual void _start_captures( osg::ref_ptr<renderer::Frame_capture> capture );
+
 	bool _capture;
-	const char* _path_captures;
 	int _fps_captures;
 	unsigned int _capture_rate;
-	osg::ref_ptr<osg::Image> _image;
+	osg::ref_ptr<renderer::Frame_capture> _frame_capture;
 	unsigned int _step_counter_c;
 
+	bool _physics_thread;
+
+	long _n_frames, _n_late;
+	double _jitter_sum, _jitter_sq_sum, _jitter_max, _period_max;
+	sim_clock::time_point _first_frame, _last_frame;
+
 	bool _is_paused;
 	renderer::OsgText::ptr_t _paused_text;
 
@@ -53,6 +53,7 @@ def critic( s_dim, a_dim ) :
 # Parameters for the training:
 EP_MAX = 100000 # Maximal number of episodes for the training
 ITER_PER_EP = 200 # Number of training iterations between each episode
+N_ENVS = 1 # Number of episodes collected in parallel by each trial
 hyper_params = {}
 hyper_params['s_dim'] = 17 # Dimension of the state space
 hyper_params['a_dim'] = 2 # Dimension of the action space
@@ -92,6 +93,13 @@ else :
 
 np.random.seed( hyper_params['seed'] )
 
+
+# Ring buffer in which the simulations write their transitions, large enough to hold the experience of one round of trials:
+experience = rover_training_1_module.ExperienceBuffer( 1000*N_ENVS )
+# View on its storage, without copy:
+experience_array = np.asarray( experience.array() )
+s_dim, a_dim = hyper_params['s_dim'], hyper_params['a_dim']
+
 n_ep = 0
 LQ = 0
 
@@ -103,20 +111,25 @@ with Loop_handler() as interruption :
 	while not interruption() and n_ep < EP_MAX :
 
 
-		# Do one trial:
-		trial_experience = rover_training_1_module.trial( session_dir + '/actor' )
+		# Do one trial, or N_ENVS trials in parallel:
+		if N_ENVS > 1 :
+			n_transitions = rover_training_1_module.trials( session_dir + '/actor', N_ENVS, experience )
+		else :
+			n_transitions = rover_training_1_module.trial( session_dir + '/actor', experience )
 
 		if interruption() :
 			break
 
-		# Store the experience:
-		td3.replay_buffer.extend( trial_experience )
+		# Store the experience recorded since the last round:
+		rows = experience_array[ np.arange( experience.head - n_transitions, experience.head ) % experience.capacity ]
+		s, a, r, d, s2 = np.split( rows, [ s_dim, s_dim + a_dim, s_dim + a_dim + 1, s_dim + a_dim + 2 ], axis=1 )
+		td3.replay_buffer.extend( zip( s, a, r[:,0], d[:,0].astype( bool ), s2 ) )
 
-		n_ep += 1
+		n_ep += N_ENVS
 
 
 		# Train the networks:
-		LQ = td3.train( ITER_PER_EP )
+		LQ = td3.train( ITER_PER_EP*N_ENVS )
 
 		td3.actor.save( session_dir + '/actor' )
 
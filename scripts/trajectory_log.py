@@ -0,0 +1,75 @@
+#!/usr/bin/env python3
+"""
+Reader of the binary trajectory logs written by ode::Trajectory_writer ( see ode/trajectory_log.hh ).
+
+The records are mapped in memory as a NumPy structured array, with one field per field of the layout:
+
+	log = read( '../scripts/transitions.trj' )
+	log['time'], log['poses'][:,:7], log['state'][log['tick'] == 1]
+
+Run as a script to print the layout and the number of records and episodes of a log.
+"""
+import numpy as np
+import sys
+
+
+MAGIC = b'TRJ1'
+
+_header_dtype = np.dtype( [ ( 'magic', 'S4' ), ( 'n_fields', '<u4' ), ( 'record_size', '<u4' ), ( 'header_size', '<u4' ), ( 'padding', 'V48' ) ] )
+_field_dtype = np.dtype( [ ( 'name', 'S48' ), ( 'type', '<u4' ), ( 'count', '<u4' ), ( 'offset', '<u4' ), ( 'padding', '<u4' ) ] )
+_types = { ord( 'f' ): '<f4', ord( 'd' ): '<f8', ord( 'i' ): '<i4' }
+
+
+def layout( path ) :
+	""" Structured dtype of the records and offset of the first one. """
+	with open( path, 'rb' ) as f :
+		header = np.frombuffer( f.read( _header_dtype.itemsize ), _header_dtype )[0]
+		if header['magic'] != MAGIC :
+			raise ValueError( 'Invalid trajectory log ' + path )
+		fields = np.frombuffer( f.read( _field_dtype.itemsize*header['n_fields'] ), _field_dtype )
+
+	names, formats, offsets = [], [], []
+	for field in fields :
+		names.append( field['name'].decode() )
+		formats.append( ( _types[field['type']], ( field['count'], ) ) if field['count'] != 1 else _types[field['type']] )
+		offsets.append( int( field['offset'] ) )
+	dtype = np.dtype( { 'names': names, 'formats': formats, 'offsets': offsets, 'itemsize': int( header['record_size'] ) } )
+
+	return dtype, int( header['header_size'] )
+
+
+def read( path, mode='r' ) :
+	""" Records of the log, mapped in memory ( read-only by default ). """
+	dtype, offset = layout( path )
+	return np.memmap( path, dtype=dtype, mode=mode, offset=offset )
+
+
+def episodes( log ) :
+	""" Split the records into a list of episodes. """
+	boundaries = np.flatnonzero( np.diff( log['episode'] ) ) + 1
+	return np.split( log, boundaries )
+
+
+def transitions( log ) :
+	""" States, actions, rewards and next states of the transitions between the control ticks of each episode. """
+	s, a, r, s2 = [], [], [], []
+	for episode in episodes( log ) :
+		ticks = episode[episode['tick'] == 1]
+		s.append( ticks['state'][:-1] )
+		a.append( ticks['action'][:-1] )
+		r.append( ticks['reward'][1:] )
+		s2.append( ticks['state'][1:] )
+	return np.concatenate( s ), np.concatenate( a ), np.concatenate( r ), np.concatenate( s2 )
+
+
+if __name__ == '__main__' :
+
+	if len( sys.argv ) < 2 :
+		print( 'Usage: %s <log.trj>' % sys.argv[0], file=sys.stderr )
+		exit( -1 )
+
+	log = read( sys.argv[1] )
+	for name in log.dtype.names :
+		field, offset = log.dtype.fields[name]
+		print( '%-10s %-6s %5d values at offset %d' % ( name, field.base.str, max( 1, int( np.prod( field.shape ) ) ), offset ) )
+	print( '%d records of %d bytes, %d episodes' % ( len( log ), log.dtype.itemsize, len( np.unique( log['episode'] ) ) if 'episode' in log.dtype.names else 0 ) )
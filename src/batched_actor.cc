@@ -0,0 +1,130 @@
+#include "batched_actor.hh"
+#include <boost/weak_ptr.hpp>
+#include <thread>
+#include <map>
+#include <algorithm>
+#include <stdexcept>
+
+
+Batched_actor::Batched_actor( const char* path_to_model_dir, int state_dim, int action_dim, int max_batch, double max_wait ) :
+                              _model( path_to_model_dir, { state_dim }, { action_dim } ),
+                              _state_dim( state_dim ),
+                              _action_dim( action_dim ),
+                              _max_batch( max_batch > 0 ? max_batch : std::max( 1u, std::thread::hardware_concurrency() ) ),
+                              _max_wait( max_wait ),
+                              _batch_error( std::make_shared<std::exception_ptr>() ),
+                              _n_clients( 0 ),
+                              _running( false ),
+                              _batch_id( 0 ),
+                              _n_requests( 0 ),
+                              _n_batches( 0 )
+{
+}
+
+
+// Models currently in use, indexed by their directory:
+static std::mutex _registry_mutex;
+static std::map<std::string,boost::weak_ptr<Batched_actor>> _registry;
+
+
+Batched_actor::ptr_t Batched_actor::get( const char* path_to_model_dir, int state_dim, int action_dim )
+{
+	std::lock_guard<std::mutex> lock( _registry_mutex );
+
+	ptr_t actor = _registry[path_to_model_dir].lock();
+	if ( ! actor )
+	{
+		actor = ptr_t( new Batched_actor( path_to_model_dir, state_dim, action_dim ) );
+		_registry[path_to_model_dir] = actor;
+	}
+	else if ( actor->state_dim() != state_dim || actor->action_dim() != action_dim )
+		throw std::runtime_error( std::string( "Actor model " ) + std::string( path_to_model_dir ) + std::string( " already loaded with other dimensions" ) );
+
+	return actor;
+}
+
+
+void Batched_actor::join()
+{
+	std::lock_guard<std::mutex> lock( _mutex );
+	_n_clients++;
+}
+
+
+void Batched_actor::leave()
+{
+	std::lock_guard<std::mutex> lock( _mutex );
+	_n_clients--;
+	// The pending requests may not have to wait anymore:
+	_cond.notify_all();
+}
+
+
+void Batched_actor::infer( const float* state, float* action )
+{
+	std::unique_lock<std::mutex> lock( _mutex );
+
+	// The requests arriving during an inference go to the next batch:
+	_cond.wait( lock, [this]{ return ! _running; } );
+
+	_inputs.push_back( state );
+	_outputs.push_back( action );
+	std::shared_ptr<std::exception_ptr> error = _batch_error;
+	unsigned long batch_id = _batch_id;
+	auto deadline = std::chrono::steady_clock::now() + std::chrono::duration_cast<std::chrono::steady_clock::duration>( _max_wait );
+
+	// The first client to notice that the batch is complete or has waited too long runs it:
+	while ( _batch_id == batch_id )
+	{
+		if ( ! _running && ( _inputs.size() >= _batch_target() || std::chrono::steady_clock::now() >= deadline ) )
+			_run_batch( lock );
+		else if ( _running )
+			_cond.wait( lock );
+		else
+			_cond.wait_until( lock, deadline );
+	}
+
+	if ( *error )
+		std::rethrow_exception( *error );
+}
+
+
+void Batched_actor::_run_batch( std::unique_lock<std::mutex>& lock )
+{
+	_running = true;
+	std::vector<const float*> inputs;
+	std::vector<float*> outputs;
+	inputs.swap( _inputs );
+	outputs.swap( _outputs );
+	std::shared_ptr<std::exception_ptr> error = std::make_shared<std::exception_ptr>();
+	error.swap( _batch_error );
+	lock.unlock();
+
+	try
+	{
+		std::vector<std::vector<float>> input_vectors;
+		input_vectors.reserve( inputs.size() );
+		for ( const float* state : inputs )
+			input_vectors.push_back( std::vector<float>( state, state + _state_dim ) );
+
+		std::vector<std::vector<float>> output_vectors = _model.infer( input_vectors );
+
+		for ( size_t i = 0 ; i < outputs.size() ; i++ )
+			std::copy( output_vectors[i].begin(), output_vectors[i].begin() + _action_dim, outputs[i] );
+	}
+	catch ( ... )
+	{
+		// The outputs of the batch are left unset and the error is rethrown to each of its clients:
+		*error = std::current_exception();
+	}
+
+	lock.lock();
+	_running = false;
+	_batch_id++;
+	if ( ! *error )
+	{
+		_n_requests += inputs.size();
+		_n_batches++;
+	}
+	_cond.notify_all();
+}
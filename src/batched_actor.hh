@@ -0,0 +1,76 @@
+#ifndef BATCHED_ACTOR_HH
+#define BATCHED_ACTOR_HH
+
+#include "tf_cpp_binding.hh" // https://github.com/arthur-bouton/MachineLearning/tree/master/tf_cpp_binding
+#include <boost/shared_ptr.hpp>
+#include <string>
+#include <vector>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include <algorithm>
+#include <memory>
+#include <exception>
+
+
+// Actor model shared by several robots, possibly running in different threads.
+// The states submitted concurrently are gathered into a single forward pass and the actions are scattered back.
+// A batch is run as soon as every client that joined has submitted its state, when max_batch states are pending
+// or when the oldest pending state has waited for more than max_wait seconds.
+class Batched_actor
+{
+	public:
+
+	typedef boost::shared_ptr<Batched_actor> ptr_t;
+
+	// max_batch <= 0 means the number of hardware threads:
+	Batched_actor( const char* path_to_model_dir, int state_dim, int action_dim, int max_batch = 0, double max_wait = 1e-3 );
+
+	// Model of the given directory loaded only once per process and shared as long as it is in use:
+	static ptr_t get( const char* path_to_model_dir, int state_dim, int action_dim );
+
+	// Declare a client that will submit a state at each of its control ticks, or that will not anymore:
+	void join();
+	void leave();
+
+	// Compute the action for the given state, waiting for the other clients to form a batch.
+	// If the inference of the batch fails, its error is rethrown to every client of the batch:
+	void infer( const float* state, float* action );
+
+	inline int state_dim() const { return _state_dim; }
+	inline int action_dim() const { return _action_dim; }
+
+	// Statistics of the inferences since the creation of the model:
+	inline long GetRequestCount() const { return _n_requests; }
+	inline long GetBatchCount() const { return _n_batches; }
+	inline double GetMeanBatchSize() const { return _n_batches > 0 ? double( _n_requests )/_n_batches : 0; }
+
+	protected:
+
+	inline size_t _batch_target() const { return std::max( 1, std::min( _n_clients, _max_batch ) ); }
+
+	// Run the pending requests without holding the lock during the inference.
+	// An error of the inference is stored in the outcome of the batch instead of being thrown:
+	void _run_batch( std::unique_lock<std::mutex>& lock );
+
+	TF_model<float> _model;
+	const int _state_dim;
+	const int _action_dim;
+	int _max_batch;
+	std::chrono::duration<double> _max_wait;
+
+	std::mutex _mutex;
+	std::condition_variable _cond;
+	std::vector<const float*> _inputs;
+	std::vector<float*> _outputs;
+	// Error of the pending batch, shared with its clients:
+	std::shared_ptr<std::exception_ptr> _batch_error;
+	int _n_clients;
+	bool _running;
+	unsigned long _batch_id;
+	long _n_requests;
+	long _n_batches;
+};
+
+
+#endif
@@ -1,19 +1,29 @@
 /*
 ** To collect the data, run in bash:
-**    N=100 ; for i in $(seq 1 $N) ; do echo -ne "                       [$i/$N]\r" ; ./data_collection_tf -- >> ../scripts/transitions.dat ; done
+**    N=100 ; for i in $(seq 1 $N) ; do echo -ne "                       [$i/$N]\r" ; ./data_collection_tf ; done
+** Each run appends its episode to the binary log ../scripts/transitions.trj ( see src/rover_recorder.hh ),
+** to be loaded with scripts/trajectory_log.py.
+**
+** Arguments (optional, -- for the default value):
+** Orientation of the step.
+** display or capture.
+** Path to the TensorFlow model.
+** Path to the trajectory log.
 */
 #include "ode/environment.hh"
 #include "renderer/osg_visitor.hh"
 #include "rover_tf.hh"
+#include "rover_control.hh"
 #include "ode/box.hh"
 //#include "ode/heightfield.hh"
 #include "renderer/sim_loop.hh"
 #include "renderer/osg_text.hh"
-//#include <boost/python.hpp>
+#include "rover_recorder.hh"
 #include <random>
 
 
 #define DEFAULT_PATH_TO_TF_MODEL "../training_data/step_06_PER_1_no_sym/selected/rover_training_1_0005"
+#define DEFAULT_PATH_TO_LOG "../scripts/transitions.trj"
 
 
 
@@ -23,9 +33,6 @@ int main( int argc, char* argv[] )
 	putenv( tf_verbosity );
 
 
-	Py_Initialize();
-
-
 	// Normal distribution:
 	std::random_device rd;
 	std::mt19937 gen( rd() );
@@ -53,6 +60,27 @@ int main( int argc, char* argv[] )
 	robot.DeactivateIC();
 
 
+	// [ Trajectory log ]
+
+	std::string path_to_log( argc > 4 && strncmp( argv[4], "--", 3 ) != 0 ? argv[4] : DEFAULT_PATH_TO_LOG );
+
+	// The episode follows the last one of the log:
+	int episode = 0;
+	try
+	{
+		ode::Trajectory_reader log( path_to_log );
+		int field = log.layout().find( "episode" );
+		if ( log.size() > 0 && field >= 0 )
+			episode = log.get<int>( log.size() - 1, field ) + 1;
+	}
+	catch ( const std::runtime_error& ) {}
+
+	robot::Rover_recorder recorder( robot::Rover_recorder::open( path_to_log, robot, 2 ), episode );
+	// Period of the records between the control ticks, in steps:
+	const int record_period( 10 );
+	long n_steps = 0;
+
+
 	// [ Terrain ]
 
 	// Orientation angle of the step:
@@ -71,15 +99,19 @@ int main( int argc, char* argv[] )
 		orientation = uniform( gen )*max_rot;
 	}
 	float step_height( 0.105*2 );
-	ode::Box step( env, Eigen::Vector3d( 1.5, 0, step_height/2 ), 1, 1, 3, step_height, false );
+	float step_x( 1.5 );
+	ode::Box step( env, Eigen::Vector3d( step_x, 0, step_height/2 ), 1, 1, 3, step_height, false );
 	step.set_rotation( 0, 0, orientation*M_PI/180 );
 	step.fix();
 	step.set_collision_group( "ground" );
 
-	ode::Box step_c( env, Eigen::Vector3d( 2.5, 0, step_height/2 ), 1, 2, 3, step_height, false );
+	ode::Box step_c( env, Eigen::Vector3d( step_x + 1, 0, step_height/2 ), 1, 2, 3, step_height, false );
 	step_c.fix();
 	step_c.set_collision_group( "ground" );
 
+	// Terrain to be built again by the replay of the episode:
+	recorder.set_scenario( { float( orientation ), step_x } );
+
 
 	// [ Simulation rules ]
 
@@ -124,6 +156,11 @@ int main( int argc, char* argv[] )
 			robot.SetBoggieTorque( robot.GetBoggieTorque() + randn( gen )*bt_stddev );
 		}
 
+		// Every record_period steps, as well as at each control tick:
+		n_steps++;
+		if ( robot.ICTick() || n_steps % record_period == 0 )
+			recorder.record( robot, time, robot.GetLastReward() );
+
 		//printf( "x: %f y: %f\n", robot.GetPosition().x(), robot.GetPosition().y() );
 
 		// If the robot has reached the goal, is out of track or has tipped over, end the simulation:
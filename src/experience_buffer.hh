@@ -0,0 +1,135 @@
+#ifndef EXPERIENCE_BUFFER_HH
+#define EXPERIENCE_BUFFER_HH
+
+#include <boost/shared_ptr.hpp>
+#include <vector>
+#include <mutex>
+#include <algorithm>
+#include <stdexcept>
+
+
+// Preallocated ring buffer of transitions stored contiguously as rows of float32:
+//   [ state( state_dim ), action( action_dim ), reward, done, next_state( state_dim ) ]
+// Several robots can push into the same buffer from different threads.
+class Experience_buffer
+{
+	public:
+
+	typedef boost::shared_ptr<Experience_buffer> ptr_t;
+
+	Experience_buffer( int state_dim, int action_dim, long capacity ) :
+	                   _state_dim( state_dim ), _action_dim( action_dim ), _row_size( 2*state_dim + action_dim + 2 ),
+	                   _capacity( _check_capacity( capacity ) ), _count( 0 ), _data( _capacity*_row_size, 0.f ), _writers( 0 ) {}
+
+	inline int state_dim() const { return _state_dim; }
+	inline int action_dim() const { return _action_dim; }
+	inline int row_size() const { return _row_size; }
+
+	// Offsets of each field within a row:
+	inline int action_offset() const { return _state_dim; }
+	inline int reward_offset() const { return _state_dim + _action_dim; }
+	inline int done_offset() const { return _state_dim + _action_dim + 1; }
+	inline int next_state_offset() const { return _state_dim + _action_dim + 2; }
+
+	inline long capacity() const { return _capacity; }
+	// Total number of transitions pushed since the last clear, including the overwritten ones:
+	inline long count() const
+	{
+		std::lock_guard<std::mutex> lock( _mutex );
+		return _count;
+	}
+	// Number of transitions currently stored:
+	inline long size() const
+	{
+		std::lock_guard<std::mutex> lock( _mutex );
+		return std::min( _count, _capacity );
+	}
+	// Row where the next transition will be written:
+	inline long head() const
+	{
+		std::lock_guard<std::mutex> lock( _mutex );
+		return _count % _capacity;
+	}
+
+	// Whole storage of shape ( capacity, row_size ):
+	inline const float* data() const { return _data.data(); }
+
+	// Append a transition and return its index, to be used with terminate:
+	long push( const float* state, const float* action, float reward, bool done, const float* next_state )
+	{
+		std::lock_guard<std::mutex> lock( _mutex );
+
+		float* row = &_data[( _count % _capacity )*_row_size];
+		std::copy( state, state + _state_dim, row );
+		std::copy( action, action + _action_dim, row + action_offset() );
+		row[reward_offset()] = reward;
+		row[done_offset()] = done;
+		std::copy( next_state, next_state + _state_dim, row + next_state_offset() );
+
+		return _count++;
+	}
+
+	// Flag the transition of the given index as terminal and subtract a penalty from its reward.
+	// Returns false if it has already been overwritten:
+	bool terminate( long index, float penalty = 0 )
+	{
+		std::lock_guard<std::mutex> lock( _mutex );
+
+		if ( index < 0 || index >= _count || _count - index > _capacity )
+			return false;
+
+		float* row = &_data[( index % _capacity )*_row_size];
+		row[reward_offset()] -= penalty;
+		row[done_offset()] = 1;
+		return true;
+	}
+
+	// Discard the transitions pushed after the first count ones:
+	void rewind( long count )
+	{
+		std::lock_guard<std::mutex> lock( _mutex );
+		if ( count < _count )
+			_count = std::max( count, 0L );
+	}
+
+	void clear() { rewind( 0 ); }
+
+	// Registration of the robots pushing into the buffer, so that one of them can tell whether
+	// rewinding would discard the transitions of the others:
+	void add_writer()
+	{
+		std::lock_guard<std::mutex> lock( _mutex );
+		_writers++;
+	}
+	void remove_writer()
+	{
+		std::lock_guard<std::mutex> lock( _mutex );
+		_writers--;
+	}
+	int writers() const
+	{
+		std::lock_guard<std::mutex> lock( _mutex );
+		return _writers;
+	}
+
+	protected:
+
+	static long _check_capacity( long capacity )
+	{
+		if ( capacity <= 0 )
+			throw std::runtime_error( "The capacity of an experience buffer must be positive" );
+		return capacity;
+	}
+
+	const int _state_dim;
+	const int _action_dim;
+	const int _row_size;
+	const long _capacity;
+	long _count;
+	std::vector<float> _data;
+	int _writers;
+	mutable std::mutex _mutex;
+};
+
+
+#endif
@@ -0,0 +1,338 @@
+#ifndef FLAT_MODEL_TREE_HH
+#define FLAT_MODEL_TREE_HH
+
+#include <yaml-cpp/yaml.h>
+#include <boost/shared_ptr.hpp>
+#include <vector>
+#include <string>
+#include <limits>
+#include <stdexcept>
+#include <algorithm>
+
+
+// Monomials of a polynomial expansion without bias, in the same order as sklearn's PolynomialFeatures:
+// the raw inputs first, then the products of degree 2, 3... in lexicographic order.
+class Polynomial_features
+{
+	public:
+
+	Polynomial_features( int input_dim, unsigned int degree = 1, bool interaction_only = false ) : _input_dim( input_dim )
+	{
+		// Each monomial of degree d is the product of a monomial of degree d - 1 and of an input
+		// whose index is not lower than the last one of this monomial ( strictly greater if interaction_only ):
+		std::vector<int> last_index;
+		for ( int i = 0 ; i < input_dim ; i++ )
+		{
+			_parent.push_back( -1 );
+			_factor.push_back( i );
+			last_index.push_back( i );
+		}
+
+		int begin = 0;
+		for ( unsigned int d = 2 ; d <= degree ; d++ )
+		{
+			int end = _parent.size();
+			for ( int m = begin ; m < end ; m++ )
+				for ( int i = last_index[m] + ( interaction_only ? 1 : 0 ) ; i < input_dim ; i++ )
+				{
+					_parent.push_back( m );
+					_factor.push_back( i );
+					last_index.push_back( i );
+				}
+			begin = end;
+		}
+	}
+
+	inline int input_dim() const { return _input_dim; }
+	inline int output_dim() const { return _parent.size(); }
+
+	template<typename T>
+	inline void transform( const T* x, T* features ) const
+	{
+		for ( int m = 0 ; m < _input_dim ; m++ )
+			features[m] = x[m];
+		for ( size_t m = _input_dim ; m < _parent.size() ; m++ )
+			features[m] = features[_parent[m]]*x[_factor[m]];
+	}
+
+	// Same for n inputs stored by feature with a stride between consecutive features:
+	template<typename T>
+	inline void transform_batch( const T* x, int n, int stride, T* features ) const
+	{
+		for ( int m = 0 ; m < _input_dim ; m++ )
+			std::copy( x + m*stride, x + m*stride + n, features + m*stride );
+		for ( size_t m = _input_dim ; m < _parent.size() ; m++ )
+		{
+			const T* parent = features + _parent[m]*stride;
+			const T* factor = x + _factor[m]*stride;
+			T* feature = features + m*stride;
+			for ( int i = 0 ; i < n ; i++ )
+				feature[i] = parent[i]*factor[i];
+		}
+	}
+
+	protected:
+
+	int _input_dim;
+	std::vector<int> _parent;
+	std::vector<int> _factor;
+};
+
+
+// Model tree compiled into flat arrays of nodes ( structure of arrays ), loaded from the YAML parameters of a tree.
+// Each node is either:
+//   - an axis-aligned split:  { split_index: i, split_value: v, low: <node>, high: <node> }
+//   - an oblique split:       { split_weights: [ w ], split_value: v, low: <node>, high: <node> }
+//   - a leaf:                 { coefs: [ c ], intercept: b }
+// The low child is taken when the split feature ( or the weighted sum of the inputs ) is lower or equal to the split value.
+// The leaves loop on themselves so that any state reaches its leaf after exactly depth() iterations, without branching.
+template<typename T>
+class Flat_model_tree
+{
+	public:
+
+	Flat_model_tree( const std::string& yaml_file_path, int input_dim, int n_features, bool oblique = false ) :
+	                 _input_dim( input_dim ), _n_features( n_features ), _oblique( oblique ), _depth( 0 )
+	{
+		YAML::Node root;
+		try
+		{
+			root = YAML::LoadFile( yaml_file_path );
+		}
+		catch ( const YAML::Exception& e )
+		{
+			throw std::runtime_error( "Unable to load the model tree " + yaml_file_path + ": " + e.what() );
+		}
+		_add_node( root, 0, yaml_file_path );
+	}
+
+	inline int n_nodes() const { return _low.size(); }
+	inline int n_leaves() const { return _intercept.size(); }
+	inline int depth() const { return _depth; }
+
+	// Index of the leaf in which the state x falls:
+	inline int find_leaf( const T* x ) const
+	{
+		int k = 0;
+		while ( _leaf[k] < 0 )
+			k = _split( x, k ) <= _threshold[k] ? _low[k] : _high[k];
+		return _leaf[k];
+	}
+
+	// Output of the linear model of a leaf for the given features:
+	inline T predict_leaf( int leaf, const T* features ) const
+	{
+		const T* coefs = &_coefs[leaf*_n_features];
+		T y = _intercept[leaf];
+		for ( int j = 0 ; j < _n_features ; j++ )
+			y += coefs[j]*features[j];
+		return y;
+	}
+
+	inline T predict( const T* x, const T* features, int& leaf ) const
+	{
+		leaf = find_leaf( x );
+		return predict_leaf( leaf, features );
+	}
+
+	// Evaluation of n states at once, with the inputs and features stored by feature with a stride between consecutive ones.
+	// The loops run over the states in the innermost position so that the compiler can vectorise them.
+	// nodes is a buffer of size n used to store the indices of the current nodes.
+	void predict_batch( const T* x, const T* features, int n, int stride, T* y, int* leaves, int* nodes ) const
+	{
+		std::fill( nodes, nodes + n, 0 );
+
+		for ( int level = 0 ; level < _depth ; level++ )
+		{
+			if ( _oblique )
+				for ( int i = 0 ; i < n ; i++ )
+				{
+					const int k = nodes[i];
+					const T* w = &_weights[k*_input_dim];
+					T s = 0;
+					for ( int f = 0 ; f < _input_dim ; f++ )
+						s += w[f]*x[f*stride + i];
+					nodes[i] = s <= _threshold[k] ? _low[k] : _high[k];
+				}
+			else
+				for ( int i = 0 ; i < n ; i++ )
+				{
+					const int k = nodes[i];
+					nodes[i] = x[_feature[k]*stride + i] <= _threshold[k] ? _low[k] : _high[k];
+				}
+		}
+
+		for ( int i = 0 ; i < n ; i++ )
+		{
+			leaves[i] = _leaf[nodes[i]];
+			y[i] = _intercept[leaves[i]];
+		}
+		for ( int j = 0 ; j < _n_features ; j++ )
+		{
+			const T* feature = features + j*stride;
+			for ( int i = 0 ; i < n ; i++ )
+				y[i] += _coefs[leaves[i]*_n_features + j]*feature[i];
+		}
+	}
+
+	protected:
+
+	inline T _split( const T* x, int k ) const
+	{
+		if ( ! _oblique )
+			return x[_feature[k]];
+
+		const T* w = &_weights[k*_input_dim];
+		T s = 0;
+		for ( int f = 0 ; f < _input_dim ; f++ )
+			s += w[f]*x[f];
+		return s;
+	}
+
+	// Append a node and its subtree in depth-first order and return its index:
+	int _add_node( const YAML::Node& node, int depth, const std::string& path )
+	{
+		int k = _low.size();
+		_feature.push_back( 0 );
+		_threshold.push_back( std::numeric_limits<T>::max() );
+		_low.push_back( k );
+		_high.push_back( k );
+		_leaf.push_back( -1 );
+		if ( _oblique )
+			_weights.resize( _weights.size() + _input_dim, 0 );
+		_depth = std::max( _depth, depth );
+
+		if ( node["coefs"] )
+		{
+			std::vector<T> coefs = node["coefs"].as<std::vector<T>>();
+			if ( int( coefs.size() ) != _n_features )
+				throw std::runtime_error( "Unexpected number of coefficients in the model tree " + path );
+			_leaf[k] = _intercept.size();
+			_intercept.push_back( node["intercept"] ? node["intercept"].as<T>() : T( 0 ) );
+			_coefs.insert( _coefs.end(), coefs.begin(), coefs.end() );
+			return k;
+		}
+
+		if ( ! node["low"] || ! node["high"] || ! node["split_value"] )
+			throw std::runtime_error( "Invalid node in the model tree " + path );
+
+		_threshold[k] = node["split_value"].as<T>();
+		if ( _oblique )
+		{
+			std::vector<T> weights = node["split_weights"].as<std::vector<T>>();
+			if ( int( weights.size() ) != _input_dim )
+				throw std::runtime_error( "Unexpected number of split weights in the model tree " + path );
+			std::copy( weights.begin(), weights.end(), _weights.begin() + k*_input_dim );
+		}
+		else
+		{
+			_feature[k] = node["split_index"].as<int>();
+			if ( _feature[k] < 0 || _feature[k] >= _input_dim )
+				throw std::runtime_error( "Split index out of range in the model tree " + path );
+		}
+
+		int low = _add_node( node["low"], depth + 1, path );
+		int high = _add_node( node["high"], depth + 1, path );
+		_low[k] = low;
+		_high[k] = high;
+		return k;
+	}
+
+	const int _input_dim;
+	const int _n_features;
+	const bool _oblique;
+	int _depth;
+
+	// Nodes:
+	std::vector<int> _feature;
+	std::vector<T> _threshold;
+	std::vector<T> _weights;
+	std::vector<int> _low;
+	std::vector<int> _high;
+	std::vector<int> _leaf;
+
+	// Leaves:
+	std::vector<T> _intercept;
+	std::vector<T> _coefs;
+};
+
+
+// Set of model trees taking the same inputs, evaluated together so that the polynomial features are computed only once:
+template<typename T>
+class Flat_tree_policy
+{
+	public:
+
+	typedef boost::shared_ptr<const Flat_tree_policy> ptr_t;
+
+	Flat_tree_policy( const std::vector<std::string>& yaml_file_paths, int input_dim, bool oblique = false,
+	                  unsigned int degree = 1, bool interaction_only = false ) :
+	                  _poly( input_dim, degree, interaction_only ), _features( _poly.output_dim() )
+	{
+		for ( const std::string& path : yaml_file_paths )
+			_trees.push_back( Flat_model_tree<T>( path, input_dim, _poly.output_dim(), oblique ) );
+	}
+
+	inline int input_dim() const { return _poly.input_dim(); }
+	inline int output_dim() const { return _trees.size(); }
+	inline int feature_dim() const { return _poly.output_dim(); }
+	inline const Flat_model_tree<T>& tree( int i ) const { return _trees[i]; }
+
+	// Outputs of every tree for the state x, along with the indices of the leaves reached:
+	inline void predict( const T* x, T* y, int* leaves ) { predict( x, y, leaves, _features.data() ); }
+
+	// Same with a buffer of size feature_dim() provided by the caller, so that the policy can be shared between threads:
+	void predict( const T* x, T* y, int* leaves, T* features ) const
+	{
+		_poly.transform( x, features );
+		for ( size_t t = 0 ; t < _trees.size() ; t++ )
+			y[t] = _trees[t].predict( x, features, leaves[t] );
+	}
+
+	// Same for n states stored contiguously, processed by blocks of batch_block states.
+	// y and leaves are of shape ( n, output_dim ):
+	void predict_batch( const T* x, int n, T* y, int* leaves )
+	{
+		const int n_in = input_dim();
+		const int n_feat = _poly.output_dim();
+		_x_block.resize( n_in*batch_block );
+		_features_block.resize( n_feat*batch_block );
+		_y_block.resize( batch_block );
+		_leaves_block.resize( batch_block );
+		_nodes_block.resize( batch_block );
+
+		for ( int start = 0 ; start < n ; start += batch_block )
+		{
+			int m = std::min( int( batch_block ), n - start );
+
+			// Transpose the block so that each input is contiguous across the states:
+			for ( int i = 0 ; i < m ; i++ )
+				for ( int f = 0 ; f < n_in ; f++ )
+					_x_block[f*batch_block + i] = x[( start + i )*n_in + f];
+			_poly.transform_batch( _x_block.data(), m, batch_block, _features_block.data() );
+
+			for ( size_t t = 0 ; t < _trees.size() ; t++ )
+			{
+				_trees[t].predict_batch( _x_block.data(), _features_block.data(), m, batch_block, _y_block.data(), _leaves_block.data(), _nodes_block.data() );
+				for ( int i = 0 ; i < m ; i++ )
+				{
+					y[( start + i )*_trees.size() + t] = _y_block[i];
+					leaves[( start + i )*_trees.size() + t] = _leaves_block[i];
+				}
+			}
+		}
+	}
+
+	static constexpr int batch_block = 64;
+
+	protected:
+
+	Polynomial_features _poly;
+	std::vector<Flat_model_tree<T>> _trees;
+	std::vector<T> _features;
+	std::vector<T> _x_block, _features_block, _y_block;
+	std::vector<int> _leaves_block, _nodes_block;
+};
+
+
+#endif
@@ -0,0 +1,27 @@
+/*
+** Conversion of a heightmap image into the binary terrain format ( .hfb ) of ode/terrain_cache.hh,
+** which is mapped in memory by the height fields instead of being decoded at every start.
+**
+** heightmap_to_hfb <image> <output.hfb> [f32]
+**     f32: store the heights in single precision.
+*/
+#include "ode/heightfield.hh"
+#include <cstring>
+
+
+int main( int argc, char* argv[] )
+{
+	if ( argc < 3 )
+	{
+		fprintf( stderr, "USAGE: %s <image> <output.hfb> [f32]\n", argv[0] );
+		return 1;
+	}
+	bool single_precision = argc > 3 && strcmp( argv[3], "f32" ) == 0;
+
+	ode::Terrain_data::ptr_t terrain = ode::HeightField::load_image( argv[1], single_precision );
+	terrain->save( argv[2] );
+
+	fprintf( stderr, "%s: %dx%d heights in %s precision\n", argv[2], terrain->nrow(), terrain->ncol(), single_precision ? "single" : "double" );
+
+	return 0;
+}
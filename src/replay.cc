@@ -0,0 +1,105 @@
+/*
+** Rendering of a rover episode recorded by Rover_recorder ( e.g. by data_collection_tf ), without any physics.
+** The rover and the step are built as in the recorded scenario but never simulated: the poses of the bodies
+** are read from the log and interpolated at the frame rate.
+**
+** replay <log.trj> [episode] [fps] [capture|<video>]
+**
+** episode: Index of the episode to replay ( default: the last one of the log ).
+** fps:     Frames per second of the rendering ( default: 25 ).
+** capture: Record the frames in /tmp as fast as they are rendered instead of playing them in real time.
+** video:   Same, encoded by ffmpeg into the given video file.
+*/
+
+#include "ode/environment.hh"
+#include "ode/box.hh"
+#include "renderer/osg_visitor.hh"
+#include "renderer/replay_loop.hh"
+#include "renderer/osg_text.hh"
+#include "rover.hh"
+#include <cstring>
+
+
+int main( int argc, char* argv[] )
+{
+	if ( argc < 2 )
+	{
+		fprintf( stderr, "USAGE: %s <log.trj> [episode] [fps] [capture|<video>]\n", argv[0] );
+		return 1;
+	}
+
+	ode::Trajectory_reader log( argv[1] );
+	std::pair<long,long> range = Replay_loop::episode_range( log, argc > 2 ? atoi( argv[2] ) : -1 );
+	if ( range.first >= range.second )
+	{
+		fprintf( stderr, "No such episode in %s\n", argv[1] );
+		return 1;
+	}
+	int fps = argc > 3 ? atoi( argv[3] ) : DEFAULT_FPS;
+	const char* capture = argc > 4 ? argv[4] : nullptr;
+
+
+	// [ Scene ]
+
+	// Parameters of the terrain recorded with the episode, if any ( as in Step_scenario otherwise ):
+	float scenario[] = { 0, 1 };
+	int scenario_field = log.layout().find( "scenario" );
+	if ( scenario_field >= 0 )
+		log.get( range.first, scenario_field, scenario, 2 );
+	float orientation( scenario[0] ), step_x( scenario[1] );
+
+	dInitODE();
+	ode::Environment env( 0.5 );
+
+	robot::Rover_1 robot( env, Eigen::Vector3d( 0, 0, 0 ) );
+
+	float step_height( 0.105*2 );
+	ode::Box step( env, Eigen::Vector3d( step_x, 0, step_height/2 ), 1, 1, 3, step_height, false );
+	step.set_rotation( 0, 0, orientation*M_PI/180 );
+	step.fix();
+	ode::Box step_c( env, Eigen::Vector3d( step_x + 1, 0, step_height/2 ), 1, 2, 3, step_height, false );
+	step_c.fix();
+
+
+	// [ Display ]
+
+	int x( 200 ), y( 200 ), width( 1024 ), height( 768 );
+	renderer::OsgVisitor display( 0, width, height, x, y, 20, 20, osg::Vec3( -0.7, -2, 0.6 ), osg::Vec3( 0, 0, -0.1 ) );
+	display.set_window_name( "Replay" );
+
+	robot.accept( display );
+	step.accept( display );
+	step_c.accept( display );
+
+	std::vector<const ode::Object*> bodies( robot.bodies().begin(), robot.bodies().end() );
+	Replay_loop replay( &display, log, bodies, "poses", fps );
+
+	std::function<bool(renderer::OsgText*)> update_text = [&replay]( renderer::OsgText* text )
+	{
+		char buff[32];
+		snprintf( buff, sizeof( buff ), "t: %6.3f s", replay.get_time() );
+		text->set_text( buff );
+		return false;
+	};
+	renderer::OsgText::ptr_t text = display.add_text( "hud" );
+	text->set_pos( 3 );
+	text->set_size( 3.5 );
+	text->add_background();
+	text->set_callback( update_text );
+
+
+	// [ Replay ]
+
+	if ( capture != nullptr && strncmp( capture, "capture", 8 ) == 0 )
+		replay.start_captures();
+	else if ( capture != nullptr )
+		replay.start_capture_pipe( renderer::Frame_capture::ffmpeg_command( width, height, fps, capture ).c_str() );
+
+	fprintf( stderr, "Replaying records %ld to %ld of %s\n", range.first, range.second - 1, argv[1] );
+	replay.play( range.first, range.second );
+	replay.stop_captures();
+
+	dCloseODE();
+
+	return 0;
+}
@@ -2,24 +2,34 @@
 #define ROVER_HH 
 
 #include "ode/robot.hh"
-#include "Filters/cpp/filters.hh" // https://github.com/Bouty92/Filters
+#include "ode/robot_blueprint.hh"
+#include "ode/filter_bank.hh"
 #include "ode/ft_sensor.hh"
+#include "rover_params.hh"
 
-#include <osgViewer/Viewer>
 
-
-#define NBWHEELS 4
+namespace robot
+{
 
 
-namespace robot
+// Smallest radius of the wheels 0 to i:
+template<class P>
+constexpr double min_wheel_radius( int i = NBWHEELS - 1 )
 {
+	return i == 0 ? P::wheel_radius( 0 ) : P::wheel_radius( i ) < min_wheel_radius<P>( i - 1 ) ? P::wheel_radius( i ) : min_wheel_radius<P>( i - 1 );
+}
 
 
-class Rover_1 : public Robot
+// Rover of parameters P ( see rover_params.hh ):
+template<class P>
+class Rover : public Robot
 {
 	public:
 
-	Rover_1( ode::Environment& env, const Eigen::Vector3d& pose );
+	typedef P params;
+
+	// Built from the description of P by default, compiled only once per process:
+	Rover( ode::Environment& env, const Eigen::Vector3d& pose, const Robot_blueprint& blueprint = *Robot_blueprint::load( P::description() ) );
 
 	void SetRobotSpeed( double speed );
 	inline double GetRobotSpeed() const { return _robot_speed; }
@@ -56,6 +66,19 @@ class Rover_1 : public Robot
 	void GetTiltRates( double& roll_rate, double& pitch_rate ) const;
 	double GetBoggieAngle() const;
 	Eigen::Matrix<double,4,3> GetFT300Torsors() const;
+
+	// Fields of the state record, in degrees and in the units of the FT sensors:
+	enum state_field { STATE_DIRECTION, STATE_STEERING_ANGLE, STATE_ROLL, STATE_PITCH, STATE_BOGGIE_ANGLE,
+	                   STATE_FRONT_FORCES, STATE_FRONT_TORQUES = STATE_FRONT_FORCES + 3,
+	                   STATE_REAR_FORCES = STATE_FRONT_TORQUES + 3, STATE_REAR_TORQUES = STATE_REAR_FORCES + 3,
+	                   STATE_SIZE = STATE_REAR_TORQUES + 3 };
+
+	// Fill a record of STATE_SIZE values in a single pass, reading the orientation of the main body only once and without allocation
+	// ( T is float or double ):
+	template<typename T> void ExportState( T* dst ) const;
+
+	// Same for n robots into a structure of arrays where the field k of the robot i is at dst[k*stride+i] ( stride = n by default ):
+	template<typename T> static void ExportStates( const Rover* const* robots, int n, T* dst, int stride = 0 );
 	inline const double* GetWheelTorques() const { return _torque_output; }
 
 	void PrintFT300Torsors( bool endl = true ) const;
@@ -63,13 +86,24 @@ class Rover_1 : public Robot
 
 	virtual void next_step( double dt = ode::Environment::time_step );
 
-	virtual ~Rover_1();
+	virtual void save_state( std::vector<double>& buffer ) const;
+	virtual const double* load_state( const double* data );
+
+	virtual ~Rover();
 
 	double steering_max_vel;
 	double boggie_max_torque;
 
 	protected:
 
+	// Signs of the position of the wheel i along the track and along the wheelbase:
+	static constexpr double _side( int i ) { return i%2 ? -1 : 1; }
+	static constexpr double _end( int i ) { return i/2 ? -1 : 1; }
+
+	// Constants derived from the parameters:
+	static constexpr double _track_base_ratio = P::wheeltrack()/P::wheelbase();
+	static constexpr double _robot_max_speed = P::wheels_max_speed()*min_wheel_radius<P>();
+
 	virtual void _InternalControl( double delta_t );
 
 	void _UpdateWheelControl();
@@ -84,66 +118,30 @@ class Rover_1 : public Robot
 	double _steering_rate;
 	double _boggie_torque;
 
-	double wheelbase;
-	double wheeltrack;
-
-	double wheel_mass;
-	double wheel_radius[NBWHEELS];
-	double wheel_width;
-	double wheel_def;
-	double robot_max_speed;
-
-	double belly_elev;
-
-	double front_mass;
-	double front_length;
-	double front_height;
-	double front_width;
-	double front_x_offset;
-	double front_y_offset;
-	Eigen::Vector3d front_pos;
-
-	double rear_mass;
-	double rear_length;
-	double rear_height;
-	double rear_width;
-	double rear_x_offset;
-	double rear_y_offset;
-	Eigen::Vector3d rear_pos;
-
-	Eigen::Vector3d hinge_pos;
-	double boggie_angle_max;
-
-	double sea_elev;
-	Eigen::Vector3d sea_pos;
-	double steering_angle_max;
-
-	double boggie_mass;
-	double boggie_length;
-	double boggie_height;
-	double boggie_width;
-	Eigen::Vector3d boggie_pos;
-
-	double fork_elev;
-	double fork_mass;
-	double fork_length;
-	double fork_height;
-	double fork_width;
-
-	ode::Object::ptr_t _front_fork;
-	ode::Object::ptr_t _rear_fork;
-	ode::Object::ptr_t _wheel[NBWHEELS];
+	// Parts owned by the arena of the robot:
+	ode::Object* _front_fork;
+	ode::Object* _rear_fork;
+	ode::Object* _wheel[NBWHEELS];
+
+	// Point above the centre hinge at the height of the boggie axis, in the frame of the main body:
+	Eigen::Vector3d _center;
 
+	// Joints of the description, destroyed by Robot:
+	dJointID _steering_hinge;
 	dJointID _boggie_hinge;
-	dJointID _wheel_joint[NBWHEELS];
+
+	// Indices of the joints in the actuator bank:
+	int _steering_actuator;
+	int _boggie_actuator;
+	int _wheel_actuator[NBWHEELS];
 
 	dJointFeedback _wheel_feedback[NBWHEELS];
-	filters::ptr_t<double> _torque_filter[NBWHEELS];
+	ode::LP_filter_bank<NBWHEELS> _torque_filters;
 	double _torque_output[NBWHEELS];
 
 	FT_sensor _front_ft_sensor;
 	FT_sensor _rear_ft_sensor;
-	filters::ptr_t<double> _ft_filter[12];
+	ode::LP_filter_bank<12> _ft_filters;
 
 	double _W[NBWHEELS];
 
@@ -156,90 +154,13 @@ class Rover_1 : public Robot
 };
 
 
-class RoverControl : public osgGA::GUIEventHandler
-{
-	public:
-
-	RoverControl( robot::Rover_1* robot, osgViewer::Viewer* viewer, double speed_sensi = 0.01, double turn_sensi = 1., double torque_sensi = 1. ) :
-				  _robot_ptr( robot ), _viewer( viewer ), _speed_sensi( speed_sensi ), _turn_sensi( turn_sensi ), _torque_sensi( torque_sensi )
-	{
-		_viewer->addEventHandler( this );
-	}
-
-	virtual bool handle( const osgGA::GUIEventAdapter& ea, osgGA::GUIActionAdapter& aa )
-	{
-		double speed, rate, torque;
-
-		switch ( ea.getKey() )
-		{
-			case osgGA::GUIEventAdapter::KEY_Up :
-				speed = _robot_ptr->GetRobotSpeed();
-				speed += _speed_sensi;
-				_robot_ptr->SetRobotSpeed( speed );
-				return true;
-
-			case osgGA::GUIEventAdapter::KEY_Down :
-				speed = _robot_ptr->GetRobotSpeed();
-				speed -= _speed_sensi;
-				_robot_ptr->SetRobotSpeed( speed );
-				return true;
-
-			case osgGA::GUIEventAdapter::KEY_0 :
-			case osgGA::GUIEventAdapter::KEY_Exclaim :
-				_robot_ptr->SetRobotSpeed( 0 );
-				return true;
-
-			case osgGA::GUIEventAdapter::KEY_Left :
-				rate = _robot_ptr->GetSteeringRateCmd();
-				rate -= _turn_sensi;
-				_robot_ptr->SetSteeringRate( rate );
-				return true;
-
-			case osgGA::GUIEventAdapter::KEY_Right :
-				rate = _robot_ptr->GetSteeringRateCmd();
-				rate += _turn_sensi;
-				_robot_ptr->SetSteeringRate( rate );
-				return true;
-
-			case osgGA::GUIEventAdapter::KEY_Control_R :
-				_robot_ptr->SetSteeringRate( 0 );
-				return true;
-
-			case osgGA::GUIEventAdapter::KEY_KP_Subtract :
-			case osgGA::GUIEventAdapter::KEY_Page_Down :
-				torque = _robot_ptr->GetBoggieTorque();
-				torque -= _torque_sensi;
-				_robot_ptr->SetBoggieTorque( torque );
-				return true;
-
-			case osgGA::GUIEventAdapter::KEY_KP_Add :
-			case osgGA::GUIEventAdapter::KEY_Page_Up :
-				torque = _robot_ptr->GetBoggieTorque();
-				torque += _torque_sensi;
-				_robot_ptr->SetBoggieTorque( torque );
-				return true;
-
-			case osgGA::GUIEventAdapter::KEY_KP_Multiply :
-			case osgGA::GUIEventAdapter::KEY_Asterisk :
-				_robot_ptr->SetBoggieTorque( 0 );
-				return true;
-		}
-		return false;
-	}
-
-	void Detach()
-	{
-		_viewer->removeEventHandler( this );
-	}
+template<class P> constexpr double Rover<P>::_track_base_ratio;
+template<class P> constexpr double Rover<P>::_robot_max_speed;
 
-	protected:
 
-	robot::Rover_1* _robot_ptr;
-	osgViewer::Viewer* _viewer;
-	double _speed_sensi;
-	double _turn_sensi;
-	double _torque_sensi;
-};
+// Rover of the lab, instantiated in rover_1.cc:
+typedef Rover<Rover_1_params> Rover_1;
+extern template class Rover<Rover_1_params>;
 
 
 class Crawler_1 : public Rover_1
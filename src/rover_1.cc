@@ -1,6 +1,5 @@
 #include "rover.hh"
-#include "ode/box.hh"
-#include "ode/wheel.hh"
+#include <stdexcept>
 
 
 #define RAD_TO_DEG 57.29577951308232
@@ -15,7 +14,10 @@ namespace robot
 {
 
 
-Rover_1::Rover_1( Environment& env, const Vector3d& pose ) :
+template<class P>
+Rover<P>::Rover( Environment& env, const Vector3d& pose, const Robot_blueprint& blueprint ) :
+				  steering_max_vel( P::steering_max_vel() ),
+				  boggie_max_torque( P::boggie_max_torque() ),
 				  _robot_speed( 0 ),
 				  _steering_rate( 0 ),
 				  _boggie_torque( 0 ),
@@ -24,236 +26,84 @@ Rover_1::Rover_1( Environment& env, const Vector3d& pose ) :
                   _ic_activated( true ),
 				  _crawling_mode( false )
 {
-	// [ Rover's parameters ]
-
-	#define WHEELS_MAX_SPEED 7.4351 // rad/s
-	//#define WHEELS_MAX_TORQUE dInfinity
-	//#define WHEELS_MAX_TORQUE 3.38954 // N.m
-	#define WHEELS_MAX_TORQUE 25.4 // N.m
-	//#define WHEELS_TORQUE_SPEED_RATIO 0.45588357923901496
-	#define WHEELS_TORQUE_SPEED_RATIO 3.416228430014391
-
-	#define STEERING_SERVOS_K 0.8
-	#define STEERING_MAX_TORQUE 180 // N.m
-
-	// Stiffness and damping of force-torque sensors:
-	//#define FORK_K_LIN 2e4
-	//#define FORK_K_ANG 1e3
-	//#define FORK_C_LIN 5e2
-	//#define FORK_C_ANG 1.
-	#define FORK_K_LIN Vector3d( 2e4, 2e4, 1e5 )
-	#define FORK_K_ANG Vector3d( 1e3, 1e3, 1e3 )
-	#define FORK_C_LIN Vector3d( 5e2, 5e2, 5e2 )
-	#define FORK_C_ANG Vector3d( 1., 1., 1. )
-
-	steering_max_vel = 15;
-	boggie_max_torque = 25;
-
-	wheelbase = 0.58;
-	wheeltrack = 0.61;
-
-	wheel_mass = 1.4 + 1; // Wheel + motor
-	wheel_radius[0] = 0.105;
-	wheel_radius[1] = 0.105;
-	wheel_radius[2] = 0.105;
-	wheel_radius[3] = 0.105;
-	wheel_width = 0.1;
-	wheel_def = 50;
-
-	belly_elev = 0.33;
-
-	//front_mass = 5.25 + 2.2; // Body + battery
-	front_mass = 5.25; // Body without battery
-	front_length = 0.345;
-	front_height = 0.225;
-	front_width = 0.200;
-	front_x_offset = -0.063;
-	front_y_offset = 0.023;
-	front_pos = Vector3d( front_length/2 + front_x_offset, front_y_offset, belly_elev + front_height/2 );
-
-	rear_mass = 3.67;
-	rear_length = 0.312;
-	rear_height = 0.177;
-	rear_width = 0.126;
-	rear_x_offset = 0.046;
-	rear_y_offset = -0.040;
-	rear_pos = Vector3d( -rear_length/2 + rear_x_offset, rear_y_offset, belly_elev + rear_height/2 );
-
-	hinge_pos = Vector3d( 0, 0, ( front_pos[2] + rear_pos[2] )/2 );
-	steering_angle_max = 45;
-
-	sea_elev = belly_elev + 0.12;
-	sea_pos = Vector3d( -wheelbase/2, 0, sea_elev );
-	boggie_angle_max = 45;
-
-	boggie_mass = 1;
-	boggie_length = 0.1;
-	boggie_height = sea_elev - belly_elev;
-	boggie_width = 0.1;
-	boggie_pos = Vector3d( -wheelbase/2 + 0.035, 0, belly_elev + boggie_height/2 );
-
-	fork_mass = 1;
-	fork_length = 0.05;
-	fork_height = 0.1;
-	fork_width = 0.3;
-	fork_elev = belly_elev - fork_height/2;
-
-
-	robot_max_speed = WHEELS_MAX_SPEED/wheel_radius[0];
-	for ( int i = 1 ; i < NBWHEELS ; i++ )
-		robot_max_speed = std::min( robot_max_speed, WHEELS_MAX_SPEED*wheel_radius[i] );
-
-
-	// [ Wheel positions ]
-
-	Vector3d wheel_position[NBWHEELS];
-	for ( int i = 0 ; i < NBWHEELS ; i++ )
-		wheel_position[i] = Vector3d( ( i/2 ? -1 : 1 )*wheelbase/2, ( i%2 ? -1 : 1 )*wheeltrack/2, wheel_radius[i] );
-
-
-	// [ Definition of the chassis ]
-
-	_main_body = Object::ptr_t( new Box( env,
-										 pose + front_pos,
-										 front_mass,
-										 front_length, front_width, front_height ) );
-	_main_body->set_mesh( "../meshes/front.obj" );
-	_bodies.push_back( _main_body );
-
-	ode::Object::ptr_t battery = Object::ptr_t( new Box( env,
-														 pose + Vector3d( 0.285, 0, belly_elev + 0.155 ),
-														 3,
-														 0.0975, 0.151, 0.065 ) );
-	_bodies.push_back( battery );
-	dJointID battery_clamp = dJointCreateSlider( env.get_world(), 0 );
-	dJointAttach( battery_clamp, battery->get_body(), _main_body->get_body() );
-	dJointSetSliderAxis( battery_clamp, 0, 1, 0 );
-	dJointSetSliderParam( battery_clamp, dParamLoStop, 0 );
-	dJointSetSliderParam( battery_clamp, dParamHiStop, 0 );
-
-
-	ode::Object::ptr_t rear_body( new Box( env,
-						                   pose + rear_pos,
-						                   rear_mass,
-						                   rear_length, rear_width, rear_height ) );
-	rear_body->set_mesh( "../meshes/rear.obj" );
-	_bodies.push_back( rear_body );
-
-
-	ode::Object::ptr_t boggie( new Box( env,
-							            pose + boggie_pos,
-							            boggie_mass,
-							            boggie_length, boggie_width, boggie_height, true, false ) );
-	boggie->set_mesh( "../meshes/sea.obj" );
-	_bodies.push_back( boggie );
-
-
-	double motor_radius( 0.025 );
-	double motor_length( 0.1 );
-	Vector3d front_fork_pos = pose + Vector3d( wheelbase/2, 0, fork_elev );
-	_front_fork = Object::ptr_t( new Box( env,
-							              front_fork_pos,
-							              fork_mass,
-							              fork_length, fork_width, fork_height, true, false ) );
-	_front_fork->add_cylinder_geom( motor_radius, motor_length )->set_geom_rot( M_PI/2, 0, 0 );
-	_front_fork->set_geom_abs_pos( pose + Vector3d( wheelbase/2, ( wheeltrack - wheel_width - motor_length )/2, wheel_radius[0] ) );
-	_front_fork->add_cylinder_geom( motor_radius, motor_length )->set_geom_rot( M_PI/2, 0, 0 );
-	_front_fork->set_geom_abs_pos( pose + Vector3d( wheelbase/2, -( wheeltrack - wheel_width - motor_length )/2, wheel_radius[1] ) );
-	_front_fork->set_mesh( "../meshes/front_fork.obj" );
-	_bodies.push_back( _front_fork );
-
-
-	Vector3d rear_fork_pos = pose + Vector3d( -wheelbase/2, 0, fork_elev );
-	_rear_fork = Object::ptr_t( new Box( env,
-							             rear_fork_pos,
-							             fork_mass,
-							             fork_length, fork_width, fork_height, true, false ) );
-	_rear_fork->add_cylinder_geom( motor_radius, motor_length )->set_geom_rot( M_PI/2, 0, 0 );
-	_rear_fork->set_geom_abs_pos( pose + Vector3d( -wheelbase/2, ( wheeltrack - wheel_width - motor_length )/2, wheel_radius[2] ) );
-	_rear_fork->add_cylinder_geom( motor_radius, motor_length )->set_geom_rot( M_PI/2, 0, 0 );
-	_rear_fork->set_geom_abs_pos( pose + Vector3d( -wheelbase/2, -( wheeltrack - wheel_width - motor_length )/2, wheel_radius[3] ) );
-	_rear_fork->set_mesh( "../meshes/rear_fork.obj" );
-	_bodies.push_back( _rear_fork );
-
-
-	// [ Centre hinge joint ]
-
-	Servo::ptr_t centre_hinge_servo( new Servo( env,
-					                            *rear_body, *_main_body,
-					                            pose + hinge_pos,
-					                            Vector3d( 0, 0, 1 ),
-					                            STEERING_SERVOS_K,
-					                            steering_max_vel*DEG_TO_RAD,
-					                            -steering_angle_max*DEG_TO_RAD, steering_angle_max*DEG_TO_RAD ) );
-	centre_hinge_servo->set_torque_max( STEERING_MAX_TORQUE );
-	_servos.push_back( centre_hinge_servo );
-
-
-	// [ Boggie joint ]
-
-	_boggie_hinge = dJointCreateHinge( env.get_world(), 0 );
-	dJointAttach( _boggie_hinge, boggie->get_body(), rear_body->get_body() );
-	dJointSetHingeAxis( _boggie_hinge, 1, 0, 0 );
-	Vector3d sea_joint_pos = pose + sea_pos;
-	dJointSetHingeAnchor( _boggie_hinge, sea_joint_pos.x(), sea_joint_pos.y(), sea_joint_pos.z() );
-	dJointSetHingeParam( _boggie_hinge, dParamLoStop, -boggie_angle_max*DEG_TO_RAD );
-	dJointSetHingeParam( _boggie_hinge, dParamHiStop, boggie_angle_max*DEG_TO_RAD );
-
+	// [ Parts and joints of the description ]
 
-	// [ Force-torque sensors ]
+	_build( env, pose, blueprint );
 
-	_front_ft_sensor = FT_sensor( _main_body.get(), _front_fork.get(), pose + Vector3d( wheelbase/2, 0, belly_elev ), FORK_K_LIN, FORK_K_ANG, FORK_C_LIN, FORK_C_ANG );
-	_rear_ft_sensor = FT_sensor( boggie.get(), _rear_fork.get(), pose + Vector3d( -wheelbase/2, 0, belly_elev ), FORK_K_LIN, FORK_K_ANG, FORK_C_LIN, FORK_C_ANG );
+	_front_fork = _bodies[blueprint.body( "front_fork" )];
+	_rear_fork = _bodies[blueprint.body( "rear_fork" )];
 
+	_steering_hinge = _joints[blueprint.joint( "steering" )];
+	_steering_actuator = _joint_actuators[blueprint.joint( "steering" )];
 
-	for ( int i = 0 ; i < NBWHEELS ; i++ )
-	{
-		// [ Definition of wheels ]
+	_boggie_hinge = _joints[blueprint.joint( "boggie" )];
+	// The torque is bounded by boggie_max_torque in _ApplyBoggieControl:
+	_boggie_actuator = _joint_actuators[blueprint.joint( "boggie" )];
 
-		_wheel[i] = Object::ptr_t( new ode::Wheel( env, pose + wheel_position[i], wheel_mass, wheel_radius[i], wheel_width, wheel_def ) );
-		_wheel[i]->set_rotation( M_PI/2, 0, 0 );
-		_bodies.push_back( _wheel[i] );
-		_wheel[i]->set_contact_type( SOFT );
-		_wheel[i]->set_color( 0.2, 0.2, 0.2 );
-		
+	if ( _steering_actuator < 0 || _boggie_actuator < 0 )
+		throw std::runtime_error( "The steering and boggie joints of the robot description " + blueprint.name() + " must be actuated" );
 
-		// [ Definition of wheel motors ]
+	// The steering control relies on the limits of P:
+	const Robot_blueprint::joint_t& steering = blueprint.joints()[blueprint.joint( "steering" )];
+	if ( steering.mode != ode::Actuator_bank::POSITION
+	     || fabs( steering.vel_max - P::steering_max_vel()*DEG_TO_RAD ) > 1e-9
+	     || fabs( steering.min + P::steering_angle_max()*DEG_TO_RAD ) > 1e-9
+	     || fabs( steering.max - P::steering_angle_max()*DEG_TO_RAD ) > 1e-9 )
+		throw std::runtime_error( "The steering actuator of the robot description " + blueprint.name() + " does not match the limits of the rover" );
 
-		Vector3d wheel_joint_pos = pose + wheel_position[i];
+	const Vector3d& main_pos = blueprint.bodies()[0].pos;
+	const Vector3d& boggie_axis = blueprint.joints()[blueprint.joint( "boggie" )].anchor;
+	_center = Vector3d( 0, 0, boggie_axis.z() ) - main_pos;
 
-		_wheel_joint[i] = dJointCreateHinge( env.get_world(), 0 );
-		dJointAttach( _wheel_joint[i], ( wheel_position[i].x() > 0 ? _front_fork->get_body() : _rear_fork->get_body() ), _wheel[i]->get_body() );
-		dJointSetHingeAnchor( _wheel_joint[i], wheel_joint_pos.x(), wheel_joint_pos.y(), wheel_joint_pos.z() );
-		dJointSetHingeAxis( _wheel_joint[i], 0, -1, 0 );
 
-		dJointSetHingeParam( _wheel_joint[i], dParamFMax, WHEELS_MAX_TORQUE );
-		//dJointSetHingeParam( _wheel_joint[i], dParamFMax, 0 );
+	// [ Wheels ]
 
-		//dJointSetFeedback( _wheel_joint[i], &_wheel_feedback[i] );
+	static const char* wheel_names[NBWHEELS] = { "front_left_wheel", "front_right_wheel", "rear_left_wheel", "rear_right_wheel" };
+	static const char* motor_names[NBWHEELS] = { "front_left_motor", "front_right_motor", "rear_left_motor", "rear_right_motor" };
+	for ( int i = 0 ; i < NBWHEELS ; i++ )
+	{
+		const Robot_blueprint::body_t& wheel = blueprint.bodies()[blueprint.body( wheel_names[i] )];
+		const Robot_blueprint::joint_t& motor = blueprint.joints()[blueprint.joint( motor_names[i] )];
+		_wheel[i] = _bodies[blueprint.body( wheel_names[i] )];
+		_wheel_actuator[i] = _joint_actuators[blueprint.joint( motor_names[i] )];
+
+		// The wheel control relies on the geometry and the maximal speed of P:
+		if ( wheel.shape != Robot_blueprint::WHEEL || _wheel_actuator[i] < 0
+		     || fabs( wheel.size[0] - P::wheel_radius( i ) ) > 1e-9
+		     || fabs( wheel.pos.x() - _end( i )*P::wheelbase()/2 ) > 1e-9
+		     || fabs( wheel.pos.y() - _side( i )*P::wheeltrack()/2 ) > 1e-9 )
+			throw std::runtime_error( std::string( "The wheel " ) + wheel_names[i] + " of the robot description " + blueprint.name() + " does not match the geometry of the rover" );
+		if ( motor.mode != ode::Actuator_bank::VELOCITY || fabs( motor.vel_max - P::wheels_max_speed() ) > 1e-9 )
+			throw std::runtime_error( std::string( "The motor " ) + motor_names[i] + " of the robot description " + blueprint.name() + " does not match the maximal wheel speed of the rover" );
 	}
 
 
+	// [ Force-torque sensors ]
+
+	const Robot_blueprint::ft_sensor_t& front = blueprint.ft_sensor( "front" );
+	const Robot_blueprint::ft_sensor_t& rear = blueprint.ft_sensor( "rear" );
+	_front_ft_sensor = FT_sensor( _bodies[front.body_1], _bodies[front.body_2], pose + front.center, front.k_lin, front.k_ang, front.c_lin, front.c_ang );
+	_rear_ft_sensor = FT_sensor( _bodies[rear.body_1], _bodies[rear.body_2], pose + rear.center, rear.k_lin, rear.k_ang, rear.c_lin, rear.c_ang );
+
+
 	// [ Initialisation of filters ]
 	
-	for ( int i = 0 ; i < NBWHEELS ; i++ )
-		_torque_filter[i] = filters::ptr_t<double>( new filters::LP_second_order_bilinear<double>( 0.001, 2*M_PI, 0.5, nullptr, _torque_output + i ) );
-
-	const Vector3d* vec[] = { _front_ft_sensor.GetForces(), _front_ft_sensor.GetTorques(), _rear_ft_sensor.GetForces(), _rear_ft_sensor.GetTorques() };
-	for ( int i = 0 ; i < 4 ; i++ )
-		for ( int j = 0 ; j < 3 ; j++ )
-			_ft_filter[i*3+j] = filters::ptr_t<double>( new filters::LP_second_order_bilinear<double>( 0.001, 4*M_PI, 0.5, vec[i]->data() + j, (double*) vec[i]->data() + j ) );
+	_torque_filters = LP_filter_bank<NBWHEELS>( 0.001, 2*M_PI, 0.5 );
+	_ft_filters = LP_filter_bank<12>( 0.001, 4*M_PI, 0.5 );
 }
 
 
-Vector3d Rover_1::GetPosition() const
+template<class P>
+Vector3d Rover<P>::GetPosition() const
 {
 	dVector3 center_pos;
-	dBodyGetRelPointPos( _main_body->get_body(), -front_pos[0], -front_pos[1], -front_pos[2] + sea_elev, center_pos );
+	dBodyGetRelPointPos( _main_body->get_body(), _center.x(), _center.y(), _center.z(), center_pos );
 	return Vector3d( center_pos[0], center_pos[1], center_pos[2] );
 }
 
 
-double Rover_1::GetDirection() const
+template<class P>
+double Rover<P>::GetDirection() const
 {
 	dVector3 vec;
 	dBodyVectorToWorld( _main_body->get_body(), 1, 0, 0, vec );
@@ -265,7 +115,8 @@ double Rover_1::GetDirection() const
 }
 
 
-bool Rover_1::IsUpsideDown() const
+template<class P>
+bool Rover<P>::IsUpsideDown() const
 {
 	dVector3 vec;
 	dBodyVectorToWorld( _main_body->get_body(), 0, 0, 1, vec );
@@ -273,7 +124,8 @@ bool Rover_1::IsUpsideDown() const
 }
 
 
-double Rover_1::GetRollAngle() const
+template<class P>
+double Rover<P>::GetRollAngle() const
 {
 	dVector3 vec;
 	dBodyVectorToWorld( _main_body->get_body(), 0, 1, 0, vec );
@@ -281,7 +133,8 @@ double Rover_1::GetRollAngle() const
 }
 
 
-double Rover_1::GetPitchAngle() const
+template<class P>
+double Rover<P>::GetPitchAngle() const
 {
 	dVector3 vec;
 	dBodyVectorToWorld( _main_body->get_body(), 1, 0, 0, vec );
@@ -289,7 +142,8 @@ double Rover_1::GetPitchAngle() const
 }
 
 
-void Rover_1::GetTiltRates( double& roll_rate, double& pitch_rate ) const
+template<class P>
+void Rover<P>::GetTiltRates( double& roll_rate, double& pitch_rate ) const
 {
 	const dReal* angular_vel = dBodyGetAngularVel( _main_body->get_body() );
 	dVector3 vec;
@@ -299,43 +153,50 @@ void Rover_1::GetTiltRates( double& roll_rate, double& pitch_rate ) const
 }
 
 
-double Rover_1::GetBoggieAngle() const
+template<class P>
+double Rover<P>::GetBoggieAngle() const
 {
 	return dJointGetHingeAngle( _boggie_hinge )*RAD_TO_DEG;
 }
 
 
-void Rover_1::SetRobotSpeed( double speed )
+template<class P>
+void Rover<P>::SetRobotSpeed( double speed )
 {
-	_robot_speed = std::min( std::max( -robot_max_speed, speed ), robot_max_speed );
+	_robot_speed = std::min( std::max( -_robot_max_speed, speed ), _robot_max_speed );
 }
 
 
-void Rover_1::SetSteeringAngle( double angle )
+template<class P>
+void Rover<P>::SetSteeringAngle( double angle )
 {
-	servos()[0]->set_desired_angle( angle*DEG_TO_RAD )*RAD_TO_DEG;
+	_actuators.set_position( _steering_actuator, angle*DEG_TO_RAD );
 }
 
 
-double Rover_1::GetSteeringTrueAngle() const
+template<class P>
+double Rover<P>::GetSteeringTrueAngle() const
 {
-	return servos()[0]->get_true_angle()*RAD_TO_DEG;
+	return _actuators.get_angle( _steering_actuator )*RAD_TO_DEG;
 }
 
 
-void Rover_1::SetSteeringRate( double rate )
+template<class P>
+void Rover<P>::SetSteeringRate( double rate )
 {
 	_steering_rate = std::min( std::max( -steering_max_vel, rate ), steering_max_vel );
 }
 
 
-double Rover_1::GetSteeringTrueRate() const
+template<class P>
+double Rover<P>::GetSteeringTrueRate() const
 {
-	return servos()[0]->get_true_vel()*RAD_TO_DEG;
+	return _actuators.get_rate( _steering_actuator )*RAD_TO_DEG;
 }
 
 
-void Rover_1::SetBoggieTorque( double torque )
+template<class P>
+void Rover<P>::SetBoggieTorque( double torque )
 {
 	_boggie_torque = std::min( std::max( -boggie_max_torque, torque ), boggie_max_torque );
 }
@@ -343,19 +204,22 @@ void Rover_1::SetBoggieTorque( double torque )
 
 // [ Wheel control ]
 
-void Rover_1::_UpdateWheelControl()
+template<class P>
+void Rover<P>::_UpdateWheelControl()
 {
-	double gamma = servos()[0]->get_true_angle();
-	double dgamma_dt = servos()[0]->get_true_vel();
+	double gamma = _actuators.get_angle( _steering_actuator );
+	double dgamma_dt = _actuators.get_rate( _steering_actuator );
+	double tan_half_gamma = tan( gamma/2 );
 
+	// The number of wheels, their signs and the ratios of the geometry being compile-time constants, the loops unroll:
 	double diff[NBWHEELS];
 	double trans[NBWHEELS];
 	double min_speed = 0;
 	double adjusted_speed;
 	for ( int i = 0 ; i < NBWHEELS ; i++ )
 	{
-		diff[i] = ( i%2 ? -1 : 1 )*wheeltrack/wheelbase*tan( gamma/2 );
-		trans[i] = ( i/2 ? -1 : 1 )*( -wheelbase*tan( gamma/2 ) + ( i%2 ? -1 : 1 )*wheeltrack )*dgamma_dt/4;
+		diff[i] = _side( i )*_track_base_ratio*tan_half_gamma;
+		trans[i] = _end( i )*( -P::wheelbase()*tan_half_gamma + _side( i )*P::wheeltrack() )*dgamma_dt/4;
 
 		if ( _crawling_mode )
 		{
@@ -373,69 +237,132 @@ void Rover_1::_UpdateWheelControl()
 		adjusted_speed = std::min( _robot_speed, min_speed );
 
 	// Reduce the robot speed according to the wheel speed limit:
-	#define WHEELS_MAX_SPEED 7.4351 // rad/s
 	for ( int i = 0 ; i < NBWHEELS ; i++ )
 		if ( _robot_speed >= 0 )
-			adjusted_speed = std::min( adjusted_speed, ( WHEELS_MAX_SPEED*wheel_radius[i] - trans[i] )/( 1 + diff[i] ) );
+			adjusted_speed = std::min( adjusted_speed, ( P::wheels_max_speed()*P::wheel_radius( i ) - trans[i] )/( 1 + diff[i] ) );
 		else
-			adjusted_speed = std::max( adjusted_speed, ( -WHEELS_MAX_SPEED*wheel_radius[i] - trans[i] )/( 1 + diff[i] ) );
+			adjusted_speed = std::max( adjusted_speed, ( -P::wheels_max_speed()*P::wheel_radius( i ) - trans[i] )/( 1 + diff[i] ) );
 
 	// Compute the corresponding speed for each wheel:
 	for ( int i = 0 ; i < NBWHEELS ; i++ )
-		_W[i] = ( adjusted_speed*( 1 + diff[i] ) + trans[i] )/wheel_radius[i];
+		_W[i] = ( adjusted_speed*( 1 + diff[i] ) + trans[i] )/P::wheel_radius( i );
 }
 
 
-void Rover_1::_ApplyWheelControl()
+template<class P>
+void Rover<P>::_ApplyWheelControl()
 {
 	for ( int i = 0 ; i < NBWHEELS ; i++ )
 	{
-		_W[i] = std::min( std::max( -WHEELS_MAX_SPEED, _W[i] ), WHEELS_MAX_SPEED );
-
-		// Limit the torque according to the current wheel speed:
-		double max_torque = WHEELS_MAX_TORQUE - WHEELS_TORQUE_SPEED_RATIO*fabs( dJointGetHingeAngleRate( _wheel_joint[i] ) );
-		dJointSetHingeParam( _wheel_joint[i], dParamFMax, max_torque );
-		dJointSetHingeParam( _wheel_joint[i], dParamVel, _W[i] );
+		// The torque is limited according to the current wheel speed by the actuator:
+		_W[i] = _actuators.set_velocity( _wheel_actuator[i], _W[i] );
 	}
 }
 
 
-void Rover_1::_ApplySteeringControl()
+template<class P>
+void Rover<P>::_ApplySteeringControl()
 {
 	//_steering_rate = std::min( std::max( -steering_max_vel, _steering_rate ), steering_max_vel ); // Redundant with Servo::set_desired_vel
-	//_steering_rate = servos()[0]->set_desired_vel( _steering_rate*DEG_TO_RAD )*RAD_TO_DEG;
-	servos()[0]->set_desired_vel( _steering_rate*DEG_TO_RAD );
+	//_steering_rate = _actuators.set_velocity( _steering_actuator, _steering_rate*DEG_TO_RAD )*RAD_TO_DEG;
+	_actuators.set_velocity( _steering_actuator, _steering_rate*DEG_TO_RAD );
 }
 
 
-void Rover_1::_ApplyBoggieControl()
+template<class P>
+void Rover<P>::_ApplyBoggieControl()
 {
 	//_boggie_torque = std::min( std::max( -boggie_max_torque, _boggie_torque ), boggie_max_torque );
 	//dJointAddHingeTorque( _boggie_hinge, _boggie_torque );
-	dJointAddHingeTorque( _boggie_hinge, std::min( std::max( -boggie_max_torque, _boggie_torque ), boggie_max_torque ) );
+	_actuators.set_torque( _boggie_actuator, std::min( std::max( -boggie_max_torque, _boggie_torque ), boggie_max_torque ) );
 }
 
 
-void Rover_1::_UpdateTorqueFilters()
+template<class P>
+void Rover<P>::_UpdateTorqueFilters()
 {
+	double torques[NBWHEELS];
 	for ( int i = 0 ; i < NBWHEELS ; i++ )
 	{
 		dVector3* t_abs = &_wheel_feedback[i].t1;
 		dVector3 t_rel;
 		dBodyVectorFromWorld( _wheel[i]->get_body(), *t_abs[0], *t_abs[1], *t_abs[2], t_rel );
-		_torque_filter[i]->update( -t_rel[2] );
+		torques[i] = -t_rel[2];
 	}
+	_torque_filters.update( torques, _torque_output );
 }
 
 
-void Rover_1::_UpdateFtFilters()
+template<class P>
+void Rover<P>::_UpdateFtFilters()
 {
-	for ( int i = 0 ; i < 12 ; i++ )
-		_ft_filter[i]->update();
+	// The filtered values replace the raw ones in the sensors:
+	double* vec[] = { (double*) _front_ft_sensor.GetForces()->data(), (double*) _front_ft_sensor.GetTorques()->data(),
+	                  (double*) _rear_ft_sensor.GetForces()->data(), (double*) _rear_ft_sensor.GetTorques()->data() };
+	double ft[12];
+	for ( int i = 0 ; i < 4 ; i++ )
+		for ( int j = 0 ; j < 3 ; j++ )
+			ft[i*3+j] = vec[i][j];
+
+	_ft_filters.update( ft, ft );
+
+	for ( int i = 0 ; i < 4 ; i++ )
+		for ( int j = 0 ; j < 3 ; j++ )
+			vec[i][j] = ft[i*3+j];
 }
 
 
-Matrix<double,4,3> Rover_1::GetFT300Torsors() const
+template<class P>
+template<typename T>
+void Rover<P>::ExportState( T* dst ) const
+{
+	// The axes of the main body in the world frame are the columns of its rotation matrix:
+	const dReal* R = dBodyGetRotation( _main_body->get_body() );
+	const double x_axis[3] = { R[0], R[4], R[8] };
+	const double y_axis_z = R[9];
+
+	double direction = asin( x_axis[1] )*RAD_TO_DEG;
+	if ( x_axis[0] < 0 )
+		direction = ( x_axis[1] > 0 ? 1 : -1 )*180 - direction;
+
+	dst[STATE_DIRECTION] = direction;
+	dst[STATE_STEERING_ANGLE] = _actuators.get_angle( _steering_actuator )*RAD_TO_DEG;
+	dst[STATE_ROLL] = asin( y_axis_z )*RAD_TO_DEG;
+	dst[STATE_PITCH] = asin( -x_axis[2] )*RAD_TO_DEG;
+	dst[STATE_BOGGIE_ANGLE] = dJointGetHingeAngle( _boggie_hinge )*RAD_TO_DEG;
+
+	const Vector3d* list[] = { _front_ft_sensor.GetForces(), _front_ft_sensor.GetTorques(), _rear_ft_sensor.GetForces(), _rear_ft_sensor.GetTorques() };
+	for ( int i = 0 ; i < 4 ; i++ )
+		for ( int j = 0 ; j < 3 ; j++ )
+			dst[STATE_FRONT_FORCES+i*3+j] = list[i]->coeff( j );
+}
+
+
+template<class P>
+template<typename T>
+void Rover<P>::ExportStates( const Rover* const* robots, int n, T* dst, int stride )
+{
+	if ( stride <= 0 )
+		stride = n;
+
+	T record[STATE_SIZE];
+	for ( int i = 0 ; i < n ; i++ )
+	{
+		robots[i]->ExportState( record );
+		for ( int k = 0 ; k < STATE_SIZE ; k++ )
+			dst[k*stride+i] = record[k];
+	}
+}
+
+
+template void Rover_1::ExportState<float>( float* dst ) const;
+template void Rover_1::ExportState<double>( double* dst ) const;
+template void Rover_1::ExportStates<float>( const Rover_1* const* robots, int n, float* dst, int stride );
+template void Rover_1::ExportStates<double>( const Rover_1* const* robots, int n, double* dst, int stride );
+
+
+template<class P>
+Matrix<double,4,3> Rover<P>::GetFT300Torsors() const
 {
 	Matrix<double,4,3> ft_torsors;
 	ft_torsors.row( 0 ) = *_front_ft_sensor.GetForces();
@@ -447,7 +374,8 @@ Matrix<double,4,3> Rover_1::GetFT300Torsors() const
 }
 
 
-void Rover_1::PrintFT300Torsors( bool endl ) const
+template<class P>
+void Rover<P>::PrintFT300Torsors( bool endl ) const
 {
 	const Vector3d* list[] = { _front_ft_sensor.GetForces(), _front_ft_sensor.GetTorques(), _rear_ft_sensor.GetForces(), _rear_ft_sensor.GetTorques() };
 	for ( const Vector3d* vec : list )
@@ -462,7 +390,8 @@ void Rover_1::PrintFT300Torsors( bool endl ) const
 }
 
 
-void Rover_1::PrintWheelTorques( bool endl ) const
+template<class P>
+void Rover<P>::PrintWheelTorques( bool endl ) const
 {
 	for ( int i = 0 ; i < NBWHEELS ; i++ )
 		printf( "%f ", _torque_output[i] );
@@ -475,16 +404,24 @@ void Rover_1::PrintWheelTorques( bool endl ) const
 }
 
 
-void Rover_1::next_step( double dt )
+template<class P>
+void Rover<P>::next_step( double dt )
 {
-	_front_ft_sensor.Update();
-	_rear_ft_sensor.Update();
-	_UpdateFtFilters();
-	//_UpdateTorqueFilters();
+	{
+		PROFILE_PHASE( FT_SENSORS );
+		_front_ft_sensor.Update();
+		_rear_ft_sensor.Update();
+	}
+	{
+		PROFILE_PHASE( FILTERS );
+		_UpdateFtFilters();
+		//_UpdateTorqueFilters();
+	}
 
 	_ic_clock += dt;
 	if ( _ic_activated && _ic_clock >= _ic_period )
 	{
+		PROFILE_PHASE( CONTROLLER );
 		_InternalControl( _ic_clock );
 
 		_ic_clock = 0;
@@ -493,6 +430,8 @@ void Rover_1::next_step( double dt )
 	else
 		_ic_tick = false;
 
+	PROFILE_PHASE( WHEEL_CONTROL );
+
 	_UpdateWheelControl();
 
 	_ApplyWheelControl();
@@ -503,7 +442,59 @@ void Rover_1::next_step( double dt )
 }
 
 
-void Rover_1::_InternalControl( double delta_t )
+template<class P>
+void Rover<P>::save_state( std::vector<double>& buffer ) const
+{
+	Robot::save_state( buffer );
+
+	double state[] = { _robot_speed, _steering_rate, _boggie_torque, double( _ic_activated ), _ic_period, _ic_clock, double( _ic_tick ), double( _crawling_mode ) };
+	buffer.insert( buffer.end(), state, state + 8 );
+	buffer.insert( buffer.end(), _W, _W + NBWHEELS );
+	buffer.insert( buffer.end(), _torque_output, _torque_output + NBWHEELS );
+
+	size_t offset = buffer.size();
+	buffer.resize( offset + 2*FT_sensor::state_size + _torque_filters.state_size + _ft_filters.state_size );
+	double* data = &buffer[offset];
+	_front_ft_sensor.SaveState( data );
+	_rear_ft_sensor.SaveState( data += FT_sensor::state_size );
+	data += FT_sensor::state_size;
+	_torque_filters.save_state( data );
+	_ft_filters.save_state( data += _torque_filters.state_size );
+}
+
+
+template<class P>
+const double* Rover<P>::load_state( const double* data )
+{
+	data = Robot::load_state( data );
+
+	_robot_speed = data[0];
+	_steering_rate = data[1];
+	_boggie_torque = data[2];
+	_ic_activated = data[3];
+	_ic_period = data[4];
+	_ic_clock = data[5];
+	_ic_tick = data[6];
+	_crawling_mode = data[7];
+	data += 8;
+	std::copy( data, data + NBWHEELS, _W );
+	data += NBWHEELS;
+	std::copy( data, data + NBWHEELS, _torque_output );
+	data += NBWHEELS;
+
+	_front_ft_sensor.LoadState( data );
+	_rear_ft_sensor.LoadState( data += FT_sensor::state_size );
+	data += FT_sensor::state_size;
+	_torque_filters.load_state( data );
+	_ft_filters.load_state( data += _torque_filters.state_size );
+	data += _ft_filters.state_size;
+
+	return data;
+}
+
+
+template<class P>
+void Rover<P>::_InternalControl( double delta_t )
 {
 	//PrintFT300Torsors();
 	//PrintWheelTorques();
@@ -519,15 +510,14 @@ void Rover_1::_InternalControl( double delta_t )
 }
 
 
-Rover_1::~Rover_1()
-{
-	dJointDestroy( _boggie_hinge );
+// The joints are destroyed by Robot:
+template<class P>
+Rover<P>::~Rover() {}
+
+
 
-	for ( int i = 0 ; i < NBWHEELS ; i++ )
-	{
-		dJointDestroy( _wheel_joint[i] );
-	}
-}
 
+// Variants of the rover:
+template class Rover<Rover_1_params>;
 
 }
@@ -17,7 +17,7 @@ Crawler_1::Crawler_1( Environment& env, const Vector3d& pose, float torque_ampli
 		_angle_rate = steering_max_vel;
 	
 	if ( angle_span < 0 )
-		_angle_span = steering_angle_max;
+		_angle_span = params::steering_angle_max();
 	
 	boggie_max_torque = torque_amplitude;
 	
@@ -14,51 +14,60 @@ Rover_1_mt::Rover_1_mt( Environment& env, const Vector3d& pose, const std::strin
                         bool oblique_trees, unsigned int degree, bool interaction_only ) :
             Rover_1( env, pose ), node_1( 0 ), node_2( 0 )
 {
-	if ( degree == 1 )
-	{
-		_lmt_ptr_1 = mt_ptr_t<double>( new Linear_model_tree<double>( yaml_file_path_1, oblique_trees ) );
-		_lmt_ptr_2 = mt_ptr_t<double>( new Linear_model_tree<double>( yaml_file_path_2, oblique_trees ) );
-	}
-	else
-	{
-		_lmt_ptr_1 = mt_ptr_t<double>( new Polynomial_model_tree<double>( yaml_file_path_1, oblique_trees, degree, interaction_only ) );
-		_lmt_ptr_2 = mt_ptr_t<double>( new Polynomial_model_tree<double>( yaml_file_path_2, oblique_trees, degree, interaction_only ) );
-	}
+	_policy = Flat_tree_policy<double>::ptr_t( new Flat_tree_policy<double>( { yaml_file_path_1, yaml_file_path_2 }, state_dim, oblique_trees, degree, interaction_only ) );
+	_features.resize( _policy->feature_dim() );
 }
 
 
-vector<double> Rover_1_mt::GetState( const bool flip, const bool full ) const
+Rover_1_mt::Rover_1_mt( Environment& env, const Vector3d& pose, Flat_tree_policy<double>::ptr_t policy ) :
+            Rover_1( env, pose ), node_1( 0 ), node_2( 0 ), _policy( policy ), _features( policy->feature_dim() )
+{
+}
+
+
+void Rover_1_mt::GetState( double* state, const bool flip, const bool full ) const
 {
 	// Flip or not the left and right to account for the robot's symmetry:
 	int flip_coeff = flip ? -1 : 1;
 
-	vector<double> state;
+	double record[STATE_SIZE];
+	ExportState( record );
 
-	state.push_back( flip_coeff*GetDirection() );
-	state.push_back( flip_coeff*GetSteeringTrueAngle() );
-	state.push_back( flip_coeff*GetRollAngle() );
-	state.push_back( GetPitchAngle() );
-	state.push_back( flip_coeff*GetBoggieAngle() );
-	const Vector3d* list[] = { _front_ft_sensor.GetForces(), _front_ft_sensor.GetTorques(), _rear_ft_sensor.GetForces(), _rear_ft_sensor.GetTorques() };
+	int k = 0;
+	state[k++] = flip_coeff*record[STATE_DIRECTION];
+	state[k++] = flip_coeff*record[STATE_STEERING_ANGLE];
+	state[k++] = flip_coeff*record[STATE_ROLL];
+	state[k++] = record[STATE_PITCH];
+	state[k++] = flip_coeff*record[STATE_BOGGIE_ANGLE];
 	for ( int i = 0 ; i < 4 ; i++ )
 		for ( int j = 0 ; j < 3 ; j++ )
 			if ( i != 2 || full )
-				state.push_back( ( ( i + j )%2 == 0 ? 1 : flip_coeff )*list[i]->coeff( j ) );
-	//for ( int i = 0 ; i < NBWHEELS ; i++ )
-		//state.push_back( _torque_output[i] );
+				state[k++] = ( ( i + j )%2 == 0 ? 1 : flip_coeff )*record[STATE_FRONT_FORCES+i*3+j];
+}
+
 
+vector<double> Rover_1_mt::GetState( const bool flip, const bool full ) const
+{
+	vector<double> state( full ? STATE_SIZE : state_dim );
+	GetState( state.data(), flip, full );
 	return state;
 }
 
 
-void Rover_1_mt::InferAction( const vector<double>& state, double& steering_rate, double& boggie_torque, const bool flip )
+void Rover_1_mt::InferAction( const double* state, double& steering_rate, double& boggie_torque, const bool flip )
 {
-	steering_rate = ( flip ? -1 : 1 )*_lmt_ptr_1->predict( state, node_1 );
-	boggie_torque = ( flip ? -1 : 1 )*_lmt_ptr_2->predict( state, node_2 );
+	double actions[2];
+	int leaves[2];
+	_policy->predict( state, actions, leaves, _features.data() );
+	node_1 = leaves[0];
+	node_2 = leaves[1];
+
+	steering_rate = ( flip ? -1 : 1 )*actions[0];
+	boggie_torque = ( flip ? -1 : 1 )*actions[1];
 
 #ifdef PRINT_STATE_AND_ACTIONS
-	for ( auto val : state )
-		printf( "%f ", val );
+	for ( int i = 0 ; i < state_dim ; i++ )
+		printf( "%f ", state[i] );
 	printf( "%f %f\n", _steering_rate, _boggie_torque );
 	fflush( stdout );
 #endif
@@ -72,7 +81,8 @@ void Rover_1_mt::_InternalControl( double delta_t )
 	bool flip = false;
 
 	// Get the current state of the robot:
-	vector<double> state = GetState( flip );
+	double state[state_dim];
+	GetState( state, flip );
 
 	// Infer the new action:
 	InferAction( state, _steering_rate, _boggie_torque, flip );
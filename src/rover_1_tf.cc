@@ -1,10 +1,11 @@
 #include "rover_tf.hh"
 #include <random>
+#include <stdexcept>
+#include <string>
 
 
 using namespace ode;
 using namespace Eigen;
-namespace p = boost::python;
 
 
 namespace robot
@@ -14,14 +15,19 @@ namespace robot
 Rover_1_tf::Rover_1_tf( Environment& env, const Vector3d& pose, const char* path_to_actor_model_dir, const int seed ) :
                         Rover_1( env, pose ),
 						_total_reward( 0 ),
+						_last_reward( 0 ),
+						_n_transitions( 0 ),
+						_last_transition( -1 ),
 						_exploration( false ),
+						_joined_actor( false ),
+						_explore( false ),
 						_collision( false )
 {
 	_last_pos = GetPosition();
 
 
 	// Import the actor model:
-	_actor_model_ptr = TF_model<float>::ptr_t( new TF_model<float>( path_to_actor_model_dir, { 17 }, { 2 } ) );
+	_actor = Batched_actor::get( path_to_actor_model_dir, state_dim, action_dim );
 	
 
 	// Initialization of the random number engine:
@@ -47,9 +53,10 @@ Rover_1_tf::Rover_1_tf( Environment& env, const Vector3d& pose, const char* path
 
 
 	// Assign a callback to detect if the motor bulks touch an obstacle:
-	std::function<void(collision_feature*)> collision_callback = [&]( collision_feature* collided_object )
+	int ground_id = intern_collision_group( "ground" );
+	std::function<void(collision_feature*)> collision_callback = [this,ground_id]( collision_feature* collided_object )
 	{
-		if ( collided_object != nullptr && strcmp( collided_object->group, "ground" ) == 0 )
+		if ( collided_object != nullptr && collided_object->group_id == ground_id )
 			_collision = true;
 	};
 	_front_fork->set_all_collision_callback( collision_callback );
@@ -57,26 +64,86 @@ Rover_1_tf::Rover_1_tf( Environment& env, const Vector3d& pose, const char* path
 }
 
 
-p::list Rover_1_tf::GetState() const
+Rover_1_tf::~Rover_1_tf()
 {
-	p::list state;
-
-	state.append( GetDirection() );
-	state.append( GetSteeringTrueAngle() );
-	state.append( GetRollAngle() );
-	state.append( GetPitchAngle() );
-	state.append( GetBoggieAngle() );
-	const Vector3d* list[] = { _front_ft_sensor.GetForces(), _front_ft_sensor.GetTorques(), _rear_ft_sensor.GetForces(), _rear_ft_sensor.GetTorques() };
-	for ( int i = 0 ; i < 4 ; i++ )
-		for ( int j = 0 ; j < 3 ; j++ )
-			state.append( list[i]->coeff( j ) );
-	//for ( int i = 0 ; i < NBWHEELS ; i++ )
-		//state.append( _torque_output[i] );
+	if ( _joined_actor )
+		_actor->leave();
+	if ( _experience )
+		_experience->remove_writer();
+}
+
+
+void Rover_1_tf::SetExperienceBuffer( Experience_buffer::ptr_t buffer )
+{
+	if ( buffer )
+		buffer->add_writer();
+	if ( _experience )
+		_experience->remove_writer();
+	_experience = buffer;
+}
 
+
+std::vector<float> Rover_1_tf::GetState() const
+{
+	std::vector<float> state( state_dim );
+	ExportState( state.data() );
 	return state;
 }
 
 
+void Rover_1_tf::EndEpisode( double penalty )
+{
+	if ( _joined_actor )
+	{
+		_actor->leave();
+		_joined_actor = false;
+	}
+
+	if ( _n_transitions == 0 )
+		return;
+
+	if ( _experience )
+		_experience->terminate( _last_transition, penalty );
+	_last_reward -= penalty;
+}
+
+
+void Rover_1_tf::save_state( std::vector<double>& buffer ) const
+{
+	Rover_1::save_state( buffer );
+
+	double state[] = { _last_pos.x(), _last_pos.y(), _last_pos.z(), _total_reward, _last_reward, double( _explore ), double( _collision ),
+	                   double( _n_transitions ), double( _last_transition ), double( _experience ? _experience->count() : 0 ), double( _last_state.size() ) };
+	buffer.insert( buffer.end(), state, state + 11 );
+	buffer.insert( buffer.end(), _last_state.begin(), _last_state.end() );
+}
+
+
+const double* Rover_1_tf::load_state( const double* data )
+{
+	data = Rover_1::load_state( data );
+
+	_last_pos = Vector3d( data[0], data[1], data[2] );
+	_total_reward = data[3];
+	_last_reward = data[4];
+	_explore = data[5];
+	_collision = data[6];
+	_n_transitions = data[7];
+	_last_transition = data[8];
+	// Discard the transitions recorded after the snapshot, unless they may belong to other robots:
+	if ( _experience && _experience->count() > long( data[9] ) )
+	{
+		if ( _experience->writers() > 1 )
+			throw std::runtime_error( "Cannot restore the state of a robot sharing its experience buffer with "
+			                          + std::to_string( _experience->writers() - 1 ) + " other robots" );
+		_experience->rewind( long( data[9] ) );
+	}
+	_last_state.assign( data + 11, data + 11 + size_t( data[10] ) );
+
+	return data + 11 + size_t( data[10] );
+}
+
+
 double Rover_1_tf::_ComputeReward( double delta_t )
 {
 	Vector3d new_pos = GetPosition();
@@ -113,23 +180,32 @@ void Rover_1_tf::_InternalControl( double delta_t )
 	// Get the reward obtained since last call:
 	double reward = _ComputeReward( delta_t );
 	_total_reward += reward;
+	_last_reward = reward;
 
 	// Get the current state of the robot:
-	p::list current_state = GetState();
+	float current_state[state_dim];
+	ExportState( current_state );
 
 	// Store the latest experience:
-	if ( p::len( _last_state ) > 0 )
-		_experience.append( p::make_tuple( _last_state, p::make_tuple( _steering_rate, _boggie_torque ), reward, false, current_state ) );
+	if ( ! _last_state.empty() )
+	{
+		if ( _experience )
+		{
+			float action[] = { float( _steering_rate ), float( _boggie_torque ) };
+			_last_transition = _experience->push( _last_state.data(), action, reward, false, current_state );
+		}
+		_n_transitions++;
+	}
 
 
 #ifdef PRINT_TRANSITIONS
-	if ( p::len( _last_state ) > 0 )
+	if ( ! _last_state.empty() )
 	{
-		for ( int i = 0 ; i < p::len( _last_state ) ; i++ )
-			printf( "%f ", float( p::extract<float>( _last_state[i] ) ) );
+		for ( float val : _last_state )
+			printf( "%f ", val );
 		printf( "%f %f", _steering_rate, _boggie_torque );
-		for ( int i = 0 ; i < p::len( current_state ) ; i++ )
-			printf( " %f", float( p::extract<float>( current_state[i] ) ) );
+		for ( float val : current_state )
+			printf( " %f", val );
 		printf( "\n" );
 		fflush( stdout );
 	}
@@ -139,9 +215,9 @@ void Rover_1_tf::_InternalControl( double delta_t )
 	// Determine the next action:
 
 	// Setup the inputs:
-	std::vector<float> input_vector;
-	for ( int i = 0 ; i < p::len( current_state ) ; i++ )
-		input_vector.push_back( float( p::extract<float>( current_state[i] ) )/_state_scaling[i] );
+	float input_vector[state_dim];
+	for ( int i = 0 ; i < state_dim ; i++ )
+		input_vector[i] = current_state[i]/_state_scaling[i];
 
 
 
@@ -165,37 +241,49 @@ void Rover_1_tf::_InternalControl( double delta_t )
 
 	// E-greedy exploration:
 
-	static bool explore;
-
 	double draw = ( _uniform_distribution( _rd_gen ) + 1 )/2;
-	if ( _exploration && ( ! explore && draw > 0.8 || explore && draw > 0.7 ) )
+	if ( _exploration && ( ! _explore && draw > 0.8 || _explore && draw > 0.7 ) )
 	{
-		explore = ! explore;
-		if ( explore )
+		_explore = ! _explore;
+		if ( _explore )
 		{
 			_steering_rate = _uniform_distribution( _rd_gen )*steering_max_vel;
 			_boggie_torque = _uniform_distribution( _rd_gen )*boggie_max_torque;
 		}
 	}
-	if ( !_exploration || ! explore )
+
+	// The actor is not queried while exploring, and the robot steps out of the batches
+	// meanwhile so that the other robots do not wait for it:
+	bool use_actor = ! _exploration || ! _explore;
+	if ( use_actor != _joined_actor )
+	{
+		if ( use_actor )
+			_actor->join();
+		else
+			_actor->leave();
+		_joined_actor = use_actor;
+	}
+
+	if ( use_actor )
 	{
-		std::vector<std::vector<float>> output_vectors = _actor_model_ptr->infer( { input_vector } );
+		float output_vector[action_dim];
+		_actor->infer( input_vector, output_vector );
 
-		_steering_rate = output_vectors[0][0]*steering_max_vel;
-		_boggie_torque = output_vectors[0][1]*boggie_max_torque;
+		_steering_rate = output_vector[0]*steering_max_vel;
+		_boggie_torque = output_vector[1]*boggie_max_torque;
 	}
 
 
 
 #ifdef PRINT_STATE_AND_ACTIONS
-	for ( int i = 0 ; i < p::len( current_state ) ; i++ )
-		printf( "%f ", float( p::extract<float>( current_state[i] ) ) );
+	for ( float val : current_state )
+		printf( "%f ", val );
 	printf( "%f %f\n", _steering_rate, _boggie_torque );
 	fflush( stdout );
 #endif
 
 
-	_last_state = current_state;
+	_last_state.assign( current_state, current_state + state_dim );
 }
 
 
@@ -0,0 +1,100 @@
+#ifndef ROVER_CONTROL_HH
+#define ROVER_CONTROL_HH 
+
+#include "rover.hh"
+#include <osgViewer/Viewer>
+
+
+namespace robot
+{
+
+
+class RoverControl : public osgGA::GUIEventHandler
+{
+	public:
+
+	RoverControl( robot::Rover_1* robot, osgViewer::Viewer* viewer, double speed_sensi = 0.01, double turn_sensi = 1., double torque_sensi = 1. ) :
+				  _robot_ptr( robot ), _viewer( viewer ), _speed_sensi( speed_sensi ), _turn_sensi( turn_sensi ), _torque_sensi( torque_sensi )
+	{
+		_viewer->addEventHandler( this );
+	}
+
+	virtual bool handle( const osgGA::GUIEventAdapter& ea, osgGA::GUIActionAdapter& aa )
+	{
+		double speed, rate, torque;
+
+		switch ( ea.getKey() )
+		{
+			case osgGA::GUIEventAdapter::KEY_Up :
+				speed = _robot_ptr->GetRobotSpeed();
+				speed += _speed_sensi;
+				_robot_ptr->SetRobotSpeed( speed );
+				return true;
+
+			case osgGA::GUIEventAdapter::KEY_Down :
+				speed = _robot_ptr->GetRobotSpeed();
+				speed -= _speed_sensi;
+				_robot_ptr->SetRobotSpeed( speed );
+				return true;
+
+			case osgGA::GUIEventAdapter::KEY_0 :
+			case osgGA::GUIEventAdapter::KEY_Exclaim :
+				_robot_ptr->SetRobotSpeed( 0 );
+				return true;
+
+			case osgGA::GUIEventAdapter::KEY_Left :
+				rate = _robot_ptr->GetSteeringRateCmd();
+				rate -= _turn_sensi;
+				_robot_ptr->SetSteeringRate( rate );
+				return true;
+
+			case osgGA::GUIEventAdapter::KEY_Right :
+				rate = _robot_ptr->GetSteeringRateCmd();
+				rate += _turn_sensi;
+				_robot_ptr->SetSteeringRate( rate );
+				return true;
+
+			case osgGA::GUIEventAdapter::KEY_Control_R :
+				_robot_ptr->SetSteeringRate( 0 );
+				return true;
+
+			case osgGA::GUIEventAdapter::KEY_KP_Subtract :
+			case osgGA::GUIEventAdapter::KEY_Page_Down :
+				torque = _robot_ptr->GetBoggieTorque();
+				torque -= _torque_sensi;
+				_robot_ptr->SetBoggieTorque( torque );
+				return true;
+
+			case osgGA::GUIEventAdapter::KEY_KP_Add :
+			case osgGA::GUIEventAdapter::KEY_Page_Up :
+				torque = _robot_ptr->GetBoggieTorque();
+				torque += _torque_sensi;
+				_robot_ptr->SetBoggieTorque( torque );
+				return true;
+
+			case osgGA::GUIEventAdapter::KEY_KP_Multiply :
+			case osgGA::GUIEventAdapter::KEY_Asterisk :
+				_robot_ptr->SetBoggieTorque( 0 );
+				return true;
+		}
+		return false;
+	}
+
+	void Detach()
+	{
+		_viewer->removeEventHandler( this );
+	}
+
+	protected:
+
+	robot::Rover_1* _robot_ptr;
+	osgViewer::Viewer* _viewer;
+	double _speed_sensi;
+	double _turn_sensi;
+	double _torque_sensi;
+};
+
+
+}
+
+#endif
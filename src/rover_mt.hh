@@ -2,7 +2,7 @@
 #define ROVER_MT_HH 
 
 #include "rover.hh"
-#include "model_tree.hh" // https://github.com/Bouty92/ModelTree
+#include "flat_model_tree.hh"
 
 
 namespace robot
@@ -13,13 +13,25 @@ class Rover_1_mt : public Rover_1
 {
 	public:
 
+	// Dimension of the state returned by GetState when not full:
+	static constexpr int state_dim = 14;
+
 	Rover_1_mt( ode::Environment& env, const Eigen::Vector3d& pose, const std::string yaml_file_path_1, const std::string yaml_file_path_2,
 	            bool oblique_trees = false, unsigned int degree = 1, bool interaction_only = false );
 
+	// Controller already loaded, possibly shared with robots running in other threads:
+	Rover_1_mt( ode::Environment& env, const Eigen::Vector3d& pose, Flat_tree_policy<double>::ptr_t policy );
+
 	std::vector<double> GetState( const bool flip = false, const bool full = false ) const;
 	inline std::vector<double> GetFullState( const bool flip = false ) const { return GetState( flip, true ); }
+	// Same into a buffer of size state_dim ( STATE_SIZE if full ):
+	void GetState( double* state, const bool flip = false, const bool full = false ) const;
 
-	void InferAction( const std::vector<double>& state, double& steering_rate, double& boggie_torque, const bool flip = false );
+	void InferAction( const double* state, double& steering_rate, double& boggie_torque, const bool flip = false );
+	inline void InferAction( const std::vector<double>& state, double& steering_rate, double& boggie_torque, const bool flip = false )
+	{
+		InferAction( state.data(), steering_rate, boggie_torque, flip );
+	}
 
 	int node_1, node_2;
 
@@ -27,7 +39,9 @@ class Rover_1_mt : public Rover_1
 
 	virtual void _InternalControl( double delta_t );
 
-	mt_ptr_t<double> _lmt_ptr_1, _lmt_ptr_2;
+	// Both trees compiled into flat arrays and evaluated together:
+	Flat_tree_policy<double>::ptr_t _policy;
+	std::vector<double> _features;
 };
 
 
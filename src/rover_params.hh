@@ -0,0 +1,48 @@
+#ifndef ROVER_PARAMS_HH
+#define ROVER_PARAMS_HH
+
+
+#define NBWHEELS 4
+
+#ifndef ROBOTS_DIR
+#define ROBOTS_DIR "../robots/"
+#endif
+
+
+namespace robot
+{
+
+
+// Kinematics and command limits of a four-wheel rover with a central steering hinge and a rear boggie, given as the
+// template argument of robot::Rover so that the constants of the control fold at compile time. The parts and joints
+// are built from the description file, whose wheels and actuators must match the geometry and limits given here.
+// The wheels are ordered front left, front right, rear left, rear right. Lengths in m, angles in degrees.
+// A variant only has to redefine the constants differing from those of Rover_1_params:
+//
+//	struct Rover_2_params : Rover_1_params
+//	{
+//		static constexpr const char* description() { return ROBOTS_DIR "rover_2.yaml"; }
+//		static constexpr double wheelbase() { return 0.7; }
+//	};
+//
+// and to be instantiated at the end of rover_1.cc.
+struct Rover_1_params
+{
+	static constexpr const char* description() { return ROBOTS_DIR "rover_1.yaml"; }
+
+	static constexpr double wheelbase() { return 0.58; }
+	static constexpr double wheeltrack() { return 0.61; }
+	static constexpr double wheel_radius( int ) { return 0.105; }
+
+	static constexpr double wheels_max_speed() { return 7.4351; } // rad/s
+
+	static constexpr double steering_max_vel() { return 15; } // deg/s
+	static constexpr double steering_angle_max() { return 45; }
+
+	static constexpr double boggie_max_torque() { return 25; } // N.m
+};
+
+
+}
+
+#endif
@@ -0,0 +1,110 @@
+#ifndef ROVER_RECORDER_HH
+#define ROVER_RECORDER_HH
+
+#include "rover.hh"
+#include "ode/trajectory_log.hh"
+
+
+namespace robot
+{
+
+
+// Trajectory of a rover streamed as fixed-size records into a binary log ( read with scripts/trajectory_log.py ):
+//   time    Simulation time ( float64 ).
+//   episode Index of the episode, to separate the episodes appended to the same log.
+//   tick    1 if the internal control ran at this step.
+//   poses   Position and quaternion ( w, x, y, z ) of every body of the robot.
+//   joints  Angle of every joint of the actuator bank.
+//   state   State of the robot as exported by ExportState, including the force/torque sensors.
+//   action  Steering rate and boggie torque commands.
+//   reward  Last reward of the controller, if any.
+//   scenario Optional parameters of the scenario, to build again its terrain when replaying the episode.
+// Several recorders can share the same writer from different threads.
+class Rover_recorder
+{
+	public:
+
+	Rover_recorder( ode::Trajectory_writer::ptr_t writer, int episode = 0 ) :
+	                _writer( writer ), _episode( episode ), _record( writer->new_record() ), _scenario_field( writer->layout().find( "scenario" ) ) {}
+
+	// Writer of the records of robots built like this one, appending to the log if it already exists:
+	static ode::Trajectory_writer::ptr_t open( const std::string& path, const Rover_1& robot, int n_scenario_params = 0, bool append = true )
+	{
+		return ode::Trajectory_writer::ptr_t( new ode::Trajectory_writer( path, layout( robot.bodies().size(), robot.actuators().size(), n_scenario_params ), append ) );
+	}
+
+	static ode::Record_layout layout( int n_bodies, int n_joints, int n_scenario_params = 0 )
+	{
+		ode::Record_layout layout;
+		layout.add( "time", ode::Record_layout::FLOAT64 );
+		layout.add( "episode", ode::Record_layout::INT32 );
+		layout.add( "tick", ode::Record_layout::INT32 );
+		layout.add( "poses", ode::Record_layout::FLOAT32, 7*n_bodies );
+		layout.add( "joints", ode::Record_layout::FLOAT32, n_joints );
+		layout.add( "state", ode::Record_layout::FLOAT32, Rover_1::STATE_SIZE );
+		layout.add( "action", ode::Record_layout::FLOAT32, 2 );
+		layout.add( "reward", ode::Record_layout::FLOAT32 );
+		if ( n_scenario_params > 0 )
+			layout.add( "scenario", ode::Record_layout::FLOAT32, n_scenario_params );
+		return layout;
+	}
+
+	inline void set_episode( int episode ) { _episode = episode; }
+	inline int get_episode() const { return _episode; }
+
+	// Parameters of the scenario written with every record:
+	inline void set_scenario( const std::vector<float>& params )
+	{
+		if ( _scenario_field >= 0 )
+			_writer->set( _record, _scenario_field, params.data(), params.size() );
+	}
+
+	void record( const Rover_1& robot, double time, double reward = 0 )
+	{
+		const std::vector<ode::Object*>& bodies = robot.bodies();
+		_poses.resize( 7*bodies.size() );
+		for ( size_t i = 0 ; i < bodies.size() ; i++ )
+		{
+			dBodyID body = bodies[i]->get_body();
+			std::copy( dBodyGetPosition( body ), dBodyGetPosition( body ) + 3, &_poses[7*i] );
+			std::copy( dBodyGetQuaternion( body ), dBodyGetQuaternion( body ) + 4, &_poses[7*i+3] );
+		}
+
+		const ode::Actuator_bank& actuators = robot.actuators();
+		_joints.resize( actuators.size() );
+		for ( int i = 0 ; i < actuators.size() ; i++ )
+			_joints[i] = actuators.get_angle( i );
+
+		float state[Rover_1::STATE_SIZE];
+		robot.ExportState( state );
+		float action[] = { float( robot.GetSteeringRateCmd() ), float( robot.GetBoggieTorque() ) };
+
+		_writer->set( _record, FIELD_TIME, time );
+		_writer->set( _record, FIELD_EPISODE, _episode );
+		_writer->set( _record, FIELD_TICK, int( robot.ICTick() ) );
+		_writer->set( _record, FIELD_POSES, _poses.data(), _poses.size() );
+		_writer->set( _record, FIELD_JOINTS, _joints.data(), _joints.size() );
+		_writer->set( _record, FIELD_STATE, state, Rover_1::STATE_SIZE );
+		_writer->set( _record, FIELD_ACTION, action, 2 );
+		_writer->set( _record, FIELD_REWARD, reward );
+		_writer->commit( _record );
+	}
+
+	// Indices of the fields in the layout:
+	enum { FIELD_TIME, FIELD_EPISODE, FIELD_TICK, FIELD_POSES, FIELD_JOINTS, FIELD_STATE, FIELD_ACTION, FIELD_REWARD };
+
+	protected:
+
+	ode::Trajectory_writer::ptr_t _writer;
+	int _episode;
+	std::vector<char> _record;
+	int _scenario_field;
+	std::vector<float> _poses;
+	std::vector<float> _joints;
+};
+
+
+}
+
+
+#endif
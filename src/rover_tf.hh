@@ -2,8 +2,8 @@
 #define ROVER_TF_HH 
 
 #include "rover.hh"
-#include "tf_cpp_binding.hh" // https://github.com/arthur-bouton/MachineLearning/tree/master/tf_cpp_binding
-#include <boost/python.hpp>
+#include "experience_buffer.hh"
+#include "batched_actor.hh"
 #include <random>
 
 
@@ -15,15 +15,38 @@ class Rover_1_tf : public Rover_1
 {
 	public:
 
+	static constexpr int state_dim = STATE_SIZE;
+	static constexpr int action_dim = 2;
+
+	// The actor model is shared with the other robots using the same directory in the process:
 	Rover_1_tf( ode::Environment& env, const Eigen::Vector3d& pose, const char* path_to_actor_model_dir, const int seed = -1 );
+	virtual ~Rover_1_tf();
 
-	boost::python::list GetState() const;
+	std::vector<float> GetState() const;
+	inline void GetState( float* state ) const { ExportState( state ); }
 
 	inline void SetExploration( bool expl ) { _exploration = expl; }
 
-	inline boost::python::list GetExperience() const { return _experience; }
+	// Buffer in which to record the transitions ( none by default ):
+	void SetExperienceBuffer( Experience_buffer::ptr_t buffer );
+	inline Experience_buffer::ptr_t GetExperienceBuffer() const { return _experience; }
+
+	// State observed at the last control tick, whose action has no transition yet ( empty before the first tick ):
+	inline const std::vector<float>& GetLastState() const { return _last_state; }
+
+	// Number of transitions experienced since the start of the episode:
+	inline long GetTransitionCount() const { return _n_transitions; }
+
+	// Flag the last transition as terminal and subtract a penalty from its reward.
+	// The robot stops taking part in the batched inferences of the actor:
+	void EndEpisode( double penalty = 0 );
 
 	inline double GetTotalReward() const { return _total_reward; }
+	inline double GetLastReward() const { return _last_reward; }
+
+	// The random generator is not part of the state so that branching rollouts can diverge:
+	virtual void save_state( std::vector<double>& buffer ) const;
+	virtual const double* load_state( const double* data );
 
 	protected:
 
@@ -31,12 +54,17 @@ class Rover_1_tf : public Rover_1
 
 	virtual void _InternalControl( double delta_t );
 
-	TF_model<float>::ptr_t _actor_model_ptr;
+	Batched_actor::ptr_t _actor;
+	bool _joined_actor;
 	Eigen::Vector3d _last_pos;
-	boost::python::list _last_state;
-	boost::python::list _experience;
+	std::vector<float> _last_state;
+	Experience_buffer::ptr_t _experience;
+	long _n_transitions;
+	long _last_transition;
 	double _total_reward;
+	double _last_reward;
 	bool _exploration;
+	bool _explore;
     std::mt19937 _rd_gen;
     std::normal_distribution<double> _normal_distribution;
     std::uniform_real_distribution<double> _uniform_distribution;
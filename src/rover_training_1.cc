@@ -18,18 +18,27 @@
 **
 ** Fourth argument (optional):
 ** Starting delay of the control.
+**
+** Fifth argument (optional):
+** Seed of a deterministic run, replayed bit for bit when given again.
 */
 
 #include "ode/environment.hh"
+#include "ode/vec_environment.hh"
 #include "renderer/osg_visitor.hh"
 #include "rover_tf.hh"
+#include "rover_control.hh"
+#include "step_scenario.hh"
 #include "ode/box.hh"
 #include "ode/heightfield.hh"
 #include "renderer/sim_loop.hh"
+#include "ode/headless_loop.hh"
 #include "renderer/osg_text.hh"
 #include <boost/python.hpp>
 #include <random>
 #include <csignal>
+#include <cmath>
+#include <algorithm>
 
 
 #define DEFAULT_PATH_TO_MODEL_DIR "../training_data/Rt05/actor"
@@ -38,111 +47,133 @@
 namespace p = boost::python;
 
 
-p::list simulation( const char* option = "", const char* path_to_model_dir = DEFAULT_PATH_TO_MODEL_DIR, int argc = 0, char* argv[] = nullptr )
+// Step scenario with the terminal penalties of the training:
+class Trial : public Step_scenario<robot::Rover_1_tf>
 {
-	// Uniform random generator:
-	std::random_device rd;
-	std::mt19937 gen( rd() );
-	std::uniform_real_distribution<double> uniform( -1, 1 );
+	public:
+
+	static constexpr int state_dim = robot::Rover_1_tf::state_dim;
+
+	// In deterministic mode, the exploration of the rover is seeded from the seed of the environment.
+	// The actions remain subject to the batching of the inferences shared with other trials:
+	Trial( const Step_params& params, const char* path_to_model_dir, bool exploration, Experience_buffer::ptr_t experience = Experience_buffer::ptr_t() ) :
+	       Step_scenario<robot::Rover_1_tf>( params, path_to_model_dir, params.config.deterministic ? int( ode::derive_seed( params.config.seed, 1 ) >> 33 ) : -1 )
+	{
+		robot.SetExploration( exploration );
+		robot.SetExperienceBuffer( experience );
+	}
+
+	bool next_step( float timestep, double time )
+	{
+		if ( ! Step_scenario<robot::Rover_1_tf>::next_step( timestep, time ) )
+			return false;
+
+		// Penalise if the rover has gone too far sideway:
+		if ( IsOutOfTrack() )
+			robot.EndEpisode( 2 );
+		// Penalise if the rover has tipped over:
+		else if ( robot.IsUpsideDown() )
+			robot.EndEpisode( 5 );
+		else
+			robot.EndEpisode();
+
+		return true;
+	}
+
+	inline bool next_step( float timestep ) { return next_step( timestep, _n_steps*timestep ); }
+
+	inline bool control_tick() const { return robot.ICTick(); }
 
+	inline void get_state( float* state ) const { robot.ExportState( state ); }
 
-	// [ Dynamic environment ]
+	inline float get_reward() const { return robot.GetLastReward(); }
+};
 
-	dInitODE();
-	// Set the global friction coefficient:
-	ode::Environment env( 0.5 );
 
+// Random parameters of a training trial:
+Step_params draw_trial_params( std::mt19937& gen )
+{
+	std::uniform_real_distribution<double> uniform( -1, 1 );
 
-	// [ Robot ]
+	Step_params params;
+	// Maximum angle to be chosen randomly:
+	float max_rot( 5 );
+	params.orientation = max_rot*uniform( gen );
+	params.IC_start += 0.25*uniform( gen );
+
+	return params;
+}
+
+
+// Seeded parameters of a deterministic trial, or random ones if the seed is negative:
+Step_params draw_trial_params( long seed )
+{
+	if ( seed < 0 )
+	{
+		std::random_device rd;
+		std::mt19937 gen( rd() );
+		return draw_trial_params( gen );
+	}
 
-	robot::Rover_1_tf robot( env, Eigen::Vector3d( 0, 0, 0 ), path_to_model_dir );
-	robot.SetCrawlingMode( true );
-	robot.SetCmdPeriod( 0.5 );
-//#ifdef EXE
-	//robot.SetCmdPeriod( 0.1 );
-//#endif
-	robot.DeactivateIC();
-	if ( strncmp( option, "trial", 6 ) == 0 || strncmp( option, "explore", 8 ) == 0 )
-		robot.SetExploration( true );
+	std::mt19937 gen( ode::derive_seed( seed, 0 ) );
+	Step_params params = draw_trial_params( gen );
+	params.config.deterministic = true;
+	params.config.seed = seed;
+	return params;
+}
 
 
-	// [ Terrain ]
+// Returns the number of transitions experienced, which are recorded in the buffer if any:
+long simulation( const char* option = "", const char* path_to_model_dir = DEFAULT_PATH_TO_MODEL_DIR, Experience_buffer::ptr_t experience = Experience_buffer::ptr_t(),
+                 int argc = 0, char* argv[] = nullptr, long seed = -1 )
+{
+	// Seed of a deterministic run:
+	if ( argc > 5 )
+	{
+		char* endptr;
+		seed = strtol( argv[5], &endptr, 10 );
+		if ( *endptr != '\0' || seed < 0 )
+			throw std::runtime_error( std::string( "Invalide seed: " ) + std::string( argv[5] ) );
+	}
 
-	int direction = 1;
+	Step_params params = draw_trial_params( seed );
+	if ( strncmp( option, "trial", 6 ) != 0 )
+	{
+		// Only the orientation is random outside of the training trials:
+		double orientation = params.orientation;
+		params.orientation = Step_params().orientation;
+		params.IC_start = Step_params().IC_start;
+		if ( strncmp( option, "eval", 5 ) != 0 && strncmp( option, "display", 8 ) != 0 )
+			params.orientation = orientation;
+	}
 
 	// Orientation angle of the step:
-	double orientation;
 	if ( argc > 3 )
 	{
 		char* endptr;
-		orientation = strtod( argv[3], &endptr );
+		params.orientation = strtod( argv[3], &endptr );
 		if ( *endptr != '\0' )
 			throw std::runtime_error( std::string( "Invalide orientation: " ) + std::string( argv[3] ) );
 	}
-	else if ( strncmp( option, "eval", 5 ) == 0 || strncmp( option, "display", 8 ) == 0 )
-		orientation = 0;
-	else
-	{
-		// Maximum angle to be chosen randomly when not specified:
-		float max_rot( 5 );
-		orientation = max_rot*uniform( gen );
-	}
-	float step_height( 0.105*2 );
-	ode::Box step( env, Eigen::Vector3d( direction*1, 0, step_height/2 ), 1, 1, 3, step_height, false );
-	step.set_rotation( 0, 0, orientation*M_PI/180 );
-	step.fix();
-	step.set_collision_group( "ground" );
-
-	ode::Box step_c( env, Eigen::Vector3d( direction*2, 0, step_height/2 ), 1, 2, 3, step_height, false );
-	step_c.fix();
-	step_c.set_collision_group( "ground" );
-
-
-	// [ Simulation rules ]
-
-	// Cruise speed of the robot:
-	float speedf( direction*0.04 );
-	// Time to reach cruise speed:
-	float term( 0.5 );
-	// Duration before starting the internal control:
-	float IC_start( 1 );
+	// Starting offset of the internal control:
 	if ( argc > 4 )
 	{
 		char* endptr;
-		IC_start += strtod( argv[4], &endptr );
+		params.IC_start = Step_params().IC_start + strtod( argv[4], &endptr );
 		if ( *endptr != '\0' )
 			throw std::runtime_error( std::string( "Invalide starting offset: " ) + std::string( argv[4] ) );
 	}
-	else if ( strncmp( option, "trial", 6 ) == 0 )
-		IC_start += 0.25*uniform( gen );
-	// Timeout of the simulation:
-	float timeout( 60 );
-	// Maximum distance to travel ahead:
-	float x_goal( 1.5 );
-	// Maximum lateral deviation permitted:
-	float y_max( 0.6 );
-
-	float speed = 0;
-
-	std::function<bool(float,double)> step_function = [&]( float timestep, double time )
-	{
-		if ( fabs( speed ) <= fabs( speedf ) )
-		{
-			speed += speedf/term*timestep;
-			robot.SetRobotSpeed( speed );
-		}
 
-		if ( ! robot.IsICActivated() && time >= IC_start )
-			robot.ActivateIC();
 
-		env.next_step( timestep );
-		robot.next_step( timestep );
+	// [ Dynamic environment, robot and terrain ]
 
-		// If the robot has reached the goal, is out of track or has tipped over, end the simulation:
-		if ( time >= timeout || fabs( robot.GetPosition().y() ) >= y_max || fabs( robot.GetPosition().x() ) >= x_goal || robot.IsUpsideDown() )
-			return true;
+	bool exploration = strncmp( option, "trial", 6 ) == 0 || strncmp( option, "explore", 8 ) == 0;
+	Trial trial( params, path_to_model_dir, exploration, experience );
+	robot::Rover_1_tf& robot = trial.robot;
 
-		return false;
+	auto step_function = [&]( float timestep, double time )
+	{
+		return trial.next_step( timestep, time );
 	};
 
 
@@ -162,8 +193,8 @@ p::list simulation( const char* option = "", const char* path_to_model_dir = DEF
 		display_ptr->get_keh()->set_pause();
 
 		robot.accept( *display_ptr );
-		step.accept( *display_ptr );
-		step_c.accept( *display_ptr );
+		trial.step.accept( *display_ptr );
+		trial.step_c.accept( *display_ptr );
 
 		robot::RoverControl* keycontrol = new robot::RoverControl( &robot, display_ptr->get_viewer() );
 
@@ -190,38 +221,44 @@ p::list simulation( const char* option = "", const char* path_to_model_dir = DEF
 
 	// [ Simulation loop ]
 
-	Sim_loop sim( 0.001, display_ptr, true, 0 );
+	double sim_time;
 
-	// Record screenshots of the simulation:
-	if ( strncmp( option, "capture", 8 ) == 0 )
-		sim.start_captures();
+	// Print the progress of the simulation time, with or without display:
+	const bool print_time = true;
 
-	sim.loop( step_function );
+	if ( display_ptr != nullptr )
+	{
+		Sim_loop sim( 0.001, display_ptr, print_time, 0 );
+
+		// Record screenshots of the simulation:
+		if ( strncmp( option, "capture", 8 ) == 0 )
+			sim.start_captures();
+
+		sim.loop( step_function );
+		sim_time = sim.get_time();
+	}
+	else
+	{
+		// Without rendering, avoid the overhead of the display loop and run the steps
+		// of each control period of the rover in a row, the rover controlling itself within its steps:
+		Headless_loop sim( 0.001, print_time );
+		int steps_per_tick = std::max( 1, int( lround( params.cmd_period/0.001 ) ) );
+		sim.loop( step_function, []( float tick_duration, double time ) { return false; }, steps_per_tick );
+		sim_time = sim.get_time();
+	}
 
 
 	// Print the result of the trial:
 	if ( strncmp( option, "trial", 6 ) != 0 )
 	{
 		printf( "%s t %6.3f | x %5.3f | y %+6.3f | Rmoy %7.3f\n",
-		( fabs( robot.GetPosition().x() ) >= x_goal ? "\033[1;32m[Success]\033[0;39m" : "\033[1;31m[Failure]\033[0;39m" ),
-		sim.get_time(), robot.GetPosition().x(), robot.GetPosition().y(), robot.GetTotalReward()/sim.get_time() );
+		( trial.HasReachedGoal() ? "\033[1;32m[Success]\033[0;39m" : "\033[1;31m[Failure]\033[0;39m" ),
+		sim_time, robot.GetPosition().x(), robot.GetPosition().y(), robot.GetTotalReward()/sim_time );
 		fflush( stdout );
 	}
 
 
-	// Fetch the stored experience from the trial:
-	p::list experience = robot.GetExperience();
-
-	// Penalise if the rover has gone too far sideway:
-	if ( fabs( robot.GetPosition().y() ) >= y_max )
-		experience[-1] = p::make_tuple( experience[-1][0], experience[-1][1], experience[-1][2] - 2, true, experience[-1][4] );
-	// Penalise if the rover has tipped over:
-	else if ( robot.IsUpsideDown() )
-		experience[-1] = p::make_tuple( experience[-1][0], experience[-1][1], experience[-1][2] - 5, true, experience[-1][4] );
-	else
-		experience[-1] = p::make_tuple( experience[-1][0], experience[-1][1], experience[-1][2], true, experience[-1][4] );
-
-	return experience;
+	return robot.GetTransitionCount();
 }
 
 
@@ -234,15 +271,24 @@ int main( int argc, char* argv[] )
 	if ( argc > 2 && strncmp( argv[2], "--", 3 ) != 0 )
 		path_to_model_dir = argv[2];
 
-	simulation( argc > 1 ? argv[1] : "display", path_to_model_dir, argc, argv );
+	dInitODE2( 0 );
+	simulation( argc > 1 ? argv[1] : "display", path_to_model_dir, Experience_buffer::ptr_t(), argc, argv );
+	dCloseODE();
 
 	return 0;
 }
 
 
-p::list trial( const char* path_to_model_dir )
+// Transitions per row of the experience buffers handled by the module:
+Experience_buffer::ptr_t new_experience_buffer( long capacity )
+{
+	return Experience_buffer::ptr_t( new Experience_buffer( robot::Rover_1_tf::state_dim, robot::Rover_1_tf::action_dim, capacity ) );
+}
+
+
+long trial( const char* path_to_model_dir, Experience_buffer::ptr_t experience, long seed )
 {
-	return simulation( "trial", path_to_model_dir );
+	return simulation( "trial", path_to_model_dir, experience, 0, nullptr, seed );
 }
 
 
@@ -252,10 +298,185 @@ void eval( const char* path_to_model_dir )
 }
 
 
+// Release the GIL while the worker threads are running:
+class Release_GIL
+{
+	public:
+
+	Release_GIL() : _state( PyEval_SaveThread() ) {}
+	~Release_GIL() { PyEval_RestoreThread( _state ); }
+
+	protected:
+
+	PyThreadState* _state;
+};
+
+
+// Python object exposing a C++ buffer through the buffer protocol, and keeping alive the Python object owning it:
+typedef struct Buffer_view
+{
+	PyObject_HEAD
+	char* data;
+	Py_ssize_t size;
+	PyObject* owner;
+} Buffer_view;
+
+static int _buffer_view_get( PyObject* self, Py_buffer* view, int flags )
+{
+	Buffer_view* buffer = (Buffer_view*) self;
+	return PyBuffer_FillInfo( view, self, buffer->data, buffer->size, 1, flags );
+}
+
+static void _buffer_view_dealloc( PyObject* self )
+{
+	Py_XDECREF( ( (Buffer_view*) self )->owner );
+	PyObject_Del( self );
+}
+
+static PyBufferProcs _buffer_view_procs = { _buffer_view_get, nullptr };
+static PyTypeObject _buffer_view_type = { PyVarObject_HEAD_INIT( nullptr, 0 ) };
+
+// To be called once at the loading of the module:
+void init_buffer_view_type()
+{
+	_buffer_view_type.tp_name = "rover_training_1_module.BufferView";
+	_buffer_view_type.tp_basicsize = sizeof( Buffer_view );
+	_buffer_view_type.tp_dealloc = _buffer_view_dealloc;
+	_buffer_view_type.tp_as_buffer = &_buffer_view_procs;
+	_buffer_view_type.tp_flags = Py_TPFLAGS_DEFAULT;
+	if ( PyType_Ready( &_buffer_view_type ) < 0 )
+		p::throw_error_already_set();
+}
+
+
+// Read-only view on a C++ buffer, to be wrapped by numpy.asarray without any copy.
+// The view holds a reference to the owner of the buffer, which outlives it:
+p::object as_memoryview( const void* data, size_t size, const char* format, p::tuple shape, p::object owner )
+{
+	Buffer_view* buffer = PyObject_New( Buffer_view, &_buffer_view_type );
+	if ( buffer == nullptr )
+		p::throw_error_already_set();
+	buffer->data = (char*) data;
+	buffer->size = size;
+	buffer->owner = p::incref( owner.ptr() );
+	p::object holder( p::handle<>( (PyObject*) buffer ) );
+
+	p::object view( p::handle<>( PyMemoryView_FromObject( holder.ptr() ) ) );
+	return view.attr( "cast" )( format, shape );
+}
+
+
+// View of shape ( capacity, row_size ) on the whole storage of the buffer:
+p::object experience_array( p::object self )
+{
+	const Experience_buffer& buffer = p::extract<const Experience_buffer&>( self );
+	return as_memoryview( buffer.data(), buffer.capacity()*buffer.row_size()*sizeof( float ), "f", p::make_tuple( buffer.capacity(), buffer.row_size() ), self );
+}
+
+
+// Parallel training trials, each one in its own world:
+class VecTrials : public ode::VecEnvironment<Trial>
+{
+	public:
+
+	// With a non-negative seed, the parameters and the exploration noise of the episode k of the trial i are drawn from ( seed, i, k ) only.
+	// The episodes are not reproducible bit for bit though, as the composition of the batches of inferences depends on the timing of the trials:
+	VecTrials( const char* path_to_model_dir, int n_envs, int n_threads = 0, Experience_buffer::ptr_t experience = Experience_buffer::ptr_t(), long seed = -1 ) :
+	           ode::VecEnvironment<Trial>( n_envs, _make_factory( path_to_model_dir, experience, seed, n_envs ), 0.001, n_threads ) {}
+
+	void py_reset()
+	{
+		Release_GIL nogil;
+		reset();
+	}
+
+	// Step every trial to its next control tick and return the stacked states, rewards and done flags,
+	// as views keeping the Python object self alive:
+	static p::tuple py_step( p::object self )
+	{
+		VecTrials& vec = p::extract<VecTrials&>( self );
+		{
+			Release_GIL nogil;
+			vec.step();
+		}
+		return p::make_tuple( as_memoryview( vec.states(), vec.size()*Trial::state_dim*sizeof( float ), "f", p::make_tuple( vec.size(), int( Trial::state_dim ) ), self ),
+		                      as_memoryview( vec.rewards(), vec.size()*sizeof( float ), "f", p::make_tuple( vec.size() ), self ),
+		                      as_memoryview( vec.dones(), vec.size()*sizeof( unsigned char ), "?", p::make_tuple( vec.size() ), self ) );
+	}
+
+	// Run all the episodes to their end and return the total number of transitions:
+	long py_run()
+	{
+		Release_GIL nogil;
+		run();
+
+		long n_transitions = 0;
+		for ( int i = 0 ; i < size() ; i++ )
+			n_transitions += ( *this )[i].robot.GetTransitionCount();
+		return n_transitions;
+	}
+
+	protected:
+
+	static factory_t _make_factory( const char* path_to_model_dir, Experience_buffer::ptr_t experience, long seed, int n_envs )
+	{
+		std::string path( path_to_model_dir );
+
+		// The parameters are drawn on the calling thread so that the factory can be run by the workers:
+		auto gen = std::make_shared<std::mt19937>( std::random_device()() );
+		auto mutex = std::make_shared<std::mutex>();
+		// Number of episodes built for each trial, each entry being used by a single worker at a time:
+		auto episodes = std::make_shared<std::vector<long>>( n_envs, 0 );
+
+		return [path,gen,mutex,episodes,experience,seed]( int i )
+		{
+			Step_params params;
+			if ( seed >= 0 )
+				params = draw_trial_params( long( ode::derive_seed( ode::derive_seed( seed, i ), ( *episodes )[i]++ ) >> 1 ) );
+			else
+			{
+				std::lock_guard<std::mutex> lock( *mutex );
+				params = draw_trial_params( *gen );
+			}
+			return new Trial( params, path.c_str(), true, experience );
+		};
+	}
+};
+
+
+// Collect n_envs training trials in parallel into the same buffer:
+long trials( const char* path_to_model_dir, int n_envs, Experience_buffer::ptr_t experience, long seed )
+{
+	VecTrials vec_trials( path_to_model_dir, n_envs, 0, experience, seed );
+	return vec_trials.py_run();
+}
+
+
 BOOST_PYTHON_MODULE( rover_training_1_module )
 {
 	signal( SIGINT, SIG_DFL );
+	// ODE is initialised once for all the simulations of the process:
+	dInitODE2( 0 );
+	init_buffer_view_type();
 
-    p::def( "trial", trial );
+    p::def( "trial", trial, ( p::arg( "path_to_model_dir" ), p::arg( "experience" ), p::arg( "seed" ) = -1 ) );
     p::def( "eval", eval );
+    p::def( "trials", trials, ( p::arg( "path_to_model_dir" ), p::arg( "n_envs" ), p::arg( "experience" ), p::arg( "seed" ) = -1 ) );
+
+	p::class_<Experience_buffer,Experience_buffer::ptr_t,boost::noncopyable>( "ExperienceBuffer", p::no_init )
+		.def( "__init__", p::make_constructor( new_experience_buffer ) )
+		.def( "__len__", &Experience_buffer::size )
+		.add_property( "capacity", &Experience_buffer::capacity )
+		.add_property( "count", &Experience_buffer::count )
+		.add_property( "head", &Experience_buffer::head )
+		.def( "array", experience_array )
+		.def( "clear", &Experience_buffer::clear )
+	;
+
+	p::class_<VecTrials,boost::noncopyable>( "VecEnvironment", p::init<const char*,int,p::optional<int,Experience_buffer::ptr_t,long>>() )
+		.def( "__len__", &VecTrials::size )
+		.def( "reset", &VecTrials::py_reset )
+		.def( "step", &VecTrials::py_step )
+		.def( "run", &VecTrials::py_run )
+	;
 }
@@ -1,6 +1,7 @@
 #include "ode/environment.hh"
 #include "renderer/osg_visitor.hh"
 #include "rover.hh"
+#include "rover_control.hh"
 #include "ode/box.hh"
 #include "ode/heightfield.hh"
 #include "renderer/sim_loop.hh"
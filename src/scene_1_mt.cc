@@ -1,10 +1,13 @@
 #include "ode/environment.hh"
 #include "renderer/osg_visitor.hh"
 #include "rover_mt.hh"
+#include "rover_control.hh"
 #include "ode/box.hh"
 #include "ode/heightfield.hh"
 #include "renderer/sim_loop.hh"
+#include "ode/headless_loop.hh"
 #include "renderer/osg_text.hh"
+#include <mutex>
 
 
 #define YAML_FILE_PATH "../scripts/tree_params2_"
@@ -92,7 +95,11 @@ int main( int argc, char* argv[] )
 	float speed = 0;
 	std::vector<double> prev_state;
 
-	std::function<bool(float,double)> step_function = [&]( float timestep, double time )
+	// Values displayed by the HUD, copied after each step since the physics may run on its own thread:
+	struct { double speed, steering_rate, boggie_torque, x, y; int node_1, node_2; } hud = {};
+	std::mutex hud_mutex;
+
+	auto step_function = [&]( float timestep, double time )
 	{
 		if ( fabs( speed ) <= fabs( speedf ) )
 		{
@@ -125,6 +132,12 @@ int main( int argc, char* argv[] )
 			//prev_state = current_state;
 		//}
 
+		{
+			std::lock_guard<std::mutex> lock( hud_mutex );
+			hud = { robot.GetRobotSpeed(), robot.GetSteeringRateCmd(), robot.GetBoggieTorque(),
+			        robot.GetPosition().x(), robot.GetPosition().y(), robot.node_1, robot.node_2 };
+		}
+
 		if ( time >= timeout || fabs( robot.GetPosition().y() ) >= y_max || fabs( robot.GetPosition().x() ) >= x_goal || robot.IsUpsideDown() )
 			return true;
 
@@ -159,11 +172,15 @@ int main( int argc, char* argv[] )
 		//robot::RoverControl* keycontrol = new robot::RoverControl( &robot, display_ptr->get_viewer() );
 
 
-		std::function<bool(renderer::OsgText*)> update_text = [&robot]( renderer::OsgText* text )
+		std::function<bool(renderer::OsgText*)> update_text = [&hud,&hud_mutex]( renderer::OsgText* text )
 		{
+			std::unique_lock<std::mutex> lock( hud_mutex );
+			auto values = hud;
+			lock.unlock();
+
 			char buff[200];
 			snprintf( buff, sizeof( buff ), "Forward speed: %5.1f cm/s\nSteering rate: %5.1f °/s\nBoggie torque: %5.1f N\u00B7m\nx: %5.2f m    Node 1: %2d\ny: %5.2f m    Node 2: %2d",
-			          robot.GetRobotSpeed()*100, robot.GetSteeringRateCmd(), robot.GetBoggieTorque(), robot.GetPosition().x(), robot.node_1, robot.GetPosition().y(), robot.node_2 );
+			          values.speed*100, values.steering_rate, values.boggie_torque, values.x, values.node_1, values.y, values.node_2 );
 			text->set_text( buff );
 
 			return false;
@@ -179,18 +196,33 @@ int main( int argc, char* argv[] )
 	
 	// [ Simulation loop ]
 
-	Sim_loop sim( 0.001, display_ptr, false, 0 );
-	//sim.set_fps( 25 );
+	double sim_time;
 
-	if ( argc > 1 && strncmp( argv[1], "capture", 8 ) == 0 )
-		sim.start_captures();
+	if ( display_ptr != nullptr )
+	{
+		Sim_loop sim( 0.001, display_ptr, false, 0 );
+		//sim.set_fps( 25 );
+		// Keep the physics at the real-time rate whatever the rendering rate:
+		sim.set_physics_thread( true );
 
-	sim.loop( step_function );
+		if ( argc > 1 && strncmp( argv[1], "capture", 8 ) == 0 )
+			sim.start_captures();
+
+		sim.loop( step_function );
+		sim_time = sim.get_time();
+	}
+	else
+	{
+		Headless_loop sim( 0.001 );
+		sim.loop( step_function );
+		sim_time = sim.get_time();
+		sim.print_stats();
+	}
 
 
 	printf( "%s t %6.3f | x %5.3f | y %+6.3f\n",
 	( fabs( robot.GetPosition().x() ) >= x_goal ? "\033[1;32m[Success]\033[0;39m" : "\033[1;31m[Failure]\033[0;39m" ),
-	sim.get_time(), robot.GetPosition().x(), robot.GetPosition().y() );
+	sim_time, robot.GetPosition().x(), robot.GetPosition().y() );
 	fflush( stdout );
 
 
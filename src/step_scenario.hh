@@ -0,0 +1,124 @@
+#ifndef STEP_SCENARIO_HH
+#define STEP_SCENARIO_HH
+
+#include "ode/environment.hh"
+#include "ode/box.hh"
+#include "rover.hh"
+
+
+// Parameters of the step climbing scenario:
+typedef struct Step_params
+{
+	// Global friction coefficient:
+	double mu = 0.5;
+	// Solver and collision space of the environment:
+	ode::env_config config;
+	// Orientation angle of the step ( degrees ):
+	double orientation = 0;
+	// Height of the step:
+	float step_height = 0.105*2;
+	// Cruise speed of the robot:
+	float speedf = 0.04;
+	// Time to reach cruise speed:
+	float term = 0.5;
+	// Duration before starting the internal control:
+	float IC_start = 1;
+	// Period of the internal control:
+	float cmd_period = 0.5;
+	// Timeout of the simulation:
+	float timeout = 60;
+	// Maximum distance to travel ahead:
+	float x_goal = 1.5;
+	// Maximum lateral deviation permitted:
+	float y_max = 0.6;
+} Step_params;
+
+
+// A rover of type R approaching a step of height 2*wheel_radius:
+template<class R>
+class Step_scenario
+{
+	public:
+
+	template<typename... Args>
+	Step_scenario( const Step_params& params, Args&&... robot_args ) :
+	               params( params ),
+	               env( params.config, params.mu ),
+	               robot( env, Eigen::Vector3d( 0, 0, 0 ), std::forward<Args>( robot_args )... ),
+	               step( env, Eigen::Vector3d( 1, 0, params.step_height/2 ), 1, 1, 3, params.step_height, false ),
+	               step_c( env, Eigen::Vector3d( 2, 0, params.step_height/2 ), 1, 2, 3, params.step_height, false ),
+	               _speed( 0 ), _n_steps( 0 )
+	{
+		robot.SetCrawlingMode( true );
+		robot.SetCmdPeriod( params.cmd_period );
+		robot.DeactivateIC();
+
+		step.set_rotation( 0, 0, params.orientation*M_PI/180 );
+		step.fix();
+		step.set_collision_group( "ground" );
+
+		step_c.fix();
+		step_c.set_collision_group( "ground" );
+	}
+
+	// Simulation step to be called by Sim_loop. Returns true when the episode is over:
+	bool next_step( float timestep, double time )
+	{
+		if ( fabs( _speed ) <= fabs( params.speedf ) )
+		{
+			_speed += params.speedf/params.term*timestep;
+			robot.SetRobotSpeed( _speed );
+		}
+
+		if ( ! robot.IsICActivated() && time >= params.IC_start )
+			robot.ActivateIC();
+
+		env.next_step( timestep );
+		robot.next_step( timestep );
+
+		_n_steps++;
+
+		// If the robot has reached the goal, is out of track or has tipped over, end the simulation:
+		return time >= params.timeout || IsOutOfTrack() || HasReachedGoal() || robot.IsUpsideDown();
+	}
+
+	// Same as above with the simulation time kept by the scenario itself:
+	inline bool next_step( float timestep ) { return next_step( timestep, _n_steps*timestep ); }
+
+	inline double GetTime( float timestep ) const { return _n_steps*timestep; }
+
+	// Whole state of the scenario, to restart or branch an episode without building it again:
+	std::vector<double> snapshot() const
+	{
+		std::vector<double> buffer = env.snapshot();
+		robot.save_state( buffer );
+		buffer.push_back( _speed );
+		buffer.push_back( _n_steps );
+		return buffer;
+	}
+
+	void restore( const std::vector<double>& buffer )
+	{
+		const double* data = env.restore( buffer.data() );
+		data = robot.load_state( data );
+		_speed = data[0];
+		_n_steps = data[1];
+	}
+
+	inline bool HasReachedGoal() const { return fabs( robot.GetPosition().x() ) >= params.x_goal; }
+	inline bool IsOutOfTrack() const { return fabs( robot.GetPosition().y() ) >= params.y_max; }
+
+	const Step_params params;
+	ode::Environment env;
+	R robot;
+	ode::Box step;
+	ode::Box step_c;
+
+	protected:
+
+	float _speed;
+	long _n_steps;
+};
+
+
+#endif
@@ -0,0 +1,297 @@
+/*
+** Parameter sweeps of the step scenario, run in parallel worker threads inside a single process.
+** The controllers are loaded only once and shared by all the trials.
+**
+** sweep trees <data_dir> [options]
+**     Evaluate the model trees of every subdirectory of data_dir containing params_1.yaml and params_2.yaml
+**     (as written by fit_trees.sh). The success rate and average duration of each pair of trees are appended
+**     to data_dir/performance.csv and the result of every trial to data_dir/performance_trials.csv.
+**
+** sweep samples <actor_dir> <samples_id> [options]
+**     Evaluate the TensorFlow actor and append the states and actions of each successful trial
+**     to samples_id_angle<angle>_<even|odd>.dat, the parity being the one of the offset in the grid.
+**     The result of every trial is written to samples_id_results.csv.
+**
+** Options:
+** angles=first:step:last   Orientations of the step in degrees (default: -1:1:1 for trees, -2:1:2 for samples).
+** offsets=first:step:last  Offsets of the starting time of the control (default: -0.25:0.01:0.24).
+** threads=n                Number of worker threads (default: number of hardware threads).
+*/
+#include "step_scenario.hh"
+#include "rover_mt.hh"
+#include "rover_tf.hh"
+#include "ode/thread_pool.hh"
+#include <dirent.h>
+#include <fstream>
+#include <sstream>
+#include <regex>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+
+
+// Outcome of one trial of the grid:
+typedef struct trial_result
+{
+	double angle;
+	double offset;
+	bool success;
+	double time;
+	double x;
+	double y;
+	double mean_reward;
+	std::string samples;
+} trial_result;
+
+
+// Values of a range given as first:step:last:
+std::vector<double> parse_range( const std::string& range )
+{
+	double first, step, last;
+	char sep_1, sep_2;
+	std::istringstream stream( range );
+	if ( ! ( stream >> first >> sep_1 >> step >> sep_2 >> last ) || sep_1 != ':' || sep_2 != ':' || step <= 0 )
+		throw std::runtime_error( "Invalid range: " + range );
+
+	std::vector<double> values;
+	int n = floor( ( last - first )/step + 1e-6 ) + 1;
+	for ( int i = 0 ; i < n ; i++ )
+		values.push_back( first + i*step );
+	return values;
+}
+
+
+inline bool file_exists( const std::string& path ) { return std::ifstream( path ).good(); }
+
+
+// Parameters of the scenario for a point of the grid:
+Step_params grid_params( double angle, double offset )
+{
+	Step_params params;
+	params.orientation = angle;
+	params.IC_start += offset;
+	return params;
+}
+
+
+// Run the scenario to its end and fill in the outcome:
+template<class R>
+void run_scenario( Step_scenario<R>& scenario, trial_result& result )
+{
+	const float timestep( 0.001 );
+	while ( ! scenario.next_step( timestep ) );
+
+	result.success = scenario.HasReachedGoal();
+	result.time = scenario.GetTime( timestep );
+	result.x = scenario.robot.GetPosition().x();
+	result.y = scenario.robot.GetPosition().y();
+}
+
+
+// Value of a field in the name of a tree directory, as in {oblique:false,max_depth_1:2,max_depth_2:1,L1:0}:
+std::string tree_option( const std::string& tree_dir, const std::string& name )
+{
+	std::smatch match;
+	if ( std::regex_search( tree_dir, match, std::regex( name + ":([^,}]*)" ) ) )
+		return match[1];
+	return "";
+}
+
+
+int sweep_trees( const std::string& data_dir, const std::vector<double>& angles, const std::vector<double>& offsets, ode::ThreadPool& pool )
+{
+	std::vector<std::string> tree_dirs;
+	DIR* dir = opendir( data_dir.c_str() );
+	if ( dir == nullptr )
+		throw std::runtime_error( "Unable to open the directory " + data_dir );
+	while ( struct dirent* entry = readdir( dir ) )
+	{
+		std::string tree_dir = data_dir + "/" + entry->d_name;
+		if ( file_exists( tree_dir + "/params_1.yaml" ) && file_exists( tree_dir + "/params_2.yaml" ) )
+			tree_dirs.push_back( tree_dir );
+	}
+	closedir( dir );
+	std::sort( tree_dirs.begin(), tree_dirs.end() );
+
+	std::string csv_path = data_dir + "/performance.csv";
+	std::string trials_csv_path = data_dir + "/performance_trials.csv";
+	bool new_csv = ! file_exists( csv_path );
+	bool new_trials_csv = ! file_exists( trials_csv_path );
+	std::ofstream csv( csv_path, std::ios::app );
+	std::ofstream trials_csv( trials_csv_path, std::ios::app );
+	if ( new_csv )
+		csv << "max_depth_1,max_depth_2,L1,success_percentage,average_time\n";
+	if ( new_trials_csv )
+		trials_csv << "tree_dir,angle,offset,success,time,x,y\n";
+
+	for ( const std::string& tree_dir : tree_dirs )
+	{
+		fprintf( stderr, "=== %s ===\n", tree_dir.c_str() );
+
+		Flat_tree_policy<double>::ptr_t policy( new Flat_tree_policy<double>( { tree_dir + "/params_1.yaml", tree_dir + "/params_2.yaml" },
+		                                                                      robot::Rover_1_mt::state_dim ) );
+
+		std::vector<trial_result> results( angles.size()*offsets.size() );
+		pool.parallel_for( results.size(), [&]( int i )
+		{
+			trial_result& result = results[i];
+			result.angle = angles[i/offsets.size()];
+			result.offset = offsets[i%offsets.size()];
+
+			Step_params params = grid_params( result.angle, result.offset );
+			// Goal of scene_1_mt:
+			params.x_goal = 1;
+
+			Step_scenario<robot::Rover_1_mt> scenario( params, policy );
+			run_scenario( scenario, result );
+		} );
+
+		int n_successes = 0;
+		double total_time = 0;
+		for ( const trial_result& result : results )
+		{
+			if ( result.success )
+			{
+				n_successes++;
+				total_time += result.time;
+			}
+			trials_csv << tree_dir << "," << result.angle << "," << result.offset << "," << result.success << ","
+			           << result.time << "," << result.x << "," << result.y << "\n";
+		}
+
+		char line[100];
+		snprintf( line, sizeof( line ), "%.1f,%.2f", n_successes*100./results.size(), n_successes > 0 ? total_time/n_successes : 0. );
+		csv << tree_option( tree_dir, "max_depth_1" ) << "," << tree_option( tree_dir, "max_depth_2" ) << "," << tree_option( tree_dir, "L1" ) << "," << line << std::endl;
+		fprintf( stderr, "%d/%d successes\n", n_successes, int( results.size() ) );
+	}
+
+	return 0;
+}
+
+
+int sweep_samples( const std::string& actor_dir, const std::string& samples_id, const std::vector<double>& angles, const std::vector<double>& offsets, ode::ThreadPool& pool )
+{
+	// Keep the actor loaded between the trials:
+	Batched_actor::ptr_t actor = Batched_actor::get( actor_dir.c_str(), robot::Rover_1_tf::state_dim, robot::Rover_1_tf::action_dim );
+
+	std::vector<trial_result> results( angles.size()*offsets.size() );
+	pool.parallel_for( results.size(), [&]( int i )
+	{
+		trial_result& result = results[i];
+		result.angle = angles[i/offsets.size()];
+		result.offset = offsets[i%offsets.size()];
+
+		Step_params params = grid_params( result.angle, result.offset );
+		Step_scenario<robot::Rover_1_tf> scenario( params, actor_dir.c_str() );
+
+		// Record the states and actions in a buffer large enough for the whole episode:
+		Experience_buffer::ptr_t experience( new Experience_buffer( robot::Rover_1_tf::state_dim, robot::Rover_1_tf::action_dim, long( params.timeout/params.cmd_period ) + 2 ) );
+		scenario.robot.SetExperienceBuffer( experience );
+
+		run_scenario( scenario, result );
+		result.mean_reward = scenario.robot.GetTotalReward()/result.time;
+
+		if ( ! result.success )
+			return;
+
+		std::ostringstream samples;
+		char val[32];
+		for ( long k = 0 ; k < experience->size() ; k++ )
+		{
+			const float* row = experience->data() + k*experience->row_size();
+			for ( int j = 0 ; j < experience->reward_offset() ; j++ )
+			{
+				snprintf( val, sizeof( val ), j > 0 ? " %f" : "%f", row[j] );
+				samples << val;
+			}
+			samples << "\n";
+		}
+		// The last state and action, which have no next state to form a transition:
+		const std::vector<float>& last_state = scenario.robot.GetLastState();
+		if ( ! last_state.empty() )
+		{
+			for ( size_t j = 0 ; j < last_state.size() ; j++ )
+			{
+				snprintf( val, sizeof( val ), j > 0 ? " %f" : "%f", last_state[j] );
+				samples << val;
+			}
+			snprintf( val, sizeof( val ), " %f", float( scenario.robot.GetSteeringRateCmd() ) );
+			samples << val;
+			snprintf( val, sizeof( val ), " %f", float( scenario.robot.GetBoggieTorque() ) );
+			samples << val << "\n";
+		}
+		result.samples = samples.str();
+	} );
+
+	std::ofstream results_csv( samples_id + "_results.csv" );
+	results_csv << "angle,offset,success,time,x,y,mean_reward\n";
+
+	for ( size_t i = 0 ; i < results.size() ; i++ )
+	{
+		const trial_result& result = results[i];
+		results_csv << result.angle << "," << result.offset << "," << result.success << "," << result.time << ","
+		            << result.x << "," << result.y << "," << result.mean_reward << "\n";
+
+		if ( ! result.success )
+		{
+			fprintf( stderr, "\033[1;31m Failed for angle=%g and offset=%g\033[0;39m\n", result.angle, result.offset );
+			continue;
+		}
+
+		char sample_file[1000];
+		snprintf( sample_file, sizeof( sample_file ), "%s_angle%g_%s.dat", samples_id.c_str(), result.angle, i%offsets.size()%2 == 0 ? "even" : "odd" );
+		FILE* file = fopen( sample_file, "a" );
+		if ( file == nullptr )
+			throw std::runtime_error( std::string( "Unable to open " ) + sample_file );
+		fprintf( file, "New trial: angle=%g offset=%g\n", result.angle, result.offset );
+		fputs( result.samples.c_str(), file );
+		fprintf( file, "[Success] t %6.3f | x %5.3f | y %+6.3f | Rmoy %7.3f\n", result.time, result.x, result.y, result.mean_reward );
+		fclose( file );
+	}
+
+	return 0;
+}
+
+
+int main( int argc, char* argv[] )
+{
+	if ( argc < 3 || ( strcmp( argv[1], "trees" ) != 0 && strcmp( argv[1], "samples" ) != 0 ) || ( strcmp( argv[1], "samples" ) == 0 && argc < 4 ) )
+	{
+		fprintf( stderr, "USAGE: %s trees <data_dir> [options] OR %s samples <actor_dir> <samples_id> [options]\n", argv[0], argv[0] );
+		return 1;
+	}
+	bool trees = strcmp( argv[1], "trees" ) == 0;
+
+	std::vector<double> angles = parse_range( trees ? "-1:1:1" : "-2:1:2" );
+	std::vector<double> offsets = parse_range( "-0.25:0.01:0.24" );
+	int n_threads = 0;
+
+	for ( int i = trees ? 3 : 4 ; i < argc ; i++ )
+	{
+		std::string option( argv[i] );
+		if ( option.compare( 0, 7, "angles=" ) == 0 )
+			angles = parse_range( option.substr( 7 ) );
+		else if ( option.compare( 0, 8, "offsets=" ) == 0 )
+			offsets = parse_range( option.substr( 8 ) );
+		else if ( option.compare( 0, 8, "threads=" ) == 0 )
+			n_threads = atoi( option.substr( 8 ).c_str() );
+		else
+		{
+			fprintf( stderr, "Unknown option: %s\n", argv[i] );
+			return 1;
+		}
+	}
+
+	dInitODE2( 0 );
+	int status;
+	{
+		ode::ThreadPool pool( n_threads );
+		auto start = std::chrono::steady_clock::now();
+
+		status = trees ? sweep_trees( argv[2], angles, offsets, pool ) : sweep_samples( argv[2], argv[3], angles, offsets, pool );
+
+		fprintf( stderr, "Sweep done in %.1fs with %d threads\n", std::chrono::duration<double>( std::chrono::steady_clock::now() - start ).count(), pool.size() );
+	}
+	dCloseODE();
+	return status;
+}